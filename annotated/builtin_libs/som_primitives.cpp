@@ -3,8 +3,12 @@
 #include "som_class.h"
 #include "som_utils.h"
 #include "som_compile_file.h"
+#include "som_string_utils.h"
+#include "som_hash_table.h"
+#include "som_vector.h"
+#include "som_array_utils.h"
+#include "som_file_reader.h"
 #include <sstream>
-#include <fstream>
 #include "vm.h"
 
 #ifdef ENABLE_SOM_PROFILE_FREQUENCY
@@ -47,20 +51,24 @@ void NO_INLINE PrintSOMStackTrace(FILE* file, StackFrameHeader* hdr)
 // and the behaviors of the reference implementations are simply UB (SOM++) or crash (TruffleSOM)
 // so we do the same..
 //
+// The receiver of the Integer primitives is either an int32 or a LargeInteger (see som_large_integer.h).
+// The bytecode fast paths handle int32 operands whose result fits in int32, so these are mostly reached on overflow.
+//
 DEEGEN_DEFINE_LIB_FUNC(integer_add)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_add);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
-        Return(TValue::Create<tInt32>(lhs + rhs.As<tInt32>()));
+        Return(MakeSOMInteger(SOMIntegerAdd(lhs, r)));
     }
     else
     {
         Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tDouble>(lhs + rhs.As<tDouble>()));
+        Return(TValue::Create<tDouble>(static_cast<double>(lhs) + rhs.As<tDouble>()));
     }
 }
 
@@ -68,16 +76,17 @@ DEEGEN_DEFINE_LIB_FUNC(integer_minus)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_minus);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
-        Return(TValue::Create<tInt32>(lhs - rhs.As<tInt32>()));
+        Return(MakeSOMInteger(SOMIntegerSub(lhs, r)));
     }
     else
     {
         Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tDouble>(lhs - rhs.As<tDouble>()));
+        Return(TValue::Create<tDouble>(static_cast<double>(lhs) - rhs.As<tDouble>()));
     }
 }
 
@@ -85,16 +94,17 @@ DEEGEN_DEFINE_LIB_FUNC(integer_star)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_star);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
-        Return(TValue::Create<tInt32>(lhs * rhs.As<tInt32>()));
+        Return(MakeSOMInteger(SOMIntegerMul(lhs, r)));
     }
     else
     {
         Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tDouble>(lhs * rhs.As<tDouble>()));
+        Return(TValue::Create<tDouble>(static_cast<double>(lhs) * rhs.As<tDouble>()));
     }
 }
 
@@ -102,17 +112,17 @@ DEEGEN_DEFINE_LIB_FUNC(integer_rem)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_rem);
 
-    int32_t l = GetArg(0).As<tInt32>();
+    int64_t l = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
-        int32_t r = rhs.As<tInt32>();
-        Return(TValue::Create<tInt32>(l - ((l / r) * r)));
+        Return(MakeSOMInteger(SOMIntegerRem(l, r)));
     }
     else
     {
         Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tDouble>(static_cast<double>(l % static_cast<int64_t>(rhs.As<tDouble>()))));
+        Return(TValue::Create<tDouble>(static_cast<double>(SOMIntegerRem(l, static_cast<int64_t>(rhs.As<tDouble>())))));
     }
 }
 
@@ -120,44 +130,44 @@ DEEGEN_DEFINE_LIB_FUNC(integer_bitwisexor)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_bitwisexor);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
-    int32_t rhs = GetArg(1).As<tInt32>();
-    Return(TValue::Create<tInt32>(lhs ^ rhs));
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
+    int64_t rhs = GetSOMIntegerValue(GetArg(1));
+    Return(MakeSOMInteger(lhs ^ rhs));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_leftshift)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_leftshift);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
-    int32_t rhs = GetArg(1).As<tInt32>();
-    Return(TValue::Create<tInt32>(lhs << rhs));
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
+    int64_t rhs = GetSOMIntegerValue(GetArg(1));
+    Return(MakeSOMInteger(SOMIntegerLeftShift(lhs, rhs)));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_unsignedrightshift)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_unsignedrightshift);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
-    int32_t rhs = GetArg(1).As<tInt32>();
-    Return(TValue::Create<tInt32>(lhs >> rhs));
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
+    int64_t rhs = GetSOMIntegerValue(GetArg(1));
+    Return(MakeSOMInteger(SOMIntegerRightShift(lhs, rhs)));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_slash)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_slash);
 
-    int32_t l = GetArg(0).As<tInt32>();
+    int64_t l = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
-        int32_t r = rhs.As<tInt32>();
-        Return(TValue::Create<tInt32>(l / r));
+        Return(MakeSOMInteger(SOMIntegerDiv(l, r)));
     }
     else
     {
         Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tInt32>(l / static_cast<int32_t>(rhs.As<tDouble>())));
+        Return(MakeSOMInteger(SOMIntegerDiv(l, static_cast<int64_t>(rhs.As<tDouble>()))));
     }
 }
 
@@ -165,17 +175,17 @@ DEEGEN_DEFINE_LIB_FUNC(integer_slashslash)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_slashslash);
 
-    int32_t l = GetArg(0).As<tInt32>();
+    int64_t l = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
-        int32_t r = rhs.As<tInt32>();
-        Return(TValue::Create<tDouble>(static_cast<double>(l) / r));
+        Return(TValue::Create<tDouble>(static_cast<double>(l) / static_cast<double>(r)));
     }
     else
     {
         Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tDouble>(l / rhs.As<tDouble>()));
+        Return(TValue::Create<tDouble>(static_cast<double>(l) / rhs.As<tDouble>()));
     }
 }
 
@@ -183,43 +193,36 @@ DEEGEN_DEFINE_LIB_FUNC(integer_percent)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_percent);
 
-    int32_t l = GetArg(0).As<tInt32>();
+    int64_t l = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    int32_t r;
-    if (rhs.Is<tInt32>())
-    {
-        r = rhs.As<tInt32>();
-    }
-    else
+    int64_t r;
+    if (!TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
         Assert(rhs.Is<tDouble>());
-        r = static_cast<int32_t>(rhs.As<tDouble>());
+        r = static_cast<int64_t>(rhs.As<tDouble>());
     }
-    int32_t result = l % r;
-    if ((result != 0) && ((result < 0) != (r < 0))) {
-        result += r;
-    }
-    Return(TValue::Create<tInt32>(result));
+    Return(MakeSOMInteger(SOMIntegerMod(l, r)));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_and)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_and);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
-    int32_t rhs = GetArg(1).As<tInt32>();
-    Return(TValue::Create<tInt32>(lhs & rhs));
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
+    int64_t rhs = GetSOMIntegerValue(GetArg(1));
+    Return(MakeSOMInteger(lhs & rhs));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_equal)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_equal);
 
-    int32_t l = GetArg(0).As<tInt32>();
+    int64_t l = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
-        Return(TValue::Create<tBool>(l == rhs.As<tInt32>()));
+        Return(TValue::Create<tBool>(l == r));
     }
     else if (rhs.Is<tDouble>())
     {
@@ -235,11 +238,12 @@ DEEGEN_DEFINE_LIB_FUNC(integer_equalequal)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_equalequal);
 
-    int32_t l = GetArg(0).As<tInt32>();
+    int64_t l = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
-        Return(TValue::Create<tBool>(l == rhs.As<tInt32>()));
+        Return(TValue::Create<tBool>(l == r));
     }
     else
     {
@@ -247,83 +251,62 @@ DEEGEN_DEFINE_LIB_FUNC(integer_equalequal)
     }
 }
 
+// Compare an integer with an integer or a double
+//
+template<typename Cmp>
+static bool ALWAYS_INLINE CompareSOMInteger(int64_t lhs, TValue rhs, const Cmp& cmp)
+{
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
+    {
+        return cmp(lhs, r);
+    }
+    Assert(rhs.Is<tDouble>());
+    return cmp(static_cast<double>(lhs), rhs.As<tDouble>());
+}
+
 DEEGEN_DEFINE_LIB_FUNC(integer_lowerthan)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_lowerthan);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
-    TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
-    {
-        Return(TValue::Create<tBool>(lhs < rhs.As<tInt32>()));
-    }
-    else
-    {
-        Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tBool>(lhs < rhs.As<tDouble>()));
-    }
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
+    Return(TValue::Create<tBool>(CompareSOMInteger(lhs, GetArg(1), [](auto l, auto r) { return l < r; })));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_lowerequal)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_lowerequal);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
-    TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
-    {
-        Return(TValue::Create<tBool>(lhs <= rhs.As<tInt32>()));
-    }
-    else
-    {
-        Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tBool>(lhs <= rhs.As<tDouble>()));
-    }
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
+    Return(TValue::Create<tBool>(CompareSOMInteger(lhs, GetArg(1), [](auto l, auto r) { return l <= r; })));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_greaterthan)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_greaterthan);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
-    TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
-    {
-        Return(TValue::Create<tBool>(lhs > rhs.As<tInt32>()));
-    }
-    else
-    {
-        Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tBool>(lhs > rhs.As<tDouble>()));
-    }
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
+    Return(TValue::Create<tBool>(CompareSOMInteger(lhs, GetArg(1), [](auto l, auto r) { return l > r; })));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_greaterequal)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_greaterequal);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
-    TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
-    {
-        Return(TValue::Create<tBool>(lhs >= rhs.As<tInt32>()));
-    }
-    else
-    {
-        Assert(rhs.Is<tDouble>());
-        Return(TValue::Create<tBool>(lhs >= rhs.As<tDouble>()));
-    }
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
+    Return(TValue::Create<tBool>(CompareSOMInteger(lhs, GetArg(1), [](auto l, auto r) { return l >= r; })));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_unequal)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_unequal);
 
-    int32_t lhs = GetArg(0).As<tInt32>();
+    int64_t lhs = GetSOMIntegerValue(GetArg(0));
     TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t r;
+    if (TryGetSOMIntegerValue(rhs, &r /*out*/))
     {
-        Return(TValue::Create<tBool>(lhs != rhs.As<tInt32>()));
+        Return(TValue::Create<tBool>(lhs != r));
     }
     else
     {
@@ -336,7 +319,7 @@ DEEGEN_DEFINE_LIB_FUNC(integer_asstring)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_asstring);
 
-    int32_t v = GetArg(0).As<tInt32>();
+    int64_t v = GetSOMIntegerValue(GetArg(0));
     std::ostringstream Str;
     Str << v;
     SOMObject* s = SOMObject::AllocateString(Str.str());
@@ -347,7 +330,7 @@ DEEGEN_DEFINE_LIB_FUNC(integer_asdouble)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_asdouble);
 
-    int32_t v = GetArg(0).As<tInt32>();
+    int64_t v = GetSOMIntegerValue(GetArg(0));
     Return(TValue::Create<tDouble>(static_cast<double>(v)));
 }
 
@@ -355,25 +338,27 @@ DEEGEN_DEFINE_LIB_FUNC(integer_as32bitsigned)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_as32bitsigned);
 
-    Return(GetArg(0));
+    int64_t v = GetSOMIntegerValue(GetArg(0));
+    Return(TValue::Create<tInt32>(static_cast<int32_t>(v)));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_as32bitunsigned)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_as32bitunsigned);
 
-    Return(GetArg(0));
+    int64_t v = GetSOMIntegerValue(GetArg(0));
+    Return(MakeSOMInteger(static_cast<int64_t>(static_cast<uint32_t>(v))));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_sqrt)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_sqrt);
 
-    int32_t v = GetArg(0).As<tInt32>();
+    int64_t v = GetSOMIntegerValue(GetArg(0));
     double r = sqrt(static_cast<double>(v));
     if (r == rint(r))
     {
-        Return(TValue::Create<tInt32>(static_cast<int32_t>(r)));
+        Return(MakeSOMInteger(static_cast<int64_t>(r)));
     }
     else
     {
@@ -381,11 +366,27 @@ DEEGEN_DEFINE_LIB_FUNC(integer_sqrt)
     }
 }
 
+// Return a uniformly random integer in [1, limit] from the per-VM generator
+//
+static TValue WARN_UNUSED GetSOMRandomInteger(const char* meth, int64_t limit)
+{
+    if (unlikely(limit <= 0))
+    {
+        fprintf(stderr, "%s: limit must be positive, got %lld\n", meth, static_cast<long long>(limit));
+        abort();
+    }
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    uint64_t r = vm->m_randomGenerator.NextBelow(static_cast<uint64_t>(limit));
+    return MakeSOMInteger(static_cast<int64_t>(r + 1));
+}
+
+// The bytecode fast path handles positive int32 receivers, this handles LargeInteger receivers and reports errors
+//
 DEEGEN_DEFINE_LIB_FUNC(integer_atrandom)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_atrandom);
 
-    Return(TValue::Create<tInt32>(rand()));
+    Return(GetSOMRandomInteger("atRandom", GetSOMIntegerValue(GetArg(0))));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_fromstring)
@@ -415,40 +416,30 @@ DEEGEN_DEFINE_LIB_FUNC(integer_fromstring)
         Return(TValue::Create<tInt32>(0));
     }
 
-    Return(TValue::Create<tInt32>(static_cast<int32_t>(i)));
+    Return(MakeSOMInteger(i));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_abs)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_abs);
 
-    int32_t v = GetArg(0).As<tInt32>();
-    if (v < 0) { v = -v; }
-    Return(TValue::Create<tInt32>(v));
+    int64_t v = GetSOMIntegerValue(GetArg(0));
+    if (v < 0) { v = SOMIntegerSub(0, v); }
+    Return(MakeSOMInteger(v));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(integer_min)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_min);
 
-    int32_t v = GetArg(0).As<tInt32>();
-    TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t v = GetSOMIntegerValue(GetArg(0));
+    if (CompareSOMInteger(v, GetArg(1), [](auto l, auto r) { return l < r; }))
     {
-        Return(TValue::Create<tInt32>(std::min(v, rhs.As<tInt32>())));
+        Return(GetArg(0));
     }
     else
     {
-        Assert(rhs.Is<tDouble>());
-        double r = rhs.As<tDouble>();
-        if (v < r)
-        {
-            Return(GetArg(0));
-        }
-        else
-        {
-            Return(GetArg(1));
-        }
+        Return(GetArg(1));
     }
 }
 
@@ -456,24 +447,14 @@ DEEGEN_DEFINE_LIB_FUNC(integer_max)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_max);
 
-    int32_t v = GetArg(0).As<tInt32>();
-    TValue rhs = GetArg(1);
-    if (rhs.Is<tInt32>())
+    int64_t v = GetSOMIntegerValue(GetArg(0));
+    if (CompareSOMInteger(v, GetArg(1), [](auto l, auto r) { return l > r; }))
     {
-        Return(TValue::Create<tInt32>(std::max(v, rhs.As<tInt32>())));
+        Return(GetArg(0));
     }
     else
     {
-        Assert(rhs.Is<tDouble>());
-        double r = rhs.As<tDouble>();
-        if (v > r)
-        {
-            Return(GetArg(0));
-        }
-        else
-        {
-            Return(GetArg(1));
-        }
+        Return(GetArg(1));
     }
 }
 
@@ -481,13 +462,13 @@ DEEGEN_DEFINE_LIB_FUNC(integer_range)
 {
     SOM_LOG_PRIMITIVE_FREQ(integer_range);
 
-    int32_t start = GetArg(0).As<tInt32>();
-    int32_t end = GetArg(1).As<tInt32>();
+    int64_t start = GetSOMIntegerValue(GetArg(0));
+    int64_t end = GetSOMIntegerValue(GetArg(1));
     size_t len = (end >= start) ? static_cast<size_t>(end - start + 1) : 0;
     SOMObject* o = SOMObject::AllocateArray(len);
-    for (int32_t curv = start; curv <= end; curv++)
+    for (size_t i = 0; i < len; i++)
     {
-        o->m_data[curv - start + 1] = TValue::Create<tInt32>(curv);
+        o->m_data[i + 1] = MakeSOMInteger(start + static_cast<int64_t>(i));
     }
     Return(TValue::Create<tObject>(TranslateToHeapPtr(o)));
 }
@@ -495,8 +476,7 @@ DEEGEN_DEFINE_LIB_FUNC(integer_range)
 static double ALWAYS_INLINE CoerceDouble(TValue tv)
 {
     if (tv.Is<tDouble>()) { return tv.As<tDouble>(); }
-    Assert(tv.Is<tInt32>());
-    return static_cast<double>(tv.As<tInt32>());
+    return static_cast<double>(GetSOMIntegerValue(tv));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(double_add)
@@ -663,7 +643,7 @@ DEEGEN_DEFINE_LIB_FUNC(double_asinteger)
     SOM_LOG_PRIMITIVE_FREQ(double_asinteger);
 
     double v = GetArg(0).As<tDouble>();
-    Return(TValue::Create<tInt32>(static_cast<int32_t>(v)));
+    Return(MakeSOMInteger(static_cast<int64_t>(v)));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(double_round)
@@ -671,7 +651,7 @@ DEEGEN_DEFINE_LIB_FUNC(double_round)
     SOM_LOG_PRIMITIVE_FREQ(double_round);
 
     double v = GetArg(0).As<tDouble>();
-    Return(TValue::Create<tInt32>(static_cast<int32_t>(llround(v))));
+    Return(MakeSOMInteger(static_cast<int64_t>(llround(v))));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(double_sqrt)
@@ -1112,11 +1092,11 @@ DEEGEN_DEFINE_LIB_FUNC(block3_eval)
     MakeInPlaceCall(callbase + x_numSlotsForStackFrameHeader, 3 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(TrivialReturnCont));
 }
 
-// Setup stack to call block 'func' with only the implicit 'self' argument.
-// If the block accepts more arguments, nil is passed in
-// Return how many arguments 'func' actually has.
+// Setup stack to call block 'func' with the implicit 'self' argument, followed by 'arg1' and 'arg2'.
+// Arguments beyond what the block accepts are ignored by the callee.
+// Return how many arguments 'func' actually has (including 'self').
 //
-static size_t WARN_UNUSED ALWAYS_INLINE SetupStackForBlockNoArgCall(TValue* callbase, TValue func)
+static size_t WARN_UNUSED ALWAYS_INLINE SetupStackForBlockCall(TValue* callbase, TValue func, TValue arg1, TValue arg2)
 {
     HeapPtr<FunctionObject> fn = func.As<tFunction>();
     TestAssert(fn->m_numUpvalues >= 1);
@@ -1132,11 +1112,20 @@ static size_t WARN_UNUSED ALWAYS_INLINE SetupStackForBlockNoArgCall(TValue* call
     {
         callbase[x_numSlotsForStackFrameHeader] = *reinterpret_cast<Upvalue*>(fn->m_upvalues[0].m_value)->m_ptr;
     }
-    callbase[x_numSlotsForStackFrameHeader + 1] = TValue::Create<tNil>();
-    callbase[x_numSlotsForStackFrameHeader + 2] = TValue::Create<tNil>();
+    callbase[x_numSlotsForStackFrameHeader + 1] = arg1;
+    callbase[x_numSlotsForStackFrameHeader + 2] = arg2;
     return numArgs;
 }
 
+// Setup stack to call block 'func' with only the implicit 'self' argument.
+// If the block accepts more arguments, nil is passed in
+// Return how many arguments 'func' actually has.
+//
+static size_t WARN_UNUSED ALWAYS_INLINE SetupStackForBlockNoArgCall(TValue* callbase, TValue func)
+{
+    return SetupStackForBlockCall(callbase, func, TValue::Create<tNil>(), TValue::Create<tNil>());
+}
+
 DEEGEN_FORWARD_DECLARE_LIB_FUNC_RETURN_CONTINUATION(block_whiletrue_evalbody);
 
 DEEGEN_DEFINE_LIB_FUNC_CONTINUATION(block_whiletrue_evalcond)
@@ -1263,6 +1252,12 @@ DEEGEN_DEFINE_LIB_FUNC(method_invoke_on_with)
 
     TValue func = TCGet(meth.As<tObject>()->m_data[2]);
     TestAssert(func.Is<tFunction>());
+    // The method object is not obtained from a method lookup, so the method may not have been compiled yet
+    //
+    if (unlikely((func.As<tFunction>()->m_invalidArrayType >> 4) == SOM_LazyMethod))
+    {
+        SOMCompileLazyMethod(func.As<tFunction>());
+    }
 
     TValue* callbase = base + 3;
     callbase[0].m_value = reinterpret_cast<uint64_t>(func.As<tFunction>());
@@ -1275,6 +1270,27 @@ DEEGEN_DEFINE_LIB_FUNC(method_invoke_on_with)
     MakeInPlaceCall(callbase + x_numSlotsForStackFrameHeader, numArgs + 1 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(TrivialReturnCont));
 }
 
+// The entry point of a method that has not been compiled yet
+//
+// A method is normally compiled when it is looked up (see SOMClass::GetMethod), so this is only a fallback
+// for a caller that got hold of the stub in some other way. Compile the method and call it with the same arguments.
+//
+DEEGEN_DEFINE_LIB_FUNC(lazy_method_trampoline)
+{
+    HeapPtr<FunctionObject> fn = GetStackFrameHeader()->m_func;
+    SOMCompileLazyMethod(fn);
+
+    TValue* base = GetStackBase();
+    size_t numArgs = GetNumArgs();
+    TValue* callbase = base + numArgs;
+    callbase[0].m_value = reinterpret_cast<uint64_t>(fn);
+    for (size_t i = 0; i < numArgs; i++)
+    {
+        callbase[x_numSlotsForStackFrameHeader + i] = base[i];
+    }
+    MakeInPlaceCall(callbase + x_numSlotsForStackFrameHeader, numArgs, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(TrivialReturnCont));
+}
+
 DEEGEN_DEFINE_LIB_FUNC(system_global)
 {
     SOM_LOG_PRIMITIVE_FREQ(system_global);
@@ -1307,7 +1323,7 @@ DEEGEN_DEFINE_LIB_FUNC(system_globalput)
     VM* vm = VM_GetActiveVMForCurrentThread();
     std::string_view globalName = GetStringContentFromSOMString(tv);
     size_t slot = vm->GetSlotForGlobal(globalName);
-    vm->m_somGlobals[slot] = valToPut;
+    vm->SetGlobal(slot, valToPut);
     Return(self);
 }
 
@@ -1346,11 +1362,32 @@ DEEGEN_DEFINE_LIB_FUNC(system_exit)
     SOM_LOG_PRIMITIVE_FREQ(system_exit);
 
     int32_t err = GetArg(1).As<tInt32>();
+    VM* vm = VM_GetActiveVMForCurrentThread();
 
     if (err != 0)
     {
         fprintf(stderr, "[SOM] system.exit called with error code %d. Stacktrace:\n", static_cast<int>(err));
-        PrintSOMStackTrace(VM_GetActiveVMForCurrentThread()->GetStderr(), GetStackFrameHeader());
+        PrintSOMStackTrace(vm->GetStderr(), GetStackFrameHeader());
+    }
+
+    if (vm->m_returnToHostOnExit)
+    {
+        vm->m_exitCode = err;
+        vm->m_exitRequested = true;
+
+        // Find the frame that DeegenEnterVMFromC set up, close every upvalue in the stack so the coroutine can be reused,
+        // and return from that frame, which returns to DeegenEnterVMFromC
+        //
+        StackFrameHeader* hdr = GetStackFrameHeader();
+        while (hdr->m_caller != nullptr)
+        {
+            hdr = reinterpret_cast<StackFrameHeader*>(hdr->m_caller) - 1;
+        }
+        CoroutineRuntimeContext* currentCoro = GetCurrentCoroutine();
+        currentCoro->CloseUpvalues(currentCoro->m_stackBegin);
+        TValue* retStart = reinterpret_cast<TValue*>(hdr + 1);
+        retStart[0] = TValue::Create<tNil>();
+        LongJump(hdr, retStart, 1 /*numReturnValues*/);
     }
 
     exit(err);
@@ -1437,19 +1474,36 @@ DEEGEN_DEFINE_LIB_FUNC(system_fullgc)
     Return(TValue::Create<tBool>(true));
 }
 
+// Reseed the per-VM random number generator, so that the following random numbers are reproducible
+//
+DEEGEN_DEFINE_LIB_FUNC(system_randomseed)
+{
+    SOM_LOG_PRIMITIVE_FREQ(system_randomseed);
+
+    TValue seed = GetArg(1);
+    if (unlikely(!IsSOMInteger(seed)))
+    {
+        fprintf(stderr, "randomSeed: seed must be an integer\n");
+        abort();
+    }
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    vm->m_randomGenerator.Seed(static_cast<uint64_t>(GetSOMIntegerValue(seed)));
+    Return(GetArg(0));
+}
+
 DEEGEN_DEFINE_LIB_FUNC(system_loadfile)
 {
     SOM_LOG_PRIMITIVE_FREQ(system_loadfile);
 
+    // The file is memory-mapped, so its content is copied exactly once, directly into the SOM string
+    //
     TValue tv = GetArg(1);
     std::string_view fileName = GetStringContentFromSOMString(tv);
-    std::ifstream file(fileName.data(), std::ifstream::in);
-    if (file.is_open())
+    SOMFileContent file;
+    if (file.Open(fileName.data()))
     {
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string contents = buffer.str();
-        SOMObject* res = SOMObject::AllocateString(contents);
+        SOMObject* res = SOMObject::AllocateString(file.GetContent());
+        file.Close();
         Return(TValue::Create<tObject>(TranslateToHeapPtr(res)));
     }
     else
@@ -1529,159 +1583,428 @@ DEEGEN_DEFINE_LIB_FUNC(array_copy)
     Return(TValue::Create<tObject>(TranslateToHeapPtr(r)));
 }
 
-DEEGEN_DEFINE_LIB_FUNC(string_concatenate)
+static void NO_RETURN ArrayRangeOutOfBoundError(const char* meth, int64_t start, int64_t end, size_t len)
 {
-    SOM_LOG_PRIMITIVE_FREQ(string_concatenate);
-
-    TValue lhs = GetArg(0);
-    TValue rhs = GetArg(1);
-    TestAssert(lhs.Is<tObject>() && lhs.As<tObject>()->m_arrayType == SOM_String);
-    TestAssert(rhs.Is<tObject>() && rhs.As<tObject>()->m_arrayType == SOM_String);
-    HeapPtr<SOMObject> r = SOMObject::DoStringConcat(lhs.As<tObject>(), rhs.As<tObject>());
-    Return(TValue::Create<tObject>(r));
+    fprintf(stderr, "Array %s range out of bound: start = %lld, end = %lld, size = %d\n",
+            meth, static_cast<long long>(start), static_cast<long long>(end), static_cast<int>(len));
+    abort();
 }
 
-DEEGEN_DEFINE_LIB_FUNC(string_assymbol)
+// Return the value of an index argument of the Array primitive 'meth'
+// A LargeInteger is returned as is, it is out of bound for any Array and is reported by the caller's range check
+//
+static int64_t WARN_UNUSED GetArrayIndexArg(const char* meth, TValue tv)
 {
-    SOM_LOG_PRIMITIVE_FREQ(string_assymbol);
-
-    TValue tv = GetArg(0);
-    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
-    VM* vm = VM_GetActiveVMForCurrentThread();
-    size_t ord = vm->m_interner.InternString(GetStringContentFromSOMString(tv));
-    SOMObject* o = vm->GetInternedSymbol(ord);
-    Return(TValue::Create<tObject>(TranslateToHeapPtr(o)));
+    int64_t idx;
+    if (unlikely(!TryGetSOMIntegerValue(tv, &idx /*out*/)))
+    {
+        fprintf(stderr, "Array %s expects integer indices\n", meth);
+        abort();
+    }
+    return idx;
 }
 
-DEEGEN_DEFINE_LIB_FUNC(string_hashcode)
+// 'copyFrom: start to: end' (inclusive)
+//
+DEEGEN_DEFINE_LIB_FUNC(array_copyfrom_to)
 {
-    SOM_LOG_PRIMITIVE_FREQ(string_hashcode);
+    SOM_LOG_PRIMITIVE_FREQ(array_copyfrom_to);
 
     TValue tv = GetArg(0);
-    std::string_view str = GetStringContentFromSOMString(tv);
-
-    // Use exactly SOM++'s hash implementation
-    //
-    size_t length = str.length();
-    uint64_t hash = 5381U;
-
-    for (size_t i = 0; i < length; i++) {
-        hash = ((hash << 5U) + hash) + static_cast<uint64_t>(str[i]);
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_Array);
+    int64_t start = GetArrayIndexArg("copyFrom:to:", GetArg(1));
+    int64_t end = GetArrayIndexArg("copyFrom:to:", GetArg(2));
+    HeapPtr<SOMObject> o = tv.As<tObject>();
+    size_t len = o->m_data[0].m_value;
+    if (unlikely(start < 1 || end < start - 1 || static_cast<uint64_t>(end) > len))
+    {
+        ArrayRangeOutOfBoundError("copyFrom:to:", start, end, len);
     }
-
-    Return(TValue::Create<tInt32>(static_cast<int32_t>(hash)));
+    size_t n = static_cast<size_t>(end - start + 1);
+    SOMObject* r = SOMObject::AllocateArray(n);
+    memcpy(&r->m_data[1], TranslateToRawPointer(&o->m_data[start]), n * sizeof(TValue));
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(r)));
 }
 
-DEEGEN_DEFINE_LIB_FUNC(string_length)
+// 'replaceFrom: start to: stop with: replacement startingAt: repStart'
+// The replacement may be an Array or a Vector, and may be the receiver itself (the ranges may overlap)
+//
+DEEGEN_DEFINE_LIB_FUNC(array_replacefrom_to_with_startingat)
 {
-    SOM_LOG_PRIMITIVE_FREQ(string_length);
+    SOM_LOG_PRIMITIVE_FREQ(array_replacefrom_to_with_startingat);
 
     TValue tv = GetArg(0);
-    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
-    Return(TValue::Create<tInt32>(static_cast<int32_t>(tv.As<tObject>()->m_data[0].m_value)));
-}
-
-DEEGEN_DEFINE_LIB_FUNC(string_equal)
-{
-    SOM_LOG_PRIMITIVE_FREQ(string_equal);
-
-    TValue lhs = GetArg(0);
-    TValue rhs = GetArg(1);
-    TestAssert(lhs.Is<tObject>() && lhs.As<tObject>()->m_arrayType == SOM_String);
-
-    if (lhs.m_value == rhs.m_value) { Return(TValue::Create<tBool>(true)); }
-
-    if (!rhs.Is<tObject>()) { Return(TValue::Create<tBool>(false)); }
-    HeapPtr<SOMObject> r = rhs.As<tObject>();
-    if (r->m_arrayType != SOM_String) { Return(TValue::Create<tBool>(false)); }
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_Array);
+    int64_t start = GetArrayIndexArg("replaceFrom:to:with:startingAt:", GetArg(1));
+    int64_t stop = GetArrayIndexArg("replaceFrom:to:with:startingAt:", GetArg(2));
+    TValue replacement = GetArg(3);
+    int64_t repStart = GetArrayIndexArg("replaceFrom:to:with:startingAt:", GetArg(4));
+    HeapPtr<SOMObject> o = tv.As<tObject>();
+    size_t len = o->m_data[0].m_value;
+    if (unlikely(start < 1 || stop < start - 1 || static_cast<uint64_t>(stop) > len))
+    {
+        ArrayRangeOutOfBoundError("replaceFrom:to:with:startingAt:", start, stop, len);
+    }
 
-    HeapPtr<SOMObject> l = lhs.As<tObject>();
-    size_t len = r->m_data[0].m_value;
-    if (len != l->m_data[0].m_value) { Return(TValue::Create<tBool>(false)); }
+    const TValue* src;
+    size_t srcLen;
+    if (likely(replacement.Is<tObject>() && replacement.As<tObject>()->m_arrayType == SOM_Array))
+    {
+        src = TranslateToRawPointer(&replacement.As<tObject>()->m_data[1]);
+        srcLen = replacement.As<tObject>()->m_data[0].m_value;
+    }
+    else if (replacement.Is<tObject>() && replacement.As<tObject>()->m_arrayType == SOM_Vector)
+    {
+        src = SOMVector::GetBegin(replacement.As<tObject>());
+        srcLen = SOMVector::GetSize(replacement.As<tObject>());
+    }
+    else
+    {
+        fprintf(stderr, "Array replaceFrom:to:with:startingAt: expects an Array or Vector as the replacement\n");
+        abort();
+    }
 
-    VM* vm = VM_GetActiveVMForCurrentThread();
-    int res = memcmp(TranslateToRawPointer(vm, &l->m_data[1]), TranslateToRawPointer(vm, &r->m_data[1]), len);
-    Return(TValue::Create<tBool>(res == 0));
+    size_t n = static_cast<size_t>(stop - start + 1);
+    if (unlikely(repStart < 1 || static_cast<uint64_t>(repStart - 1) > srcLen || n > srcLen - static_cast<uint64_t>(repStart - 1)))
+    {
+        ArrayRangeOutOfBoundError("replaceFrom:to:with:startingAt: (replacement)", repStart, static_cast<int64_t>(static_cast<uint64_t>(repStart) + n - 1), srcLen);
+    }
+    memmove(TranslateToRawPointer(&o->m_data[start]), src + (repStart - 1), n * sizeof(TValue));
+    Return(tv);
 }
 
-DEEGEN_DEFINE_LIB_FUNC(string_primsubstring)
+DEEGEN_DEFINE_LIB_FUNC(array_atallput)
 {
-    SOM_LOG_PRIMITIVE_FREQ(string_primsubstring);
+    SOM_LOG_PRIMITIVE_FREQ(array_atallput);
 
     TValue tv = GetArg(0);
-    int32_t start = GetArg(1).As<tInt32>();
-    int32_t end = GetArg(2).As<tInt32>();
-    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
-    std::string_view str = GetStringContentFromSOMString(tv);
-    TestAssert(1 <= start && start <= end + 1 && end <= static_cast<int64_t>(str.length()));
-    SOMObject* r = SOMObject::AllocateString(str.substr(static_cast<size_t>(start - 1), static_cast<size_t>(end - start + 1)));
-    Return(TValue::Create<tObject>(TranslateToHeapPtr(r)));
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_Array);
+    HeapPtr<SOMObject> o = tv.As<tObject>();
+    SOMArrayFill(TranslateToRawPointer(&o->m_data[1]), o->m_data[0].m_value, GetArg(1));
+    Return(tv);
 }
 
-DEEGEN_DEFINE_LIB_FUNC(string_charat)
+// 'fillRandom: limit' sets every element to a uniformly random integer in [1, limit]
+//
+DEEGEN_DEFINE_LIB_FUNC(array_fillrandom)
 {
-    SOM_LOG_PRIMITIVE_FREQ(string_charat);
+    SOM_LOG_PRIMITIVE_FREQ(array_fillrandom);
 
     TValue tv = GetArg(0);
-    int32_t idx = GetArg(1).As<tInt32>();
-    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
-    std::string_view str = GetStringContentFromSOMString(tv);
-    if (unlikely(idx <= 0 || idx > static_cast<int64_t>(str.length())))
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_Array);
+    TValue limitTv = GetArg(1);
+    if (unlikely(!IsSOMInteger(limitTv) || GetSOMIntegerValue(limitTv) <= 0))
     {
-        fprintf(stderr, "String charAt out of bound: index = %d, string length = %d\n",
-                static_cast<int>(idx), static_cast<int>(str.length()));
+        fprintf(stderr, "fillRandom: limit must be a positive integer\n");
         abort();
     }
-    SOMObject* r = SOMObject::AllocateString(str.substr(static_cast<size_t>(idx - 1), 1));
-    Return(TValue::Create<tObject>(TranslateToHeapPtr(r)));
-}
-
-DEEGEN_DEFINE_LIB_FUNC(string_iswhitespace)
-{
-    SOM_LOG_PRIMITIVE_FREQ(string_iswhitespace);
-
-    TValue tv = GetArg(0);
-    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
-    std::string_view str = GetStringContentFromSOMString(tv);
-
-    size_t len = str.length();
-    if (len == 0)
+    uint64_t limit = static_cast<uint64_t>(GetSOMIntegerValue(limitTv));
+    HeapPtr<SOMObject> o = tv.As<tObject>();
+    TValue* data = TranslateToRawPointer(&o->m_data[1]);
+    size_t len = o->m_data[0].m_value;
+    SOMRandomGenerator& rng = VM_GetActiveVMForCurrentThread()->m_randomGenerator;
+    if (limit <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
     {
-        Return(TValue::Create<tBool>(false));
+        for (size_t i = 0; i < len; i++)
+        {
+            data[i] = TValue::Create<tInt32>(static_cast<int32_t>(rng.NextBelow(limit) + 1));
+        }
     }
-
-    for (size_t i = 0; i < len; i++)
+    else
     {
-        if (isspace(str[i]) == 0)
+        for (size_t i = 0; i < len; i++)
         {
-            Return(TValue::Create<tBool>(false));
+            data[i] = MakeSOMInteger(static_cast<int64_t>(rng.NextBelow(limit) + 1));
         }
     }
-    Return(TValue::Create<tBool>(true));
+    Return(tv);
 }
 
-DEEGEN_DEFINE_LIB_FUNC(string_isletters)
+// 'indexOf:' and 'contains:' find the first element 'e' such that 'e = probe'.
+//
+// An element identical to the probe is always considered equal, so the SIMD identity search finds an upper bound first,
+// and only the elements before it are compared by their '=' (natively where possible). Elements whose class overrides '='
+// are compared by calling '=' in SOM. Slot 2 holds the operation and slot 3 holds the index of the element being compared.
+//
+enum class ArraySearchOp : int32_t
 {
-    SOM_LOG_PRIMITIVE_FREQ(string_isletters);
+    IndexOf,
+    Contains
+};
 
-    TValue tv = GetArg(0);
-    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
-    std::string_view str = GetStringContentFromSOMString(tv);
+static constexpr size_t x_arraySearchOpSlot = 2;
+static constexpr size_t x_arraySearchPosSlot = 3;
+static constexpr size_t x_arraySearchCallBaseSlot = 4;
 
-    size_t len = str.length();
-    if (len == 0)
-    {
-        Return(TValue::Create<tBool>(false));
-    }
+// Scan elements starting at 'pos' for one equal to 'probe'.
+// Return true if '=' must be called in SOM on element '*idx' to continue, in which case the stack is set up for the call.
+// Otherwise '*idx' is the 0-based index of the equal element, or -1 if there is none.
+//
+static bool WARN_UNUSED ArraySearchStep(TValue* base, HeapPtr<SOMObject> arr, TValue probe, size_t pos, int64_t* idx /*out*/)
+{
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    const TValue* data = TranslateToRawPointer(&arr->m_data[1]);
+    size_t len = arr->m_data[0].m_value;
+    TestAssert(pos <= len);
+    size_t end = pos + SOMArrayFindIdentical(data + pos, len - pos, probe);
 
-    for (size_t i = 0; i < len; i++)
+    // Elements are usually of the same class, so cache the equality kind of the last object's class
+    //
+    uint32_t cachedHiddenClass = 0;
+    SOMEqualityKind cachedKind = SOMEqualityKind::Custom;
+    for (size_t i = pos; i < end; i++)
     {
-        if (isalpha(str[i]) == 0)
+        TValue e = data[i];
+        SOMEqualityKind kind;
+        if (e.Is<tObject>() && e.As<tObject>()->m_hiddenClass == cachedHiddenClass)
+        {
+            kind = cachedKind;
+        }
+        else
+        {
+            kind = GetSOMEqualityKind(vm, e);
+            if (e.Is<tObject>())
+            {
+                cachedHiddenClass = e.As<tObject>()->m_hiddenClass;
+                cachedKind = kind;
+            }
+        }
+
+        if (kind == SOMEqualityKind::Custom)
+        {
+            // Call 'e = probe'
+            //
+            GeneralHeapPointer<FunctionObject> fn = SOMClass::GetMethod(GetSOMClassOfAny(e), vm->m_strOperatorEqual);
+            TestAssert(fn.m_value != 0);
+            base[x_arraySearchPosSlot] = TValue::Create<tInt32>(static_cast<int32_t>(i));
+            TValue* callbase = base + x_arraySearchCallBaseSlot;
+            callbase[0].m_value = reinterpret_cast<uint64_t>(fn.As());
+            callbase[x_numSlotsForStackFrameHeader] = e;
+            callbase[x_numSlotsForStackFrameHeader + 1] = probe;
+            *idx = static_cast<int64_t>(i);
+            return true;
+        }
+        if (SOMValuesEqualNative(e, kind, probe))
         {
-            Return(TValue::Create<tBool>(false));
+            *idx = static_cast<int64_t>(i);
+            return false;
         }
     }
-    Return(TValue::Create<tBool>(true));
+    *idx = (end < len) ? static_cast<int64_t>(end) : -1;
+    return false;
+}
+
+static TValue WARN_UNUSED ArraySearchResult(ArraySearchOp op, int64_t idx)
+{
+    if (op == ArraySearchOp::Contains)
+    {
+        return TValue::Create<tBool>(idx >= 0);
+    }
+    return (idx >= 0) ? TValue::Create<tInt32>(static_cast<int32_t>(idx + 1)) : TValue::Create<tNil>();
+}
+
+DEEGEN_DEFINE_LIB_FUNC_CONTINUATION(array_search_cont)
+{
+    TValue* base = GetStackBase();
+    HeapPtr<SOMObject> arr = GetArg(0).As<tObject>();
+    TValue probe = GetArg(1);
+    ArraySearchOp op = static_cast<ArraySearchOp>(base[x_arraySearchOpSlot].As<tInt32>());
+    int64_t idx = base[x_arraySearchPosSlot].As<tInt32>();
+
+    if (GetReturnValuesBegin()[0].m_value == TValue::Create<tBool>(true).m_value)
+    {
+        Return(ArraySearchResult(op, idx));
+    }
+    else if (ArraySearchStep(base, arr, probe, static_cast<size_t>(idx + 1), &idx /*out*/))
+    {
+        MakeInPlaceCall(base + x_arraySearchCallBaseSlot + x_numSlotsForStackFrameHeader, 2 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(array_search_cont));
+    }
+    else
+    {
+        Return(ArraySearchResult(op, idx));
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(array_indexof)
+{
+    SOM_LOG_PRIMITIVE_FREQ(array_indexof);
+
+    TValue* base = GetStackBase();
+    TestAssert(GetArg(0).Is<tObject>() && GetArg(0).As<tObject>()->m_arrayType == SOM_Array);
+    base[x_arraySearchOpSlot] = TValue::Create<tInt32>(static_cast<int32_t>(ArraySearchOp::IndexOf));
+    int64_t idx;
+    if (ArraySearchStep(base, GetArg(0).As<tObject>(), GetArg(1), 0 /*pos*/, &idx /*out*/))
+    {
+        MakeInPlaceCall(base + x_arraySearchCallBaseSlot + x_numSlotsForStackFrameHeader, 2 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(array_search_cont));
+    }
+    else
+    {
+        Return(ArraySearchResult(ArraySearchOp::IndexOf, idx));
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(array_contains)
+{
+    SOM_LOG_PRIMITIVE_FREQ(array_contains);
+
+    TValue* base = GetStackBase();
+    TestAssert(GetArg(0).Is<tObject>() && GetArg(0).As<tObject>()->m_arrayType == SOM_Array);
+    base[x_arraySearchOpSlot] = TValue::Create<tInt32>(static_cast<int32_t>(ArraySearchOp::Contains));
+    int64_t idx;
+    if (ArraySearchStep(base, GetArg(0).As<tObject>(), GetArg(1), 0 /*pos*/, &idx /*out*/))
+    {
+        MakeInPlaceCall(base + x_arraySearchCallBaseSlot + x_numSlotsForStackFrameHeader, 2 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(array_search_cont));
+    }
+    else
+    {
+        Return(ArraySearchResult(ArraySearchOp::Contains, idx));
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_concatenate)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_concatenate);
+
+    TValue lhs = GetArg(0);
+    TValue rhs = GetArg(1);
+    TestAssert(lhs.Is<tObject>() && lhs.As<tObject>()->m_arrayType == SOM_String);
+    TestAssert(rhs.Is<tObject>() && rhs.As<tObject>()->m_arrayType == SOM_String);
+    HeapPtr<SOMObject> r = SOMObject::DoStringConcat(lhs.As<tObject>(), rhs.As<tObject>());
+    Return(TValue::Create<tObject>(r));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_assymbol)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_assymbol);
+
+    TValue tv = GetArg(0);
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    size_t ord = vm->m_interner.InternString(GetStringContentFromSOMString(tv));
+    SOMObject* o = vm->GetInternedSymbol(ord);
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(o)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_hashcode)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_hashcode);
+
+    // Use exactly SOM++'s hash implementation
+    //
+    uint32_t hash = GetHashCodeFromSOMString(GetArg(0));
+    Return(TValue::Create<tInt32>(static_cast<int32_t>(hash)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_length)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_length);
+
+    TValue tv = GetArg(0);
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    Return(TValue::Create<tInt32>(static_cast<int32_t>(tv.As<tObject>()->m_data[0].m_value)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_equal)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_equal);
+
+    TValue lhs = GetArg(0);
+    TValue rhs = GetArg(1);
+    TestAssert(lhs.Is<tObject>() && lhs.As<tObject>()->m_arrayType == SOM_String);
+
+    if (lhs.m_value == rhs.m_value) { Return(TValue::Create<tBool>(true)); }
+
+    if (!rhs.Is<tObject>()) { Return(TValue::Create<tBool>(false)); }
+    HeapPtr<SOMObject> r = rhs.As<tObject>();
+    if (r->m_arrayType != SOM_String) { Return(TValue::Create<tBool>(false)); }
+
+    HeapPtr<SOMObject> l = lhs.As<tObject>();
+    size_t len = r->m_data[0].m_value;
+    if (len != l->m_data[0].m_value) { Return(TValue::Create<tBool>(false)); }
+
+    // Symbols are interned, so two different symbol objects must have different content
+    //
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    uint32_t symbolHiddenClass = SystemHeapPointer<SOMClass>(vm->m_symbolClass).m_value;
+    if (l->m_hiddenClass == symbolHiddenClass && r->m_hiddenClass == symbolHiddenClass) { Return(TValue::Create<tBool>(false)); }
+
+    // If both hash codes are already computed, use them to quickly reject
+    //
+    if ((l->m_opaque & r->m_opaque & SOMObject::x_stringHashCodeCachedBit) != 0)
+    {
+        if (GetHashCodeFromSOMString(lhs) != GetHashCodeFromSOMString(rhs)) { Return(TValue::Create<tBool>(false)); }
+    }
+
+    bool res = SOMStringContentEqual(TranslateToRawPointer(vm, reinterpret_cast<HeapPtr<char>>(&l->m_data[1])),
+                                     TranslateToRawPointer(vm, reinterpret_cast<HeapPtr<char>>(&r->m_data[1])),
+                                     len);
+    Return(TValue::Create<tBool>(res));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_primsubstring)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_primsubstring);
+
+    TValue tv = GetArg(0);
+    int32_t start = GetArg(1).As<tInt32>();
+    int32_t end = GetArg(2).As<tInt32>();
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    std::string_view str = GetStringContentFromSOMString(tv);
+    TestAssert(1 <= start && start <= end + 1 && end <= static_cast<int64_t>(str.length()));
+    SOMObject* r = SOMObject::AllocateString(str.substr(static_cast<size_t>(start - 1), static_cast<size_t>(end - start + 1)));
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(r)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_charat)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_charat);
+
+    TValue tv = GetArg(0);
+    int32_t idx = GetArg(1).As<tInt32>();
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    std::string_view str = GetStringContentFromSOMString(tv);
+    if (unlikely(idx <= 0 || idx > static_cast<int64_t>(str.length())))
+    {
+        fprintf(stderr, "String charAt out of bound: index = %d, string length = %d\n",
+                static_cast<int>(idx), static_cast<int>(str.length()));
+        abort();
+    }
+    SOMObject* r = SOMObject::AllocateString(str.substr(static_cast<size_t>(idx - 1), 1));
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(r)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_iswhitespace)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_iswhitespace);
+
+    TValue tv = GetArg(0);
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    std::string_view str = GetStringContentFromSOMString(tv);
+
+    size_t len = str.length();
+    if (len == 0)
+    {
+        Return(TValue::Create<tBool>(false));
+    }
+
+    Return(TValue::Create<tBool>(SOMStringIsAllWhitespace(str.data(), len)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_isletters)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_isletters);
+
+    TValue tv = GetArg(0);
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    std::string_view str = GetStringContentFromSOMString(tv);
+
+    size_t len = str.length();
+    if (len == 0)
+    {
+        Return(TValue::Create<tBool>(false));
+    }
+
+    Return(TValue::Create<tBool>(SOMStringIsAllLetters(str.data(), len)));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(string_isdigits)
@@ -1698,14 +2021,85 @@ DEEGEN_DEFINE_LIB_FUNC(string_isdigits)
         Return(TValue::Create<tBool>(false));
     }
 
-    for (size_t i = 0; i < len; i++)
+    Return(TValue::Create<tBool>(SOMStringIsAllDigits(str.data(), len)));
+}
+
+// Replaces String>>indexOf:startingAt:, which is implemented in SOM by comparing a freshly allocated substring at every position
+//
+DEEGEN_DEFINE_LIB_FUNC(string_indexof_startingat)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_indexof_startingat);
+
+    TValue tv = GetArg(0);
+    TValue needleTv = GetArg(1);
+    int64_t start;
+    if (unlikely(!TryGetSOMIntegerValue(GetArg(2), &start /*out*/)))
     {
-        if (isdigit(str[i]) == 0)
-        {
-            Return(TValue::Create<tBool>(false));
-        }
+        fprintf(stderr, "indexOf:startingAt: start index must be an integer\n");
+        abort();
     }
-    Return(TValue::Create<tBool>(true));
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    if (!needleTv.Is<tObject>() || needleTv.As<tObject>()->m_arrayType != SOM_String)
+    {
+        Return(TValue::Create<tInt32>(-1));
+    }
+    std::string_view str = GetStringContentFromSOMString(tv);
+    std::string_view needle = GetStringContentFromSOMString(needleTv);
+    // Same as the SOM implementation: a start index too large for the needle to fit (even for an empty needle) is not found,
+    // otherwise the start index must be valid, and an empty needle is found at the start index
+    //
+    if (start > static_cast<int64_t>(str.length()) + 1 - static_cast<int64_t>(needle.length()))
+    {
+        Return(TValue::Create<tInt32>(-1));
+    }
+    if (unlikely(start < 1))
+    {
+        fprintf(stderr, "indexOf:startingAt: start index out of bound: start = %lld, string length = %d\n",
+                static_cast<long long>(start), static_cast<int>(str.length()));
+        abort();
+    }
+    ssize_t res = SOMStringFindSubstring(str.data(), str.length(), needle.data(), needle.length(), static_cast<size_t>(start - 1));
+    Return(TValue::Create<tInt32>((res < 0) ? -1 : static_cast<int32_t>(res + 1)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_beginswith)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_beginswith);
+
+    TValue tv = GetArg(0);
+    TValue prefixTv = GetArg(1);
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    if (!prefixTv.Is<tObject>() || prefixTv.As<tObject>()->m_arrayType != SOM_String)
+    {
+        Return(TValue::Create<tBool>(false));
+    }
+    std::string_view str = GetStringContentFromSOMString(tv);
+    std::string_view prefix = GetStringContentFromSOMString(prefixTv);
+    if (str.length() < prefix.length())
+    {
+        Return(TValue::Create<tBool>(false));
+    }
+    Return(TValue::Create<tBool>(SOMStringContentEqual(str.data(), prefix.data(), prefix.length())));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(string_endswith)
+{
+    SOM_LOG_PRIMITIVE_FREQ(string_endswith);
+
+    TValue tv = GetArg(0);
+    TValue suffixTv = GetArg(1);
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    if (!suffixTv.Is<tObject>() || suffixTv.As<tObject>()->m_arrayType != SOM_String)
+    {
+        Return(TValue::Create<tBool>(false));
+    }
+    std::string_view str = GetStringContentFromSOMString(tv);
+    std::string_view suffix = GetStringContentFromSOMString(suffixTv);
+    if (str.length() < suffix.length())
+    {
+        Return(TValue::Create<tBool>(false));
+    }
+    Return(TValue::Create<tBool>(SOMStringContentEqual(str.data() + str.length() - suffix.length(), suffix.data(), suffix.length())));
 }
 
 DEEGEN_DEFINE_LIB_FUNC(symbol_asstring)
@@ -1720,16 +2114,783 @@ DEEGEN_DEFINE_LIB_FUNC(symbol_asstring)
     Return(TValue::Create<tObject>(TranslateToHeapPtr(o)));
 }
 
-DEEGEN_DEFINE_LIB_FUNC(unimplemented_primitive)
+// The HashMap primitives, see som_hash_table.h
+//
+// If the key is a custom key (a key whose class overrides '='), the primitive first calls 'hashcode' on it in SOM,
+// then probes the index and calls '=' in SOM on each custom entry with the same hash.
+// The state of the lookup is kept in the stack slots after the arguments: the operation, the hash of the key,
+// the index slot of the entry being compared, and the epoch of the table being probed.
+//
+enum class HashMapOp : int32_t
 {
-    HeapPtr<FunctionObject> f = GetStackFrameHeader()->m_func;
-    TestAssert(f->m_numUpvalues == 1);
-    TValue str = TCGet(f->m_upvalues[0]);
-    TestAssert(str.Is<tObject>());
-    HeapPtr<SOMObject> o = str.As<tObject>();
-    TestAssert(o->m_arrayType == SOM_String);
-    fprintf(stderr, "Unimplemented primitive %s!\n", reinterpret_cast<char*>(TranslateToRawPointer(&o->m_data[1])));
-    abort();
+    At,
+    AtPut,
+    ContainsKey,
+    RemoveKey
+};
+
+static constexpr size_t x_hashMapSlowLookupOpSlot = 3;
+static constexpr size_t x_hashMapSlowLookupHashSlot = 4;
+static constexpr size_t x_hashMapSlowLookupProbeSlot = 5;
+static constexpr size_t x_hashMapSlowLookupEpochSlot = 6;
+static constexpr size_t x_hashMapSlowLookupCallBaseSlot = 7;
+
+// Compute the result of 'op' given the ordinal of the entry equal to 'key' (-1 if not found)
+//
+static TValue WARN_UNUSED HashMapCompleteOp(HashMapOp op, TValue hashMap, TValue key, SOMHashTable::KeyInfo ki, TValue value, int64_t ord)
+{
+    SOMHashTable* ht = SOMHashTable::Get(hashMap);
+    switch (op)
+    {
+    case HashMapOp::At:
+    {
+        return (ord >= 0) ? ht->m_entries[ord].m_value : TValue::Create<tNil>();
+    }
+    case HashMapOp::AtPut:
+    {
+        if (ord >= 0)
+        {
+            ht->m_entries[ord].m_value = value;
+        }
+        else
+        {
+            SOMHashTable::Insert(hashMap.As<tObject>(), key, ki, value);
+        }
+        return hashMap;
+    }
+    case HashMapOp::ContainsKey:
+    {
+        return TValue::Create<tBool>(ord >= 0);
+    }
+    case HashMapOp::RemoveKey:
+    {
+        if (ord < 0)
+        {
+            return TValue::Create<tNil>();
+        }
+        TValue result = ht->m_entries[ord].m_value;
+        ht->RemoveEntry(static_cast<uint32_t>(ord));
+        return result;
+    }
+    }   /*switch*/
+    __builtin_unreachable();
+}
+
+// Set up the stack to call 'key hashcode', the first step of the lookup of a custom key
+//
+static void HashMapSetupHashcodeCall(TValue* base, TValue key)
+{
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    GeneralHeapPointer<FunctionObject> fn = SOMClass::GetMethod(GetSOMClassOfAny(key), vm->m_strHashcode);
+    TestAssert(fn.m_value != 0);
+    TValue* callbase = base + x_hashMapSlowLookupCallBaseSlot;
+    callbase[0].m_value = reinterpret_cast<uint64_t>(fn.As());
+    callbase[x_numSlotsForStackFrameHeader] = key;
+}
+
+static SOMHashTable::KeyInfo WARN_UNUSED HashMapGetCustomKeyInfo(TValue* base)
+{
+    return {
+        .m_kind = SOMHashTable::KeyKind::Custom,
+        .m_hash = static_cast<uint32_t>(base[x_hashMapSlowLookupHashSlot].As<tInt32>())
+    };
+}
+
+// Continue probing the index for the custom key 'key' starting at index slot 'slot'.
+// Return true if '=' must be called in SOM on entry '*ord' to continue, in which case the stack is set up for the call.
+// Otherwise '*ord' is the result of the lookup.
+//
+static bool WARN_UNUSED HashMapCustomLookupStep(TValue* base, TValue hashMap, TValue key, uint32_t slot, int64_t* ord /*out*/)
+{
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    SOMHashTable* ht = SOMHashTable::Get(hashMap);
+    uint32_t hash = HashMapGetCustomKeyInfo(base).m_hash;
+    *ord = ht->FindCustomCandidate(hash, &slot /*inout*/);
+    if (*ord < 0)
+    {
+        return false;
+    }
+    TValue entryKey = ht->m_entries[*ord].m_key;
+    if (entryKey.m_value == key.m_value)
+    {
+        return false;
+    }
+
+    // Call 'entryKey = key'
+    //
+    GeneralHeapPointer<FunctionObject> fn = SOMClass::GetMethod(GetSOMClassOfAny(entryKey), vm->m_strOperatorEqual);
+    TestAssert(fn.m_value != 0);
+    base[x_hashMapSlowLookupProbeSlot] = TValue::Create<tInt32>(static_cast<int32_t>(slot));
+    TValue* callbase = base + x_hashMapSlowLookupCallBaseSlot;
+    callbase[0].m_value = reinterpret_cast<uint64_t>(fn.As());
+    callbase[x_numSlotsForStackFrameHeader] = entryKey;
+    callbase[x_numSlotsForStackFrameHeader + 1] = key;
+    return true;
+}
+
+DEEGEN_DEFINE_LIB_FUNC_CONTINUATION(hashmap_slowlookup_cont)
+{
+    TValue* base = GetStackBase();
+    TValue hashMap = GetArg(0);
+    TValue key = GetArg(1);
+    HashMapOp op = static_cast<HashMapOp>(base[x_hashMapSlowLookupOpSlot].As<tInt32>());
+    TValue value = (op == HashMapOp::AtPut) ? GetArg(2) : TValue::Create<tNil>();
+    SOMHashTable::KeyInfo ki = HashMapGetCustomKeyInfo(base);
+
+    // The '=' call may have modified the table. If it has been rehashed, the probe has to start over in the new index.
+    // Otherwise the index slot still refers to the same entry (the index is only ever appended to), but the entry may have been removed.
+    //
+    SOMHashTable* ht = SOMHashTable::Get(hashMap);
+    uint32_t slot = static_cast<uint32_t>(base[x_hashMapSlowLookupProbeSlot].As<tInt32>());
+    int64_t ord = -1;
+    bool isEqual = false;
+    if (static_cast<uint32_t>(base[x_hashMapSlowLookupEpochSlot].As<tInt32>()) != ht->m_epoch)
+    {
+        base[x_hashMapSlowLookupEpochSlot] = TValue::Create<tInt32>(static_cast<int32_t>(ht->m_epoch));
+        slot = ki.m_hash;
+    }
+    else
+    {
+        ord = static_cast<int64_t>(ht->GetIndex()[slot]) - 1;
+        TestAssert(ord >= 0);
+        isEqual = (GetReturnValuesBegin()[0].m_value == TValue::Create<tBool>(true).m_value);
+        isEqual = isEqual && ht->m_entries[ord].m_kind == SOMHashTable::KeyKind::Custom;
+        slot++;
+    }
+    if (!isEqual && HashMapCustomLookupStep(base, hashMap, key, slot, &ord /*out*/))
+    {
+        MakeInPlaceCall(base + x_hashMapSlowLookupCallBaseSlot + x_numSlotsForStackFrameHeader, 2 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_slowlookup_cont));
+    }
+    else
+    {
+        Return(HashMapCompleteOp(op, hashMap, key, ki, value, ord));
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC_CONTINUATION(hashmap_hashcode_cont)
+{
+    TValue* base = GetStackBase();
+    TValue hashMap = GetArg(0);
+    TValue key = GetArg(1);
+    HashMapOp op = static_cast<HashMapOp>(base[x_hashMapSlowLookupOpSlot].As<tInt32>());
+    TValue value = (op == HashMapOp::AtPut) ? GetArg(2) : TValue::Create<tNil>();
+
+    int64_t hashcode;
+    if (unlikely(!TryGetSOMIntegerValue(GetReturnValuesBegin()[0], &hashcode /*out*/)))
+    {
+        fprintf(stderr, "HashMap: hashcode must return an integer\n");
+        abort();
+    }
+    uint32_t hash = SOMHashTable::HashCustomKey(hashcode);
+    base[x_hashMapSlowLookupHashSlot] = TValue::Create<tInt32>(static_cast<int32_t>(hash));
+    base[x_hashMapSlowLookupEpochSlot] = TValue::Create<tInt32>(static_cast<int32_t>(SOMHashTable::Get(hashMap)->m_epoch));
+    int64_t ord;
+    if (HashMapCustomLookupStep(base, hashMap, key, hash /*slot*/, &ord /*out*/))
+    {
+        MakeInPlaceCall(base + x_hashMapSlowLookupCallBaseSlot + x_numSlotsForStackFrameHeader, 2 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_slowlookup_cont));
+    }
+    else
+    {
+        Return(HashMapCompleteOp(op, hashMap, key, HashMapGetCustomKeyInfo(base), value, ord));
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_new)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_new);
+
+    SOMObject* o = SOMHashTable::AllocateHashMapObject(GetClassFromClassObject(GetArg(0)), false /*isIdentity*/);
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(o)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_newidentity)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_newidentity);
+
+    SOMObject* o = SOMHashTable::AllocateHashMapObject(GetClassFromClassObject(GetArg(0)), true /*isIdentity*/);
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(o)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_at)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_at);
+
+    TValue hashMap = GetArg(0);
+    TValue key = GetArg(1);
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    SOMHashTable* ht = SOMHashTable::Get(hashMap);
+    SOMHashTable::KeyInfo ki = ht->ClassifyKey(vm, key);
+    if (likely(ki.m_kind != SOMHashTable::KeyKind::Custom))
+    {
+        int64_t ord = ht->FindNative(key, ki);
+        Return((ord >= 0) ? ht->m_entries[ord].m_value : TValue::Create<tNil>());
+    }
+
+    TValue* base = GetStackBase();
+    base[x_hashMapSlowLookupOpSlot] = TValue::Create<tInt32>(static_cast<int32_t>(HashMapOp::At));
+    HashMapSetupHashcodeCall(base, key);
+    MakeInPlaceCall(base + x_hashMapSlowLookupCallBaseSlot + x_numSlotsForStackFrameHeader, 1 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_hashcode_cont));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_at_put)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_at_put);
+
+    TValue hashMap = GetArg(0);
+    TValue key = GetArg(1);
+    TValue value = GetArg(2);
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    SOMHashTable* ht = SOMHashTable::Get(hashMap);
+    SOMHashTable::KeyInfo ki = ht->ClassifyKey(vm, key);
+    if (likely(ki.m_kind != SOMHashTable::KeyKind::Custom))
+    {
+        int64_t ord = ht->FindNative(key, ki);
+        if (ord >= 0)
+        {
+            ht->m_entries[ord].m_value = value;
+        }
+        else
+        {
+            SOMHashTable::Insert(hashMap.As<tObject>(), key, ki, value);
+        }
+        Return(hashMap);
+    }
+
+    TValue* base = GetStackBase();
+    base[x_hashMapSlowLookupOpSlot] = TValue::Create<tInt32>(static_cast<int32_t>(HashMapOp::AtPut));
+    HashMapSetupHashcodeCall(base, key);
+    MakeInPlaceCall(base + x_hashMapSlowLookupCallBaseSlot + x_numSlotsForStackFrameHeader, 1 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_hashcode_cont));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_containskey)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_containskey);
+
+    TValue hashMap = GetArg(0);
+    TValue key = GetArg(1);
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    SOMHashTable* ht = SOMHashTable::Get(hashMap);
+    SOMHashTable::KeyInfo ki = ht->ClassifyKey(vm, key);
+    if (likely(ki.m_kind != SOMHashTable::KeyKind::Custom))
+    {
+        Return(TValue::Create<tBool>(ht->FindNative(key, ki) >= 0));
+    }
+
+    TValue* base = GetStackBase();
+    base[x_hashMapSlowLookupOpSlot] = TValue::Create<tInt32>(static_cast<int32_t>(HashMapOp::ContainsKey));
+    HashMapSetupHashcodeCall(base, key);
+    MakeInPlaceCall(base + x_hashMapSlowLookupCallBaseSlot + x_numSlotsForStackFrameHeader, 1 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_hashcode_cont));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_removekey)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_removekey);
+
+    TValue hashMap = GetArg(0);
+    TValue key = GetArg(1);
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    SOMHashTable* ht = SOMHashTable::Get(hashMap);
+    SOMHashTable::KeyInfo ki = ht->ClassifyKey(vm, key);
+    if (likely(ki.m_kind != SOMHashTable::KeyKind::Custom))
+    {
+        int64_t ord = ht->FindNative(key, ki);
+        Return(HashMapCompleteOp(HashMapOp::RemoveKey, hashMap, key, ki, TValue::Create<tNil>(), ord));
+    }
+
+    TValue* base = GetStackBase();
+    base[x_hashMapSlowLookupOpSlot] = TValue::Create<tInt32>(static_cast<int32_t>(HashMapOp::RemoveKey));
+    HashMapSetupHashcodeCall(base, key);
+    MakeInPlaceCall(base + x_hashMapSlowLookupCallBaseSlot + x_numSlotsForStackFrameHeader, 1 /*numArgs*/, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_hashcode_cont));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_size)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_size);
+
+    Return(TValue::Create<tInt32>(static_cast<int32_t>(SOMHashTable::Get(GetArg(0))->m_count)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_removeall)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_removeall);
+
+    TValue hashMap = GetArg(0);
+    SOMHashTable::Clear(hashMap.As<tObject>());
+    Return(hashMap);
+}
+
+// Return an Array of the keys (or values) in insertion order
+//
+static TValue WARN_UNUSED HashMapCollectToArray(TValue hashMap, bool collectValues)
+{
+    SOMHashTable* ht = SOMHashTable::Get(hashMap);
+    SOMObject* arr = SOMObject::AllocateArray(ht->m_count);
+    size_t k = 1;
+    for (uint32_t i = 0; i < ht->m_numUsed; i++)
+    {
+        const SOMHashTable::Entry& entry = ht->m_entries[i];
+        if (entry.m_kind != SOMHashTable::KeyKind::Deleted)
+        {
+            arr->m_data[k] = collectValues ? entry.m_value : entry.m_key;
+            k++;
+        }
+    }
+    TestAssert(k == ht->m_count + 1);
+    return TValue::Create<tObject>(TranslateToHeapPtr(arr));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_keys)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_keys);
+
+    Return(HashMapCollectToArray(GetArg(0), false /*collectValues*/));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_values)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_values);
+
+    Return(HashMapCollectToArray(GetArg(0), true /*collectValues*/));
+}
+
+// The HashMap iteration primitives call the block on each live entry in insertion order.
+// The block may modify the HashMap, and a rehash moves the entries, so the keys (and/or values) are first copied to Arrays,
+// and the iteration visits the entries as of the start of the iteration.
+// The snapshot Arrays, the index of the next entry to visit and the iteration kind are kept in the stack slots after the arguments.
+//
+enum class HashMapIterKind : int32_t
+{
+    Keys,
+    Values,
+    KeysAndValues
+};
+
+static constexpr size_t x_hashMapIterPosSlot = 2;
+static constexpr size_t x_hashMapIterKindSlot = 3;
+static constexpr size_t x_hashMapIterKeysSlot = 4;
+static constexpr size_t x_hashMapIterValuesSlot = 5;
+static constexpr size_t x_hashMapIterCallBaseSlot = 6;
+
+// Find the next entry and set up the stack to call the block on it
+// Return false if the iteration is finished, otherwise '*numArgs' is set to the number of arguments of the call
+//
+static bool WARN_UNUSED HashMapIterStep(TValue* base, TValue block, size_t* numArgs /*out*/)
+{
+    HashMapIterKind kind = static_cast<HashMapIterKind>(base[x_hashMapIterKindSlot].As<tInt32>());
+    HeapPtr<SOMObject> arr = base[(kind == HashMapIterKind::Values) ? x_hashMapIterValuesSlot : x_hashMapIterKeysSlot].As<tObject>();
+    uint32_t pos = static_cast<uint32_t>(base[x_hashMapIterPosSlot].As<tInt32>());
+    if (pos >= arr->m_data[0].m_value)
+    {
+        return false;
+    }
+    base[x_hashMapIterPosSlot] = TValue::Create<tInt32>(static_cast<int32_t>(pos + 1));
+    TValue arg1 = TCGet(arr->m_data[pos + 1]);
+    TValue arg2 = TValue::Create<tNil>();
+    if (kind == HashMapIterKind::KeysAndValues)
+    {
+        arg2 = TCGet(base[x_hashMapIterValuesSlot].As<tObject>()->m_data[pos + 1]);
+    }
+    TestAssert(block.Is<tFunction>());
+    *numArgs = SetupStackForBlockCall(base + x_hashMapIterCallBaseSlot, block, arg1, arg2);
+    return true;
+}
+
+// Take the snapshot and set up the iteration state
+//
+static void HashMapIterInit(TValue* base, TValue hashMap, HashMapIterKind kind)
+{
+    base[x_hashMapIterPosSlot] = TValue::Create<tInt32>(0);
+    base[x_hashMapIterKindSlot] = TValue::Create<tInt32>(static_cast<int32_t>(kind));
+    base[x_hashMapIterKeysSlot] = (kind != HashMapIterKind::Values) ? HashMapCollectToArray(hashMap, false /*collectValues*/) : TValue::Create<tNil>();
+    base[x_hashMapIterValuesSlot] = (kind != HashMapIterKind::Keys) ? HashMapCollectToArray(hashMap, true /*collectValues*/) : TValue::Create<tNil>();
+}
+
+DEEGEN_DEFINE_LIB_FUNC_CONTINUATION(hashmap_iter_cont)
+{
+    TValue* base = GetStackBase();
+    size_t numArgs;
+    if (HashMapIterStep(base, GetArg(1), &numArgs /*out*/))
+    {
+        MakeInPlaceCall(base + x_hashMapIterCallBaseSlot + x_numSlotsForStackFrameHeader, numArgs, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_iter_cont));
+    }
+    else
+    {
+        Return(GetArg(0));
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_keysdo)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_keysdo);
+
+    TValue* base = GetStackBase();
+    TValue hashMap = GetArg(0);
+    if (SOMHashTable::Get(hashMap)->m_count == 0)
+    {
+        Return(hashMap);
+    }
+    HashMapIterInit(base, hashMap, HashMapIterKind::Keys);
+    size_t numArgs;
+    if (HashMapIterStep(base, GetArg(1), &numArgs /*out*/))
+    {
+        MakeInPlaceCall(base + x_hashMapIterCallBaseSlot + x_numSlotsForStackFrameHeader, numArgs, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_iter_cont));
+    }
+    else
+    {
+        Return(hashMap);
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_valuesdo)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_valuesdo);
+
+    TValue* base = GetStackBase();
+    TValue hashMap = GetArg(0);
+    if (SOMHashTable::Get(hashMap)->m_count == 0)
+    {
+        Return(hashMap);
+    }
+    HashMapIterInit(base, hashMap, HashMapIterKind::Values);
+    size_t numArgs;
+    if (HashMapIterStep(base, GetArg(1), &numArgs /*out*/))
+    {
+        MakeInPlaceCall(base + x_hashMapIterCallBaseSlot + x_numSlotsForStackFrameHeader, numArgs, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_iter_cont));
+    }
+    else
+    {
+        Return(hashMap);
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(hashmap_keysandvaluesdo)
+{
+    SOM_LOG_PRIMITIVE_FREQ(hashmap_keysandvaluesdo);
+
+    TValue* base = GetStackBase();
+    TValue hashMap = GetArg(0);
+    if (SOMHashTable::Get(hashMap)->m_count == 0)
+    {
+        Return(hashMap);
+    }
+    HashMapIterInit(base, hashMap, HashMapIterKind::KeysAndValues);
+    size_t numArgs;
+    if (HashMapIterStep(base, GetArg(1), &numArgs /*out*/))
+    {
+        MakeInPlaceCall(base + x_hashMapIterCallBaseSlot + x_numSlotsForStackFrameHeader, numArgs, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(hashmap_iter_cont));
+    }
+    else
+    {
+        Return(hashMap);
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_new)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_new);
+
+    TValue capacity = GetArg(1);
+    if (unlikely(!capacity.Is<tInt32>() || capacity.As<tInt32>() < 0))
+    {
+        fprintf(stderr, "Vector new: expects a non-negative integer\n");
+        abort();
+    }
+    SOMObject* o = SOMVector::Allocate(GetClassFromClassObject(GetArg(0)), static_cast<size_t>(capacity.As<tInt32>()));
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(o)));
+}
+
+// Out-of-range reads return nil (the interpreter and JIT fast path only handles in-range indices)
+//
+DEEGEN_DEFINE_LIB_FUNC(vector_at)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_at);
+
+    HeapPtr<SOMObject> o = GetArg(0).As<tObject>();
+    TValue idx = GetArg(1);
+    if (unlikely(!idx.Is<tInt32>()))
+    {
+        if (!IsSOMLargeInteger(idx))
+        {
+            fprintf(stderr, "Vector primAt: expects an integer index\n");
+            abort();
+        }
+        Return(TValue::Create<tNil>());
+    }
+    if (static_cast<uint32_t>(idx.As<tInt32>()) - 1 >= SOMVector::GetSize(o))
+    {
+        Return(TValue::Create<tNil>());
+    }
+    Return(SOMVector::GetBegin(o)[idx.As<tInt32>() - 1]);
+}
+
+// Writes past the end grow the vector, filling the gap with nil
+//
+DEEGEN_DEFINE_LIB_FUNC(vector_at_put)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_at_put);
+
+    TValue self = GetArg(0);
+    TValue idx = GetArg(1);
+    if (unlikely(!idx.Is<tInt32>()))
+    {
+        if (!IsSOMLargeInteger(idx))
+        {
+            fprintf(stderr, "Vector primAt:put: expects an integer index\n");
+            abort();
+        }
+        fprintf(stderr, "Vector write out of bound: index = %lld\n", static_cast<long long>(GetSOMLargeIntegerValue(idx)));
+        abort();
+    }
+    if (unlikely(idx.As<tInt32>() < 1))
+    {
+        fprintf(stderr, "Vector write out of bound: index = %d\n", static_cast<int>(idx.As<tInt32>()));
+        abort();
+    }
+    SOMVector::SetAndGrow(self.As<tObject>(), static_cast<size_t>(idx.As<tInt32>()), GetArg(2));
+    Return(self);
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_append)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_append);
+
+    TValue self = GetArg(0);
+    SOMVector::Append(self.As<tObject>(), GetArg(1));
+    Return(self);
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_removefirst)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_removefirst);
+
+    Return(SOMVector::RemoveFirst(GetArg(0).As<tObject>()));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_removelast)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_removelast);
+
+    Return(SOMVector::RemoveLast(GetArg(0).As<tObject>()));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_remove)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_remove);
+
+    Return(TValue::Create<tBool>(SOMVector::RemoveIdentical(GetArg(0).As<tObject>(), GetArg(1))));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_removeall)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_removeall);
+
+    TValue self = GetArg(0);
+    SOMVector::RemoveAll(self.As<tObject>());
+    Return(self);
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_first)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_first);
+
+    HeapPtr<SOMObject> o = GetArg(0).As<tObject>();
+    Return((SOMVector::GetSize(o) > 0) ? SOMVector::GetBegin(o)[0] : TValue::Create<tNil>());
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_last)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_last);
+
+    HeapPtr<SOMObject> o = GetArg(0).As<tObject>();
+    size_t size = SOMVector::GetSize(o);
+    Return((size > 0) ? SOMVector::GetBegin(o)[size - 1] : TValue::Create<tNil>());
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_size)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_size);
+
+    Return(TValue::Create<tInt32>(static_cast<int32_t>(SOMVector::GetSize(GetArg(0).As<tObject>()))));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_isempty)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_isempty);
+
+    Return(TValue::Create<tBool>(SOMVector::GetSize(GetArg(0).As<tObject>()) == 0));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_capacity)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_capacity);
+
+    Return(TValue::Create<tInt32>(static_cast<int32_t>(SOMVector::GetCapacity(GetArg(0).As<tObject>()))));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_asarray)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_asarray);
+
+    SOMObject* arr = SOMVector::ToArray(GetArg(0).As<tObject>());
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(arr)));
+}
+
+// 'do:' calls the block on each element in order. Slot 2 holds the logical position (see SOMVector) of the next element to visit,
+// and slot 3 holds the logical position of the end of the vector when the iteration started.
+// Same as 'first to: last - 1 do:' in the SOM implementation, elements appended during the iteration are not visited,
+// and removing elements from the front does not make the iteration skip the remaining ones.
+//
+static constexpr size_t x_vectorIterPosSlot = 2;
+static constexpr size_t x_vectorIterEndSlot = 3;
+static constexpr size_t x_vectorIterCallBaseSlot = 4;
+
+// Set up the stack to call the block on the next element, return false if the iteration is finished
+//
+static bool WARN_UNUSED VectorIterStep(TValue* base, HeapPtr<SOMObject> o, TValue block, size_t* numArgs /*out*/)
+{
+    uint64_t pos = base[x_vectorIterPosSlot].m_value;
+    uint64_t numRemovedFromFront = SOMVector::GetNumRemovedFromFront(o);
+    // Elements removed from the front during the iteration are no longer in the vector
+    //
+    pos = std::max(pos, numRemovedFromFront);
+    if (pos >= base[x_vectorIterEndSlot].m_value)
+    {
+        return false;
+    }
+    size_t idx = pos - numRemovedFromFront;
+    if (idx >= SOMVector::GetSize(o))
+    {
+        return false;
+    }
+    base[x_vectorIterPosSlot].m_value = pos + 1;
+    *numArgs = SetupStackForBlockCall(base + x_vectorIterCallBaseSlot, block, SOMVector::GetBegin(o)[idx], TValue::Create<tNil>());
+    return true;
+}
+
+DEEGEN_DEFINE_LIB_FUNC_CONTINUATION(vector_do_cont)
+{
+    TValue* base = GetStackBase();
+    TValue self = GetArg(0);
+    size_t numArgs;
+    if (VectorIterStep(base, self.As<tObject>(), GetArg(1), &numArgs /*out*/))
+    {
+        MakeInPlaceCall(base + x_vectorIterCallBaseSlot + x_numSlotsForStackFrameHeader, numArgs, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(vector_do_cont));
+    }
+    else
+    {
+        Return(self);
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(vector_do)
+{
+    SOM_LOG_PRIMITIVE_FREQ(vector_do);
+
+    TValue* base = GetStackBase();
+    TValue self = GetArg(0);
+    if (unlikely(!GetArg(1).Is<tFunction>()))
+    {
+        fprintf(stderr, "Vector do: expects a block\n");
+        abort();
+    }
+    HeapPtr<SOMObject> o = self.As<tObject>();
+    base[x_vectorIterPosSlot].m_value = SOMVector::GetNumRemovedFromFront(o);
+    base[x_vectorIterEndSlot].m_value = SOMVector::GetNumRemovedFromFront(o) + SOMVector::GetSize(o);
+    size_t numArgs;
+    if (VectorIterStep(base, o, GetArg(1), &numArgs /*out*/))
+    {
+        MakeInPlaceCall(base + x_vectorIterCallBaseSlot + x_numSlotsForStackFrameHeader, numArgs, DEEGEN_LIB_FUNC_RETURN_CONTINUATION(vector_do_cont));
+    }
+    else
+    {
+        Return(self);
+    }
+}
+
+DEEGEN_DEFINE_LIB_FUNC(unimplemented_primitive)
+{
+    HeapPtr<FunctionObject> f = GetStackFrameHeader()->m_func;
+    TestAssert(f->m_numUpvalues == 1);
+    TValue str = TCGet(f->m_upvalues[0]);
+    TestAssert(str.Is<tObject>());
+    HeapPtr<SOMObject> o = str.As<tObject>();
+    TestAssert(o->m_arrayType == SOM_String);
+    fprintf(stderr, "Unimplemented primitive %s!\n", reinterpret_cast<char*>(TranslateToRawPointer(&o->m_data[1])));
+    abort();
+}
+
+DEEGEN_DEFINE_LIB_FUNC(filereader_open)
+{
+    SOM_LOG_PRIMITIVE_FREQ(filereader_open);
+
+    std::string_view fileName = GetStringContentFromSOMString(GetArg(1));
+    SOMObject* o = SOMFileReader::Open(GetClassFromClassObject(GetArg(0)), fileName.data());
+    if (o == nullptr)
+    {
+        Return(TValue::Create<tNil>());
+    }
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(o)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(filereader_nextline)
+{
+    SOM_LOG_PRIMITIVE_FREQ(filereader_nextline);
+
+    SOMFileReader* reader = SOMFileReader::Get(GetArg(0));
+    if (reader->IsAtEnd())
+    {
+        Return(TValue::Create<tNil>());
+    }
+    SOMObject* res = SOMObject::AllocateString(reader->NextLine());
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(res)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(filereader_next)
+{
+    SOM_LOG_PRIMITIVE_FREQ(filereader_next);
+
+    SOMFileReader* reader = SOMFileReader::Get(GetArg(0));
+    TValue count = GetArg(1);
+    if (unlikely(!count.Is<tInt32>() || count.As<tInt32>() <= 0))
+    {
+        fprintf(stderr, "FileReader next: count must be a positive integer\n");
+        abort();
+    }
+    if (reader->IsAtEnd())
+    {
+        Return(TValue::Create<tNil>());
+    }
+    SOMObject* res = SOMObject::AllocateString(reader->NextChunk(static_cast<size_t>(count.As<tInt32>())));
+    Return(TValue::Create<tObject>(TranslateToHeapPtr(res)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(filereader_atend)
+{
+    SOM_LOG_PRIMITIVE_FREQ(filereader_atend);
+
+    Return(TValue::Create<tBool>(SOMFileReader::Get(GetArg(0))->IsAtEnd()));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(filereader_position)
+{
+    SOM_LOG_PRIMITIVE_FREQ(filereader_position);
+
+    Return(MakeSOMInteger(static_cast<int64_t>(SOMFileReader::Get(GetArg(0))->m_pos)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(filereader_size)
+{
+    SOM_LOG_PRIMITIVE_FREQ(filereader_size);
+
+    Return(MakeSOMInteger(static_cast<int64_t>(SOMFileReader::Get(GetArg(0))->m_file.m_size)));
+}
+
+DEEGEN_DEFINE_LIB_FUNC(filereader_close)
+{
+    SOM_LOG_PRIMITIVE_FREQ(filereader_close);
+
+    SOMFileReader::Get(GetArg(0))->Close();
+    Return(GetArg(0));
 }
 
 DEEGEN_END_LIB_FUNC_DEFINITIONS
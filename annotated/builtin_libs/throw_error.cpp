@@ -2,6 +2,7 @@
 #include "runtime_utils.h"
 #include "som_class.h"
 #include "som_utils.h"
+#include "deegen_options.h"
 
 #ifdef ENABLE_SOM_PROFILE_FREQUENCY
 #define SOM_LOG_PRIMITIVE_FREQ(name) do { VM_GetActiveVMForCurrentThread()->IncrementPrimitiveFuncCallCount(PP_STRINGIFY(name)); } while (false)
@@ -19,6 +20,38 @@ static bool WARN_UNUSED ALWAYS_INLINE IsClosureMethod(HeapPtr<FunctionObject> fu
     return fnTy == SOM_Method;
 }
 
+// A non-local return unwinds the frames between the throwing block (exclusive) and its home method (inclusive) without executing
+// their return bytecodes, so update the interpreter tier-up counter of each of them the same way a return would.
+// Otherwise a method that usually exits through a non-local return would never tier up.
+// The throwing block itself is already handled by the ThrowError API.
+//
+static void NO_INLINE UpdateInterpreterTierUpCounterForUnwoundFrames(StackFrameHeader* hdr, StackFrameHeader* homeHdr)
+{
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    while (hdr != homeHdr)
+    {
+        StackFrameHeader* callerHdr = reinterpret_cast<StackFrameHeader*>(hdr->m_caller) - 1;
+        ExecutableCode* ec = TranslateToRawPointer(vm, TranslateToRawPointer(vm, callerHdr->m_func)->m_executable.As());
+        // Once a function has baseline JIT code, its interpreter tier-up counter is no longer used,
+        // and its frame may be running JIT code, in which case m_callerBytecodePtr does not point at a bytecode
+        //
+        if (ec->IsBytecodeFunction() && static_cast<CodeBlock*>(ec)->m_baselineCodeBlock == nullptr)
+        {
+            CodeBlock* cb = static_cast<CodeBlock*>(ec);
+            // The bytecode the caller is executing is recorded in the header of its callee
+            //
+            uint8_t* curBytecode = TranslateToRawPointer(hdr->m_callerBytecodePtr.As());
+            TestAssert(cb->GetBytecodeStream() <= curBytecode && curBytecode < cb->GetBytecodeStream() + cb->m_bytecodeLengthIncludingTailPadding);
+            // Same as the UpdateInterpreterTierUpCounterForReturnOrThrow snippet
+            //
+            ssize_t diff = curBytecode - cb->GetBytecodeStream();
+            diff += sizeof(CodeBlock);
+            cb->m_interpreterTierUpCounter -= diff;
+        }
+        hdr = callerHdr;
+    }
+}
+
 DEEGEN_DEFINE_LIB_FUNC_CONTINUATION(EscapedBlockReturnCont)
 {
     // If the escapedBlock handler returns, the block should not throw,
@@ -46,75 +79,66 @@ DEEGEN_DEFINE_LIB_FUNC(DeegenInternal_ThrowTValueErrorImpl)
 
     // The block that triggered this non-local return
     //
-    StackFrameHeader* curHdr = hdr;
-    HeapPtr<FunctionObject> block = curHdr->m_func;
+    HeapPtr<FunctionObject> block = hdr->m_func;
     TestAssert(!IsClosureMethod(block));
 
-    while (true)
+    // Upvalue 0 of a block that may do non-local return always points at the 'self' slot of its home method's frame
+    // (see how upvalue 0 is set up in the bytecode compiler), and is open iff the home method is still on the stack.
+    //
+    TestAssert(block->m_numUpvalues > 0);
+    StackFrameHeader* curHdr;
     {
-        TestAssert(block->m_numUpvalues > 0);
         Upvalue* uv = reinterpret_cast<Upvalue*>(block->m_upvalues[0].m_value);
         if (unlikely(uv->m_isClosed))
         {
-            // The closure is no longer on the stack, trigger escapedBlock.
+            // The home method is no longer on the stack, trigger escapedBlock.
             //
             goto escaped_block;
         }
         // The Upvalue points at 'self', which is always local 0
         //
-        TValue* ptr = uv->m_ptr;
-        curHdr = reinterpret_cast<StackFrameHeader*>(ptr) - 1;
-        block = curHdr->m_func;
+        curHdr = reinterpret_cast<StackFrameHeader*>(uv->m_ptr) - 1;
+    }
 
 #ifdef TESTBUILD
-        // For sanity, assert that everything till now is valid:
+    // For sanity, assert that everything till now is valid:
+    //
+    {
+        // 'curHdr' should really point to a stack frame header
         //
+        StackFrameHeader* h = hdr;
+        while (true)
         {
-            // 'curHdr' should really point to a stack frame header
-            //
-            StackFrameHeader* h = hdr;
-            while (true)
-            {
-                if (h == curHdr) { break; }
-                h = reinterpret_cast<StackFrameHeader*>(h->m_caller);
-                TestAssert(h != nullptr);
-                h -= 1;
-            }
-
-            // The block should really be a block
-            //
-            TestAssert(block->m_type == HeapEntityType::Function);
-
-            // The block should be an ancestor of the throwing block
-            //
-            UnlinkedCodeBlock* throwingUcb = static_cast<HeapPtr<CodeBlock>>(TCGet(hdr->m_func->m_executable).As())->m_owner;
-            UnlinkedCodeBlock* curUcb = static_cast<HeapPtr<CodeBlock>>(TCGet(block->m_executable).As())->m_owner;
-            while (true)
-            {
-                if (throwingUcb == curUcb) { break; }
-                throwingUcb = throwingUcb->m_parent;
-                TestAssert(throwingUcb != nullptr);
-            }
+            if (h == curHdr) { break; }
+            h = reinterpret_cast<StackFrameHeader*>(h->m_caller);
+            TestAssert(h != nullptr);
+            h -= 1;
         }
-#endif
 
-        if (IsClosureMethod(block))
+        // The frame should really be the home method of the throwing block
+        //
+        HeapPtr<FunctionObject> homeFn = curHdr->m_func;
+        TestAssert(homeFn->m_type == HeapEntityType::Function);
+        TestAssert(IsClosureMethod(homeFn));
+        UnlinkedCodeBlock* throwingUcb = static_cast<HeapPtr<CodeBlock>>(TCGet(block->m_executable).As())->m_owner;
+        UnlinkedCodeBlock* homeUcb = static_cast<HeapPtr<CodeBlock>>(TCGet(homeFn->m_executable).As())->m_owner;
+        while (throwingUcb->m_parent != nullptr)
         {
-            // This is the *method* that eventually created the throwing block, we should exit from this method
-            //
-            break;
+            throwingUcb = throwingUcb->m_parent;
         }
-        // Otherwise, this is a *block* that eventually created the throwing block,
-        // we should walk up the stack further to find its creator, eventualy to the *method*
-        //
+        TestAssert(throwingUcb == homeUcb);
     }
+#endif
 
     // At this point, 'curHdr' holds the method that eventually created the throwing block,
     // and we should return to its caller
     //
     {
-        // TODO: FIXME we need to properly update the interpreter tier-up counter for each stack frame that is in the interpreter tier
-        //
+        if (x_allow_interpreter_tier_up_to_baseline_jit)
+        {
+            UpdateInterpreterTierUpCounterForUnwoundFrames(hdr, curHdr);
+        }
+
         // Close all upvalues >= curHdr
         //
         CoroutineRuntimeContext* currentCoro = GetCurrentCoroutine();
@@ -115,16 +115,40 @@ static int32_t ALWAYS_INLINE DoSOMIntegerPercent(int32_t lhs, int32_t rhs)
     return result;
 }
 
+// If the result does not fit in int32, this returns without doing anything, and the caller falls back to the slow path,
+// where the Integer primitives compute the result in int64 and box it as a LargeInteger (see som_large_integer.h)
+//
 template<BinOpKind kind>
 static void ALWAYS_INLINE DoIntegerIntegerArithOp(int32_t lhs, int32_t rhs)
 {
     switch (kind)
     {
-    case BinOpKind::Plus: { Return(TValue::Create<tInt32>(lhs + rhs)); }
-    case BinOpKind::Minus: { Return(TValue::Create<tInt32>(lhs - rhs)); }
-    case BinOpKind::Star: { Return(TValue::Create<tInt32>(lhs * rhs)); }
+    case BinOpKind::Plus:
+    {
+        int32_t res;
+        if (likely(!__builtin_add_overflow(lhs, rhs, &res))) { Return(TValue::Create<tInt32>(res)); }
+        break;
+    }
+    case BinOpKind::Minus:
+    {
+        int32_t res;
+        if (likely(!__builtin_sub_overflow(lhs, rhs, &res))) { Return(TValue::Create<tInt32>(res)); }
+        break;
+    }
+    case BinOpKind::Star:
+    {
+        int32_t res;
+        if (likely(!__builtin_mul_overflow(lhs, rhs, &res))) { Return(TValue::Create<tInt32>(res)); }
+        break;
+    }
     case BinOpKind::SlashSlash: { Return(TValue::Create<tDouble>(static_cast<double>(lhs) / static_cast<double>(rhs))); }
-    case BinOpKind::Percent: {Return(TValue::Create<tInt32>(DoSOMIntegerPercent(lhs, rhs))); }
+    case BinOpKind::Percent:
+    {
+        // INT32_MIN % -1 traps on x86
+        //
+        if (likely(rhs != -1)) { Return(TValue::Create<tInt32>(DoSOMIntegerPercent(lhs, rhs))); }
+        break;
+    }
     case BinOpKind::And: { Return(TValue::Create<tInt32>(lhs & rhs)); }
     case BinOpKind::Equal: { Return(TValue::Create<tBool>(lhs == rhs)); }
     case BinOpKind::LessThan: { Return(TValue::Create<tBool>(lhs < rhs)); }
@@ -133,10 +157,28 @@ static void ALWAYS_INLINE DoIntegerIntegerArithOp(int32_t lhs, int32_t rhs)
     case BinOpKind::GreaterEqual: { Return(TValue::Create<tBool>(lhs >= rhs)); }
     case BinOpKind::Unequal: { Return(TValue::Create<tBool>(lhs != rhs)); }
     case BinOpKind::TildeUnequal: { Return(TValue::Create<tBool>(lhs != rhs)); }
-    case BinOpKind::LeftShift: { Return(TValue::Create<tInt32>(lhs << rhs)); }
-    case BinOpKind::RightShift: { Return(TValue::Create<tInt32>(lhs >> rhs)); }
+    case BinOpKind::LeftShift:
+    {
+        if (likely(static_cast<uint32_t>(rhs) < 32))
+        {
+            int64_t res = static_cast<int64_t>(lhs) << rhs;
+            if (likely(res == static_cast<int32_t>(res))) { Return(TValue::Create<tInt32>(static_cast<int32_t>(res))); }
+        }
+        break;
+    }
+    case BinOpKind::RightShift:
+    {
+        if (likely(static_cast<uint32_t>(rhs) < 32)) { Return(TValue::Create<tInt32>(lhs >> rhs)); }
+        break;
+    }
     case BinOpKind::BitwiseXor: { Return(TValue::Create<tInt32>(lhs ^ rhs)); }
-    case BinOpKind::Slash: { Return(TValue::Create<tInt32>(lhs / rhs)); }
+    case BinOpKind::Slash:
+    {
+        // INT32_MIN / -1 overflows (and traps on x86)
+        //
+        if (likely(rhs != -1)) { Return(TValue::Create<tInt32>(lhs / rhs)); }
+        break;
+    }
     default: { break; }     // not an arithmetic binary operator, shouldn't reach here
     }   /*switch*/
 }
@@ -200,19 +242,21 @@ static void ALWAYS_INLINE DoIntegerArithOp(int32_t lhs, TValue rhs)
     {
         DoIntegerIntegerArithOp<kind>(lhs, rhs.As<tInt32>());
     }
+    else if (likely(rhs.Is<tDouble>()))
+    {
+        DoIntegerDoubleArithOp<kind>(lhs, rhs.As<tDouble>());
+    }
     else
     {
-        // with the sole exception of the "equal" operator (lhs=integer case),
-        // integer + non-number is undefined behavior in both SOM++ and TruffleSOM, just replicate their behavior
+        // A LargeInteger rhs is handled by the slow path.
+        // With the sole exception of the "equal" operator (lhs=integer case),
+        // integer + non-number is undefined behavior in both SOM++ and TruffleSOM, so the slow path is fine for them as well.
+        // A LargeInteger is never equal to an int32, so "equal" is false for everything here.
         //
         if constexpr(kind == BinOpKind::Equal)
         {
-            if (!rhs.Is<tDouble>())
-            {
-                Return(TValue::Create<tBool>(false));
-            }
+            Return(TValue::Create<tBool>(false));
         }
-        DoIntegerDoubleArithOp<kind>(lhs, rhs.As<tDouble>());
     }
 }
 
@@ -225,12 +269,13 @@ static void ALWAYS_INLINE DoDoubleArithOp(double lhs, TValue rhs)
     {
         DoDoubleArithOp<kind>(lhs, rhs.As<tDouble>());
     }
-    else
+    else if (likely(rhs.Is<tInt32>()))
     {
-        // doublee + non-number is undefined behavior in both SOM++ and TruffleSOM, just replicate their behavior
-        //
         DoDoubleArithOp<kind>(lhs, static_cast<double>(rhs.As<tInt32>()));
     }
+    // Otherwise rhs is a LargeInteger (handled by the slow path), or a non-number,
+    // which is undefined behavior in both SOM++ and TruffleSOM
+    //
 }
 
 template<BinOpKind kind>
@@ -360,7 +405,17 @@ DEEGEN_DEFINE_BYTECODE_BY_TEMPLATE_INSTANTIATION(OperatorSlash, ArithBinOp, BinO
 //
 static void NO_RETURN OperatorEqualEqualImpl(TValue lhs, TValue rhs)
 {
-    Return(TValue::Create<tBool>(lhs.m_value == rhs.m_value));
+    if (lhs.m_value == rhs.m_value)
+    {
+        Return(TValue::Create<tBool>(true));
+    }
+    // Integers are values: two LargeInteger objects holding the same value are identical
+    //
+    if (unlikely(IsSOMLargeInteger(lhs) && IsSOMLargeInteger(rhs)))
+    {
+        Return(TValue::Create<tBool>(GetSOMLargeIntegerValue(lhs) == GetSOMLargeIntegerValue(rhs)));
+    }
+    Return(TValue::Create<tBool>(false));
 }
 
 DEEGEN_DEFINE_BYTECODE(OperatorEqualEqual)
@@ -499,7 +554,8 @@ static void NO_RETURN MiscBinOpImpl(TValue lhs, TValue rhs)
         }
         else if constexpr(kind == BinOpKind::AtColon)
         {
-            if (likely(lhs.As<tHeapEntity>()->m_arrayType == SOM_Array))
+            uint8_t ty = lhs.As<tHeapEntity>()->m_arrayType;
+            if (likely(ty == SOM_Array))
             {
                 int32_t idx = rhs.As<tInt32>();
                 HeapPtr<SOMObject> o = lhs.As<tObject>();
@@ -509,6 +565,17 @@ static void NO_RETURN MiscBinOpImpl(TValue lhs, TValue rhs)
                 }
                 Return(TCGet(o->m_data[idx]));
             }
+            else if (ty == SOM_Vector)
+            {
+                // Only in-range indices are handled here, otherwise the 'at:' method of the Vector class decides what to do
+                // See som_vector.h for the layout
+                //
+                HeapPtr<SOMObject> o = lhs.As<tObject>();
+                if (likely(rhs.Is<tInt32>() && static_cast<uint32_t>(rhs.As<tInt32>()) - 1 < o->m_data[1].m_value))
+                {
+                    Return(reinterpret_cast<TValue*>(o->m_data[0].m_value)[rhs.As<tInt32>() - 1]);
+                }
+            }
         }
         else
         {
@@ -1,6 +1,8 @@
 #include "api_define_bytecode.h"
 #include "deegen_api.h"
 
+#include "som_large_integer.h"
+
 template<bool ifTrue>
 static void NO_RETURN BranchIfTrueOrFalseImpl(TValue cond)
 {
@@ -140,24 +142,47 @@ DEEGEN_DEFINE_BYTECODE_TEMPLATE(CopyAndBranchIfNilOrNotNil, bool ifNot)
 DEEGEN_DEFINE_BYTECODE_BY_TEMPLATE_INSTANTIATION(CopyAndBranchIfNotNil, CopyAndBranchIfNilOrNotNil, true /*ifNot*/);
 DEEGEN_DEFINE_BYTECODE_BY_TEMPLATE_INSTANTIATION(CopyAndBranchIfNil, CopyAndBranchIfNilOrNotNil, false /*ifNot*/);
 
+// The loop condition of an inlined to:do: or downTo:do: loop for the uncommon cases,
+// that is, any of 'val' and 'limit' is a LargeInteger, or they are a mix of integer and double
+//
+template<bool forDownto>
+static bool WARN_UNUSED NO_INLINE ForLoopCondHoldsGeneric(TValue val, TValue limit)
+{
+    int64_t valInt, limitInt;
+    bool valIsInt = TryGetSOMIntegerValue(val, &valInt /*out*/);
+    bool limitIsInt = TryGetSOMIntegerValue(limit, &limitInt /*out*/);
+    if (valIsInt && limitIsInt)
+    {
+        return (forDownto ? (valInt >= limitInt) : (valInt <= limitInt));
+    }
+    if ((!valIsInt && !val.Is<tDouble>()) || (!limitIsInt && !limit.Is<tDouble>()))
+    {
+        fprintf(stderr, "%s: the loop bounds must be numbers\n", forDownto ? "downTo:do:" : "to:do:");
+        abort();
+    }
+    double valD = valIsInt ? static_cast<double>(valInt) : val.As<tDouble>();
+    double limitD = limitIsInt ? static_cast<double>(limitInt) : limit.As<tDouble>();
+    return (forDownto ? (valD >= limitD) : (valD <= limitD));
+}
+
 // Branch if the statement block should NOT be executed
 //
 template<bool forDownto>
 static void NO_RETURN CheckForLoopStartCondImpl(TValue val, TValue limit)
 {
     bool passed;
-    if (val.Is<tInt32>())
+    if (likely(val.Is<tInt32>() && limit.Is<tInt32>()))
     {
-        // Assuming 'limit' has the same type as 'val' is clearly problematic but this is really what SOM++ did.
-        //
-        TestAssert(limit.Is<tInt32>());
         passed = (forDownto ? (val.As<tInt32>() >= limit.As<tInt32>()) : (val.As<tInt32>() <= limit.As<tInt32>()));
     }
-    else
+    else if (val.Is<tDouble>() && limit.Is<tDouble>())
     {
-        TestAssert(limit.Is<tDouble>());
         passed = (forDownto ? (val.As<tDouble>() >= limit.As<tDouble>()) : (val.As<tDouble>() <= limit.As<tDouble>()));
     }
+    else
+    {
+        passed = ForLoopCondHoldsGeneric<forDownto>(val, limit);
+    }
     if (passed)
     {
         Return(val);
@@ -184,31 +209,53 @@ DEEGEN_DEFINE_BYTECODE_TEMPLATE(CheckForUpOrDownLoopStartCond, bool forDownto)
 DEEGEN_DEFINE_BYTECODE_BY_TEMPLATE_INSTANTIATION(CheckForLoopStartCond, CheckForUpOrDownLoopStartCond, false /*forDownto*/);
 DEEGEN_DEFINE_BYTECODE_BY_TEMPLATE_INSTANTIATION(CheckDowntoForLoopStartCond, CheckForUpOrDownLoopStartCond, true /*forDownto*/);
 
+// Step the loop variable of an inlined to:do: or downTo:do: loop for the uncommon cases (see ForLoopCondHoldsGeneric)
+// Return true if the statement block should be executed again
+//
+template<bool forDownto>
+static bool WARN_UNUSED NO_INLINE ForLoopStepGeneric(TValue* base)
+{
+    TValue val = base[0];
+    TValue nextTv;
+    int64_t valInt;
+    if (TryGetSOMIntegerValue(val, &valInt /*out*/))
+    {
+        nextTv = MakeSOMInteger(forDownto ? SOMIntegerSub(valInt, 1) : SOMIntegerAdd(valInt, 1));
+    }
+    else
+    {
+        TestAssert(val.Is<tDouble>());
+        nextTv = TValue::Create<tDouble>(val.As<tDouble>() + (forDownto ? -1.0 : 1.0));
+    }
+    base[0] = nextTv;
+    base[2] = nextTv;
+    return ForLoopCondHoldsGeneric<forDownto>(nextTv, base[1]);
+}
+
 // Branch if the statement block SHOULD be executed
 //
 template<bool forDownto>
 static void NO_RETURN ForLoopStepImpl(TValue* base)
 {
-    // Assuming 'limit' is also integer is clearly problematic but this is really what SOM++ did.
-    //
     TValue val = base[0];
     TValue limit = base[1];
     bool passed;
-    if (val.Is<tInt32>())
+    if (likely(val.Is<tInt32>() && limit.Is<tInt32>()))
     {
-        // Assuming 'limit' has the same type as 'val' is clearly problematic but this is really what SOM++ did.
+        // Same as checking 'next <= limit' (or 'next >= limit'), but written this way so 'next' cannot overflow int32
+        // The loop variable is not updated when the loop exits, since the statement block will not see it
         //
-        TestAssert(limit.Is<tInt32>());
-        int32_t next = val.As<tInt32>();
-        if (forDownto) { next--; } else { next++; }
-        TValue nextTv = TValue::Create<tInt32>(next);
-        base[0] = nextTv;
-        base[2] = nextTv;
-        passed = (forDownto ? (next >= limit.As<tInt32>()) : (next <= limit.As<tInt32>()));
+        int32_t cur = val.As<tInt32>();
+        passed = (forDownto ? (cur > limit.As<tInt32>()) : (cur < limit.As<tInt32>()));
+        if (passed)
+        {
+            TValue nextTv = TValue::Create<tInt32>(forDownto ? cur - 1 : cur + 1);
+            base[0] = nextTv;
+            base[2] = nextTv;
+        }
     }
-    else
+    else if (val.Is<tDouble>() && limit.Is<tDouble>())
     {
-        TestAssert(limit.Is<tDouble>());
         double next = val.As<tDouble>();
         if (forDownto) { next -= 1.0; } else { next += 1.0; }
         TValue nextTv = TValue::Create<tDouble>(next);
@@ -216,6 +263,10 @@ static void NO_RETURN ForLoopStepImpl(TValue* base)
         base[2] = nextTv;
         passed = (forDownto ? (next >= limit.As<tDouble>()) : (next <= limit.As<tDouble>()));
     }
+    else
+    {
+        passed = ForLoopStepGeneric<forDownto>(base);
+    }
     if (passed)
     {
         ReturnAndBranch();
@@ -50,6 +50,61 @@ static void NO_RETURN SelfCallImpl(TValue* base, TValue self, TValue methTv, uin
     } /*switch*/
 }
 
+static void NO_RETURN SelfRecursiveCallReturnContinuation(TValue* /*base*/, TValue /*self*/, TValue /*methTv*/, TValue /*holderTv*/, TValue /*selfFnTv*/, uint16_t /*numArgs*/)
+{
+    Return(GetReturnValue(0));
+}
+
+static void NO_RETURN SelfRecursiveCallMethodNotFoundSlowPath(TValue* base, TValue self, TValue methTv, TValue /*holderTv*/, TValue /*selfFnTv*/, uint16_t numArgs)
+{
+    HandleMethodNotFoundImpl<SelfRecursiveCallReturnContinuation>(self, methTv, base + x_numSlotsForStackFrameHeader + 1, numArgs - 1);
+}
+
+// A 'self' call inside a method to the method's own selector (e.g., 'fib: n' calling 'self fib: n - 1')
+//
+// 'holderTv' is the class that defines the method, and 'selfFnTv' is the method itself.
+// If 'self' is an instance of exactly the holder class, method lookup must find the method itself, so the lookup IC is skipped
+// and the call target is a constant, so the baseline JIT call IC at this site only ever sees one callee.
+// Otherwise (e.g., 'self' is an instance of a subclass that may override the method), it falls back to the normal self-call logic.
+//
+static void NO_RETURN SelfRecursiveCallImpl(TValue* base, TValue self, TValue methTv, TValue holderTv, TValue selfFnTv, uint16_t numArgs)
+{
+    Assert(self.Is<tObject>());
+    HeapPtr<SOMObject> selfObj = self.As<tObject>();
+    if (likely(selfObj->m_hiddenClass == static_cast<uint32_t>(holderTv.m_value)))
+    {
+        base[x_numSlotsForStackFrameHeader] = self;
+        MakeInPlaceCall(selfFnTv.As<tFunction>(), base + x_numSlotsForStackFrameHeader, numArgs, SelfRecursiveCallReturnContinuation);
+    }
+
+    auto [fnKind, fn] = LookupObjectMethodImpl<false /*isSuper*/>(self.As<tHeapEntity>(), methTv);
+    switch (fnKind)
+    {
+    case SOM_MethodNotFound:
+    {
+        EnterSlowPath<SelfRecursiveCallMethodNotFoundSlowPath>();
+    }
+    case SOM_CallBaseNotObject:
+    {
+        Assert(false);
+        __builtin_unreachable();
+    }
+    case SOM_NormalMethod:
+    {
+        base[x_numSlotsForStackFrameHeader] = self;
+        MakeInPlaceCall(fn, base + x_numSlotsForStackFrameHeader, numArgs, SelfRecursiveCallReturnContinuation);
+    }
+    case SOM_Setter:
+    {
+        Return(ExecuteSetterTrivialMethod(fn, self, base[x_numSlotsForStackFrameHeader + 1]));
+    }
+    default:
+    {
+        Return(ExecuteTrivialMethodExceptSetter(fn, self, fnKind));
+    }
+    } /*switch*/
+}
+
 DEEGEN_DEFINE_BYTECODE(SOMSelfCall)
 {
     Operands(
@@ -72,4 +127,28 @@ DEEGEN_DEFINE_BYTECODE(SOMSelfCall)
     DeclareUsedByInPlaceCall(Op("base"));
 }
 
+DEEGEN_DEFINE_BYTECODE(SOMSelfRecursiveCall)
+{
+    Operands(
+        BytecodeRangeBaseRW("base"),
+        BytecodeSlot("self"),
+        Constant("meth"),
+        Constant("holder"),
+        Constant("selfFn"),
+        Literal<uint16_t>("numArgs")
+    );
+    Result(BytecodeValue);
+    Implementation(SelfRecursiveCallImpl);
+    Variant();
+    DfgVariant();
+    TypeDeductionRule(ValueProfile);
+    DeclareReads(
+        Range(Op("base"), 1),
+        Range(Op("base") + x_numSlotsForStackFrameHeader, Op("numArgs"))
+    );
+    // This is unneeded but to make Deegen happy.. Deegen should to be fixed, but doesn't matter now..
+    DeclareWrites(Range(Op("base"), 0).TypeDeductionRule(ValueProfile));
+    DeclareUsedByInPlaceCall(Op("base"));
+}
+
 DEEGEN_END_BYTECODE_DEFINITIONS
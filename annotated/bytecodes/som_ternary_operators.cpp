@@ -85,6 +85,18 @@ static void NO_RETURN MiscTernaryOpImpl(TValue op, TValue arg1, TValue arg2)
             o->m_data[idx].m_value = arg2.m_value;
             Return(op);
         }
+        if (op.Is<tHeapEntity>() && op.As<tHeapEntity>()->m_arrayType == SOM_Vector)
+        {
+            // Only in-range indices are handled here, otherwise the 'at:put:' method of the Vector class decides what to do
+            // See som_vector.h for the layout
+            //
+            HeapPtr<SOMObject> o = op.As<tObject>();
+            if (likely(arg1.Is<tInt32>() && static_cast<uint32_t>(arg1.As<tInt32>()) - 1 < o->m_data[1].m_value))
+            {
+                reinterpret_cast<TValue*>(o->m_data[0].m_value)[arg1.As<tInt32>() - 1] = arg2;
+                Return(op);
+            }
+        }
     }
     else
     {
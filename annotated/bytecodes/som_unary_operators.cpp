@@ -16,6 +16,7 @@ enum class UnaryOpKind
     Value,      // value
     Not,        // not
     Length,     // length
+    AtRandom,   // atRandom
 };
 
 // Below is the fallback generic slow path logic that correctly but slowly implements any unary operator
@@ -47,6 +48,7 @@ static SOMUniquedString ALWAYS_INLINE WARN_UNUSED GetLookupKeyForUnaryOperator()
     case UnaryOpKind::Value: return vm->m_strOperatorValue;
     case UnaryOpKind::Not: return vm->m_strOperatorNot;
     case UnaryOpKind::Length: return vm->m_strOperatorLength;
+    case UnaryOpKind::AtRandom: return vm->m_strOperatorAtRandom;
     }   /*switch*/
     __builtin_unreachable();
 }
@@ -69,7 +71,9 @@ static void NO_RETURN ArithUnaryOpImpl(TValue op)
 {
     if constexpr(kind == UnaryOpKind::Abs)
     {
-        if (likely(op.Is<tInt32>()))
+        // The abs of INT32_MIN does not fit in int32, let the slow path box it
+        //
+        if (likely(op.Is<tInt32>() && op.As<tInt32>() != std::numeric_limits<int32_t>::min()))
         {
             int32_t v = op.As<tInt32>();
             if (v < 0) { v = -v; }
@@ -85,6 +89,18 @@ static void NO_RETURN ArithUnaryOpImpl(TValue op)
             Return(TValue::Create<tDouble>(d));
         }
     }
+    else if constexpr(kind == UnaryOpKind::AtRandom)
+    {
+        // A uniformly random integer in [1, op], drawn from the per-VM generator.
+        // Non-positive receivers (an error) and LargeInteger receivers are handled by the slow path.
+        //
+        if (likely(op.Is<tInt32>() && op.As<tInt32>() > 0))
+        {
+            VM* vm = VM_GetActiveVMForCurrentThread();
+            uint64_t r = vm->m_randomGenerator.NextBelow(static_cast<uint64_t>(op.As<tInt32>()));
+            Return(TValue::Create<tInt32>(static_cast<int32_t>(r + 1)));
+        }
+    }
     else
     {
         static_assert(kind == UnaryOpKind::Sqrt);
@@ -126,6 +142,7 @@ DEEGEN_DEFINE_BYTECODE_TEMPLATE(ArithUnaryOp, UnaryOpKind kind)
 
 DEEGEN_DEFINE_BYTECODE_BY_TEMPLATE_INSTANTIATION(OperatorAbs, ArithUnaryOp, UnaryOpKind::Abs);
 DEEGEN_DEFINE_BYTECODE_BY_TEMPLATE_INSTANTIATION(OperatorSqrt, ArithUnaryOp, UnaryOpKind::Sqrt);
+DEEGEN_DEFINE_BYTECODE_BY_TEMPLATE_INSTANTIATION(OperatorAtRandom, ArithUnaryOp, UnaryOpKind::AtRandom);
 
 // SOM++ already did unsound inlining of ifNil:ifNotNil, so it's already assuming that ifNil cannot be overloaded by users
 // This is not strictly what is allowed by ANSI Smalltalk standard (ANSI Smalltalk standard only says ifTrue:ifFalse cannot
@@ -40,6 +40,16 @@ constexpr bool x_allow_baseline_jit_tier_up_to_optimizing_jit = false;
 //
 constexpr size_t x_interpreter_tier_up_threshold_bytecode_length_multiplier = 20;
 
+// All JIT code must live in the low 2GB address space, so the amount of JIT code cannot grow unboundedly.
+//
+// When the total JIT code size is about to exceed this limit, the baseline JIT frees the JIT code that
+// is no longer referenced by any stack frame, and if that is not enough, flushes all baseline JIT code
+// (functions still running on the stack keep their code, and hot functions will simply tier up again).
+//
+// This can be changed at runtime by VM::SetBaselineJitCodeMemoryLimit.
+//
+constexpr size_t x_default_baseline_jit_code_memory_limit = 256 * 1024 * 1024;
+
 // Do not tier up to DFG if a function contains more than this many bytecodes.
 //
 constexpr size_t x_forbid_tier_up_to_dfg_num_bytecodes_threshold = 200000;
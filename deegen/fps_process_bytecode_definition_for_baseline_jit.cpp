@@ -110,8 +110,24 @@ void FPS_ProcessBytecodeDefinitionForBaselineJit()
                 callIcSiteOffsetInSlowPathData = 0;
             }
             ReleaseAssert(callIcSiteOffsetInSlowPathData <= 65535);
-            fprintf(hdrFp, "    .m_callIcSiteOffsetInSlowPathData = %llu\n,", static_cast<unsigned long long>(callIcSiteOffsetInSlowPathData));
-            fprintf(hdrFp, "    .m_unused = 0\n");
+            fprintf(hdrFp, "    .m_callIcSiteOffsetInSlowPathData = %llu,\n", static_cast<unsigned long long>(callIcSiteOffsetInSlowPathData));
+            size_t numGenericIcSites = res.m_bytecodeDef->GetBaselineJitSlowPathDataLayout()->GetNumGenericIcSites();
+            ReleaseAssert(numGenericIcSites <= 255);
+            fprintf(hdrFp, "    .m_numGenericIcSites = %llu,\n", static_cast<unsigned long long>(numGenericIcSites));
+            size_t genericIcSiteOffsetInSlowPathData;
+            if (numGenericIcSites > 0)
+            {
+                genericIcSiteOffsetInSlowPathData = res.m_bytecodeDef->GetBaselineJitSlowPathDataLayout()->m_genericICs.GetOffsetForSite(0);
+            }
+            else
+            {
+                genericIcSiteOffsetInSlowPathData = 0;
+            }
+            // This field is only 1 byte in the trait struct. The generic IC sites come right after the bytecode operands,
+            // so this should never be an issue, but fail loudly if it ever is.
+            //
+            ReleaseAssert(genericIcSiteOffsetInSlowPathData <= 255);
+            fprintf(hdrFp, "    .m_genericIcSiteOffsetInSlowPathData = %llu\n", static_cast<unsigned long long>(genericIcSiteOffsetInSlowPathData));
             fprintf(hdrFp, "};\n");
 
             for (size_t k = start; k < end; k++)
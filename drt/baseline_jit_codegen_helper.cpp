@@ -2,6 +2,9 @@
 #include "runtime_utils.h"
 #include "bytecode_builder.h"
 #include "temp_arena_allocator.h"
+#include "deegen_options.h"
+
+#include <pthread.h>
 
 // These tables are generated by Deegen
 //
@@ -14,6 +17,41 @@ extern "C" void deegen_baseline_jit_do_codegen_impl(DeegenBaselineJitCodegenCont
 
 using BytecodeOpcodeTy = DeegenBytecodeBuilder::BytecodeBuilder::BytecodeOpcodeTy;
 
+static std::vector<bool> WARN_UNUSED FindBaselineCodeBlocksReferencedFromStack(VM* vm, const std::vector<BaselineCodeBlock*>& list);
+
+// Called when the JIT code memory usage is about to exceed the sweep threshold
+//
+static void NO_INLINE HandleBaselineJitCodeSweepThresholdExceeded(VM* vm)
+{
+    // First try to free the JIT code that has already been jettisoned
+    //
+    ReclaimJettisonedBaselineJitCode(vm);
+
+    // If that is not enough to bring the usage well below the limit, flush all the baseline JIT code that is not running on the stack.
+    //
+    // The code of a running function must not be jettisoned: its frames still reach the slow paths and return continuations,
+    // which find their SlowPathData through 'm_baselineCodeBlock' of the CodeBlock (see GetBaselineCodeBlockFromStackBase).
+    // Hot functions that are flushed will simply tier up again.
+    //
+    if (vm->GetTotalJITCodeSize() > vm->GetBaselineJitCodeMemoryLimit() / 2)
+    {
+        std::vector<BaselineCodeBlock*> liveList = vm->GetLiveBaselineCodeBlocks();
+        std::vector<bool> isRunning = FindBaselineCodeBlocksReferencedFromStack(vm, liveList);
+        for (size_t ord = 0; ord < liveList.size(); ord++)
+        {
+            if (!isRunning[ord])
+            {
+                JettisonBaselineJitCode(liveList[ord]->m_owner);
+            }
+        }
+        ReclaimJettisonedBaselineJitCode(vm);
+    }
+
+    // If most of the JIT code is still in use after the sweep, raise the threshold so we don't keep sweeping for nothing
+    //
+    vm->SetBaselineJitCodeSweepThreshold(vm->GetTotalJITCodeSize() * 2);
+}
+
 BaselineCodeBlock* NO_INLINE deegen_baseline_jit_do_codegen(CodeBlock* cb)
 {
     // Each CodeBlock should be codegen'ed only once.
@@ -61,49 +99,54 @@ BaselineCodeBlock* NO_INLINE deegen_baseline_jit_do_codegen(CodeBlock* cb)
         TestAssert(UnalignedLoad<BytecodeOpcodeTy>(ptr) == DeegenBytecodeBuilder::BytecodeBuilder::GetTotalBytecodeKinds());
     }
 
-    // Determine the layout of the generated code:
-    //     [ Data Section ] [ Fast Path ] [ Slow Path ]
+    // Determine the layout of the generated code. The fast path goes to the hot region, and the slow path and data section go to the cold region:
+    //     Hot region:  [ Fast Path ]
+    //     Cold region: [ Data Section ] [ Slow Path ]
+    // This way the fast paths of different functions are packed densely, which improves iTLB and L1i utilization.
+    // All JIT code lives in the low 2GB address space, so the two regions can always reach each other.
+    //
     // Note that however, the codegen may overwrite at most 7 more bytes after each section, so allocation must account for that.
     //
     constexpr size_t x_maxBytesCodegenFnMayOverwrite = 7;
-    size_t fastPathSectionOffset = dataSectionCodeLen;
+
+    // 'x_maxBytesCodegenFnMayOverwrite' bytes of NOP needs to be populated after the fast path code and
+    // the slow path code sections to avoid breaking debugger disassembler
+    //
+    size_t hotJitRegionSize = fastPathCodeLen + x_maxBytesCodegenFnMayOverwrite;
+
+    size_t slowPathSectionOffset = dataSectionCodeLen;
     if (dataSectionCodeLen > 0)
     {
         // Only add the padding if the data section is not empty (it is often empty),
         // since if the data section is empty, the codegen won't write anything at all so the padding is not needed.
-        // This way we don't waste 16 bytes if the data section is empty.
         //
-        fastPathSectionOffset += x_maxBytesCodegenFnMayOverwrite;
+        slowPathSectionOffset += x_maxBytesCodegenFnMayOverwrite;
     }
-    // Make the function entry address 16-byte aligned
-    //
-    fastPathSectionOffset = RoundUpToMultipleOf<16>(fastPathSectionOffset);
-
-    // 'x_maxBytesCodegenFnMayOverwrite' bytes of NOP needs to be populated between the fast path code and
-    // the slow path code sections to avoid breaking debugger disassembler
-    //
-    size_t fastPathSectionEnd = fastPathSectionOffset + fastPathCodeLen;
-
-    size_t slowPathSectionOffset = fastPathSectionEnd + x_maxBytesCodegenFnMayOverwrite;
     size_t slowPathSectionEnd = slowPathSectionOffset + slowPathCodeLen;
+    size_t coldJitRegionSize = slowPathSectionEnd + x_maxBytesCodegenFnMayOverwrite;
 
-    size_t totalJitRegionSize = slowPathSectionEnd + x_maxBytesCodegenFnMayOverwrite;
-
-    // TODO: right now the data section is also marked executable because we just use one mmap for simplicity..
+    // TODO: right now the data section is also marked executable because it lives in the cold JIT region..
     //
     VM* vm = VM::GetActiveVMForCurrentThread();
     vm->IncrementNumTotalBaselineJitCompilations();
-    JitMemoryAllocator* jitAlloc = vm->GetJITMemoryAlloc();
-    void* regionVoidPtr = jitAlloc->AllocateGivenSize(totalJitRegionSize);
-    Assert(regionVoidPtr != nullptr);
+    if (unlikely(vm->GetTotalJITCodeSize() + hotJitRegionSize + coldJitRegionSize > vm->GetBaselineJitCodeSweepThreshold()))
+    {
+        HandleBaselineJitCodeSweepThresholdExceeded(vm);
+    }
+
+    // The allocator always returns 16-byte-aligned memory, so the function entry is 16-byte aligned
+    //
+    uint8_t* fastPathSecPtr = reinterpret_cast<uint8_t*>(vm->GetJITMemoryAlloc()->AllocateGivenSize(hotJitRegionSize));
+    Assert(fastPathSecPtr != nullptr);
+    Assert(reinterpret_cast<uintptr_t>(fastPathSecPtr) % 16 == 0);
 
-    uint8_t* dataSecPtr = reinterpret_cast<uint8_t*>(regionVoidPtr);
+    uint8_t* dataSecPtr = reinterpret_cast<uint8_t*>(vm->GetColdJITMemoryAlloc()->AllocateGivenSize(coldJitRegionSize));
+    Assert(dataSecPtr != nullptr);
 
     // This is required in order for all the computations above about the data section size to hold
     //
     Assert(reinterpret_cast<uintptr_t>(dataSecPtr) % x_jitMaxPossibleDataSectionAlignment == 0);
 
-    uint8_t* fastPathSecPtr = dataSecPtr + fastPathSectionOffset;
     uint8_t* slowPathSecPtr = dataSecPtr + slowPathSectionOffset;
 
     uint8_t* fastPathSecTrueEnd = fastPathSecPtr + fastPathCodeLen;
@@ -115,8 +158,10 @@ BaselineCodeBlock* NO_INLINE deegen_baseline_jit_do_codegen(CodeBlock* cb)
                                                        SafeIntegerCast<uint32_t>(numBytecodes),
                                                        SafeIntegerCast<uint32_t>(slowPathDataStreamLen),
                                                        fastPathSecPtr /*jitCodeEntry*/,
-                                                       dataSecPtr /*jitRegionStart*/,
-                                                       SafeIntegerCast<uint32_t>(totalJitRegionSize));
+                                                       fastPathSecPtr /*jitRegionStart*/,
+                                                       SafeIntegerCast<uint32_t>(hotJitRegionSize),
+                                                       dataSecPtr /*jitColdRegionStart*/,
+                                                       SafeIntegerCast<uint32_t>(coldJitRegionSize));
 
     BaselineCodeBlock::SlowPathDataAndBytecodeOffset* slowPathDataIndexArray = bcb->m_sbIndex;
     uint8_t* slowPathDataStreamStart = bcb->GetSlowPathDataStreamStart();
@@ -238,8 +283,8 @@ BaselineCodeBlock* NO_INLINE deegen_baseline_jit_do_codegen(CodeBlock* cb)
     // There is a 'x_maxBytesCodegenFnMayOverwrite' byte gap between fast path and slow path
     // Populate ud2 + N * nop for sanity and to avoid breaking debugger disassembler.
     //
-    // And also do the same at the end of slow path, so that the full [jitCodeEntry, jitRegionEnd) recorded
-    // in BaselineCodeBlock is filled with disassemblable instructions
+    // And also do the same at the end of slow path, so that both the hot region [jitCodeEntry, jitRegionEnd) and the slow path part
+    // of the cold region recorded in BaselineCodeBlock are filled with disassemblable instructions
     //
     {
         auto populateCodeGap = [](uint8_t* buf) ALWAYS_INLINE
@@ -266,6 +311,14 @@ BaselineCodeBlock* NO_INLINE deegen_baseline_jit_do_codegen(CodeBlock* cb)
     Assert(cb->m_bestEntryPoint == cb->m_owner->GetInterpreterEntryPoint());
     cb->UpdateBestEntryPoint(bcb->m_jitCodeEntry);
     Assert(cb->m_bestEntryPoint == bcb->m_jitCodeEntry);
+
+    // Register the BaselineCodeBlock so it can be found when we need to flush JIT code
+    //
+    {
+        std::vector<BaselineCodeBlock*>& liveList = vm->GetLiveBaselineCodeBlocks();
+        bcb->m_indexInLiveList = SafeIntegerCast<uint32_t>(liveList.size());
+        liveList.push_back(bcb);
+    }
     return bcb;
 }
 
@@ -309,3 +362,266 @@ BaselineCodeBlockAndEntryPoint NO_INLINE WARN_UNUSED deegen_prepare_osr_entry_in
         .entryPoint = reinterpret_cast<void*>(static_cast<uint64_t>(jitAddr))
     };
 }
+
+void JettisonBaselineJitCode(CodeBlock* cb)
+{
+    BaselineCodeBlock* bcb = cb->m_baselineCodeBlock;
+    Assert(bcb != nullptr && bcb->m_owner == cb);
+
+    // The DFG code (if any) relies on the baseline JIT code for OSR exit
+    //
+    TestAssert(cb->m_dfgCodeBlock == nullptr);
+
+    VM* vm = VM::GetActiveVMForCurrentThread();
+
+    // Remove from the live list by swapping with the last element
+    //
+    {
+        std::vector<BaselineCodeBlock*>& liveList = vm->GetLiveBaselineCodeBlocks();
+        uint32_t idx = bcb->m_indexInLiveList;
+        Assert(idx < liveList.size() && liveList[idx] == bcb);
+        BaselineCodeBlock* last = liveList.back();
+        liveList[idx] = last;
+        last->m_indexInLiveList = idx;
+        liveList.pop_back();
+        bcb->m_indexInLiveList = static_cast<uint32_t>(-1);
+    }
+
+    // Redirect all calls back to the interpreter, so that nothing except running frames may reach the JIT code from now on
+    //
+    Assert(cb->m_bestEntryPoint == bcb->m_jitCodeEntry);
+    cb->UpdateBestEntryPoint(cb->m_owner->GetInterpreterEntryPoint());
+    cb->m_baselineCodeBlock = nullptr;
+
+    // Reset the tier-up counter, so the function is not compiled again immediately
+    //
+    if (vm->InterpreterCanTierUpFurther())
+    {
+        cb->m_interpreterTierUpCounter = static_cast<int64_t>(x_interpreter_tier_up_threshold_bytecode_length_multiplier * cb->m_bytecodeLengthIncludingTailPadding);
+    }
+    else
+    {
+        cb->m_interpreterTierUpCounter = 1LL << 62;
+    }
+
+    vm->GetJettisonedBaselineCodeBlocks().push_back(bcb);
+}
+
+// Invoke 'callIcSiteFn(JitCallInlineCacheSite*)' and 'genericIcSiteFn(JitGenericInlineCacheSite*)' for each IC site in the SlowPathData of 'bcb'
+//
+template<typename CallIcSiteFn, typename GenericIcSiteFn>
+static void ForEachIcSiteInBaselineCodeBlock(BaselineCodeBlock* bcb, const CallIcSiteFn& callIcSiteFn, const GenericIcSiteFn& genericIcSiteFn)
+{
+    for (size_t bcIdx = 0; bcIdx < bcb->m_numBytecodes; bcIdx++)
+    {
+        // The SlowPathData always start with the opcode
+        //
+        uint8_t* spd = bcb->GetSlowPathDataAtBytecodeIndex(bcIdx);
+        BytecodeOpcodeTy opcode = UnalignedLoad<BytecodeOpcodeTy>(spd);
+        Assert(opcode < DeegenBytecodeBuilder::BytecodeBuilder::GetTotalBytecodeKinds());
+        const BytecodeBaselineJitTraits& trait = deegen_baseline_jit_bytecode_trait_table[opcode];
+
+        for (size_t siteOrd = 0; siteOrd < trait.m_numCallIcSites; siteOrd++)
+        {
+            callIcSiteFn(reinterpret_cast<JitCallInlineCacheSite*>(spd + trait.m_callIcSiteOffsetInSlowPathData + sizeof(JitCallInlineCacheSite) * siteOrd));
+        }
+        for (size_t siteOrd = 0; siteOrd < trait.m_numGenericIcSites; siteOrd++)
+        {
+            genericIcSiteFn(reinterpret_cast<JitGenericInlineCacheSite*>(spd + trait.m_genericIcSiteOffsetInSlowPathData + sizeof(JitGenericInlineCacheSite) * siteOrd));
+        }
+    }
+}
+
+// Invoke 'func(lo, hi)' for each memory range [lo, hi) of JIT code owned by 'bcb', including its IC stubs
+//
+template<typename Func>
+static void ForEachJitRegionOwnedByBaselineCodeBlock(VM* vm, BaselineCodeBlock* bcb, const Func& func)
+{
+    uint8_t* regionStart = reinterpret_cast<uint8_t*>(bcb->m_jitRegionStart);
+    func(regionStart, regionStart + bcb->m_jitRegionSize);
+
+    uint8_t* coldRegionStart = reinterpret_cast<uint8_t*>(bcb->m_jitColdRegionStart);
+    func(coldRegionStart, coldRegionStart + bcb->m_jitColdRegionSize);
+
+    ForEachIcSiteInBaselineCodeBlock(
+        bcb,
+        [&](JitCallInlineCacheSite* site)
+        {
+            SpdsPtr<JitCallInlineCacheEntry> node = TCGet(site->m_linkedListHead);
+            while (!node.IsInvalidPtr())
+            {
+                JitCallInlineCacheEntry* entry = TranslateToRawPointer(vm, node.AsPtr());
+                uint8_t* stubStart = entry->GetJitRegionStart();
+                func(stubStart, stubStart + x_jit_mem_alloc_stepping_array[entry->GetIcTrait()->m_jitCodeAllocationLengthStepping]);
+                node = TCGet(entry->m_callSiteNextNode);
+            }
+        },
+        [&](JitGenericInlineCacheSite* site)
+        {
+            SpdsPtr<JitGenericInlineCacheEntry> node = TCGet(site->m_linkedListHead);
+            while (!node.IsInvalidPtr())
+            {
+                JitGenericInlineCacheEntry* entry = TranslateToRawPointer(vm, node.AsPtr());
+                uint8_t* stubStart = reinterpret_cast<uint8_t*>(entry->m_jitAddr);
+                func(stubStart, stubStart + x_jit_mem_alloc_stepping_array[entry->m_jitRegionLengthStepping]);
+                node = TCGet(entry->m_nextNode);
+            }
+        });
+}
+
+// Free the JIT code of 'bcb' and all the IC stubs it owns
+//
+static void FreeJitCodeOwnedByBaselineCodeBlock(VM* vm, BaselineCodeBlock* bcb)
+{
+    ForEachIcSiteInBaselineCodeBlock(
+        bcb,
+        [&](JitCallInlineCacheSite* site)
+        {
+            SpdsPtr<JitCallInlineCacheEntry> node = TCGet(site->m_linkedListHead);
+            while (!node.IsInvalidPtr())
+            {
+                JitCallInlineCacheEntry* entry = TranslateToRawPointer(vm, node.AsPtr());
+                node = TCGet(entry->m_callSiteNextNode);
+                entry->Destroy(vm);
+            }
+            ConstructInPlace(site);
+        },
+        [&](JitGenericInlineCacheSite* site)
+        {
+            SpdsPtr<JitGenericInlineCacheEntry> node = TCGet(site->m_linkedListHead);
+            while (!node.IsInvalidPtr())
+            {
+                JitGenericInlineCacheEntry* entry = TranslateToRawPointer(vm, node.AsPtr());
+                node = TCGet(entry->m_nextNode);
+                entry->Destroy(vm);
+            }
+            ConstructInPlace(site);
+        });
+
+    vm->GetJITMemoryAlloc()->Free(bcb->m_jitRegionStart);
+    bcb->m_jitRegionStart = nullptr;
+    bcb->m_jitRegionSize = 0;
+
+    vm->GetColdJITMemoryAlloc()->Free(bcb->m_jitColdRegionStart);
+    bcb->m_jitColdRegionStart = nullptr;
+    bcb->m_jitColdRegionSize = 0;
+}
+
+// Return whether the JIT code (or the IC stubs) of each BaselineCodeBlock in 'list' is referenced by a return address on the stack
+//
+static std::vector<bool> WARN_UNUSED FindBaselineCodeBlocksReferencedFromStack(VM* vm, const std::vector<BaselineCodeBlock*>& list)
+{
+    std::vector<bool> isReferenced(list.size(), false);
+
+    // Collect all the JIT memory ranges owned by the code blocks, sorted by address
+    //
+    struct OwnedRange
+    {
+        uintptr_t m_lo;
+        uintptr_t m_hi;
+        size_t m_ownerOrd;
+    };
+
+    std::vector<OwnedRange> ranges;
+    for (size_t ord = 0; ord < list.size(); ord++)
+    {
+        ForEachJitRegionOwnedByBaselineCodeBlock(vm, list[ord], [&](uint8_t* lo, uint8_t* hi) {
+            ranges.push_back({ .m_lo = reinterpret_cast<uintptr_t>(lo), .m_hi = reinterpret_cast<uintptr_t>(hi), .m_ownerOrd = ord });
+        });
+    }
+    if (ranges.empty())
+    {
+        return isReferenced;
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const OwnedRange& a, const OwnedRange& b) { return a.m_lo < b.m_lo; });
+
+    // Conservatively treat every word on the stack that points into an owned range as a reference.
+    // Stale words in the unused part of the stack may keep some code alive longer than necessary, but never cause premature free.
+    //
+    auto scanRange = [&](const void* begin, const void* end) {
+        const uint64_t* ptr = reinterpret_cast<const uint64_t*>(RoundUpToMultipleOf<8>(reinterpret_cast<uintptr_t>(begin)));
+        const uint64_t* ptrEnd = reinterpret_cast<const uint64_t*>(end);
+        uintptr_t minAddr = ranges.front().m_lo;
+        uintptr_t maxAddr = ranges.back().m_hi;
+        for (; ptr < ptrEnd; ptr++)
+        {
+            uintptr_t value = *ptr;
+            if (likely(value < minAddr || value > maxAddr))
+            {
+                continue;
+            }
+            auto it = std::upper_bound(ranges.begin(), ranges.end(), value, [](uintptr_t v, const OwnedRange& r) { return v < r.m_lo; });
+            if (it == ranges.begin())
+            {
+                continue;
+            }
+            --it;
+            // Note that a return address may point right past the end of a range if the last instruction is a call,
+            // in which case it may also coincide with the start of the next range
+            //
+            if (value <= it->m_hi)
+            {
+                isReferenced[it->m_ownerOrd] = true;
+            }
+            if (value == it->m_lo && it != ranges.begin() && (it - 1)->m_hi == value)
+            {
+                isReferenced[(it - 1)->m_ownerOrd] = true;
+            }
+        }
+    };
+
+    // The guest language stack: all guest frames store their return address in the StackFrameHeader.
+    // SOM has no coroutines, so the root coroutine is the only guest stack.
+    //
+    {
+        CoroutineRuntimeContext* rc = vm->GetRootCoroutine();
+        scanRange(rc->m_stackBegin, rc->m_stackEnd);
+    }
+
+    // The native stack: JIT code may call into C++ helpers, which may reach here
+    //
+    {
+        pthread_attr_t attr;
+        int ret = pthread_getattr_np(pthread_self(), &attr);
+        TestAssert(ret == 0);
+        std::ignore = ret;
+        void* stackAddr;
+        size_t stackSize;
+        ret = pthread_attr_getstack(&attr, &stackAddr, &stackSize);
+        TestAssert(ret == 0);
+        pthread_attr_destroy(&attr);
+        scanRange(__builtin_frame_address(0), reinterpret_cast<uint8_t*>(stackAddr) + stackSize);
+    }
+
+    return isReferenced;
+}
+
+void ReclaimJettisonedBaselineJitCode(VM* vm)
+{
+    std::vector<BaselineCodeBlock*>& jettisonedList = vm->GetJettisonedBaselineCodeBlocks();
+    if (jettisonedList.empty())
+    {
+        return;
+    }
+
+    std::vector<bool> isReferenced = FindBaselineCodeBlocksReferencedFromStack(vm, jettisonedList);
+
+    // Free everything not referenced, and keep the rest for the next sweep
+    //
+    size_t numKept = 0;
+    for (size_t ord = 0; ord < jettisonedList.size(); ord++)
+    {
+        BaselineCodeBlock* bcb = jettisonedList[ord];
+        if (isReferenced[ord])
+        {
+            jettisonedList[numKept] = bcb;
+            numKept++;
+        }
+        else
+        {
+            FreeJitCodeOwnedByBaselineCodeBlock(vm, bcb);
+            vm->IncrementNumTotalBaselineJitCodeReclaimed();
+        }
+    }
+    jettisonedList.resize(numKept);
+}
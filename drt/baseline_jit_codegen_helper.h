@@ -20,7 +20,11 @@ struct BytecodeBaselineJitTraits
     uint8_t m_numCondBrLatePatches;
     uint8_t m_numCallIcSites;
     uint16_t m_callIcSiteOffsetInSlowPathData;
-    uint16_t m_unused;
+    // The generic IC sites are also stored as an array in the SlowPathData
+    // This is only needed to reclaim the IC stubs owned by the JIT code when the JIT code is freed
+    //
+    uint8_t m_numGenericIcSites;
+    uint8_t m_genericIcSiteOffsetInSlowPathData;
 };
 // Make sure the size of this struct is a power of 2 to make addressing cheap
 //
@@ -133,3 +137,29 @@ extern "C" BaselineCodeBlockAndEntryPoint NO_INLINE WARN_UNUSED deegen_prepare_t
 // Returns the entry point corresponding to 'curBytecode'
 //
 extern "C" BaselineCodeBlockAndEntryPoint NO_INLINE WARN_UNUSED deegen_prepare_osr_entry_into_baseline_jit(CodeBlock* cb, void* curBytecode);
+
+// Baseline JIT code lifetime management
+//
+// Each BaselineCodeBlock owns its JIT region, and all the call IC and generic IC stubs created at the IC sites in its SlowPathData.
+// The only references to the JIT code from outside are:
+// (1) The best entry point of the owner CodeBlock, and all the interpreter and JIT call ICs caching on the owner CodeBlock.
+//     These are all redirected back to the interpreter when the JIT code is jettisoned (see CodeBlock::UpdateBestEntryPoint).
+// (2) Return addresses in stack frames that are still executing the JIT code (or its IC stubs).
+//
+// So jettisoning is done in two steps: JettisonBaselineJitCode removes all references of kind (1), and queues the
+// BaselineCodeBlock for reclamation. Then ReclaimJettisonedBaselineJitCode conservatively scans the stacks for references
+// of kind (2), and frees the JIT code and IC stubs of every queued BaselineCodeBlock that is not referenced.
+//
+// Note that the BaselineCodeBlock itself lives in the system heap and is never freed, since it is small and the system heap
+// has no way to free memory anyway. It also means a stale pointer to a jettisoned BaselineCodeBlock is always safe to dereference.
+//
+
+// Jettison the baseline JIT code of 'cb', so all future calls go to the interpreter again (and may tier up again later).
+// 'cb' must currently have baseline JIT code, and no frame may be executing that code: a running frame finds its SlowPathData
+// through 'cb->m_baselineCodeBlock', which is cleared here (and may later point to a different BaselineCodeBlock after a re-tier-up).
+//
+void JettisonBaselineJitCode(CodeBlock* cb);
+
+// Free the JIT code of all the jettisoned BaselineCodeBlocks that are not executing on any stack frame
+//
+void ReclaimJettisonedBaselineJitCode(VM* vm);
@@ -344,6 +344,35 @@ public:
         }
     }
 
+    // Call 'emitFn' to emit bytecodes that use the constant 'cst', but make them use a new constant table entry that is not
+    // shared with any other use of the same value, neither earlier nor later, so the entry may be patched at runtime.
+    // Returns the ordinal of the new entry
+    //
+    template<typename Func>
+    int64_t WARN_UNUSED EmitWithUnsharedConstant(TValue cst, const Func& emitFn)
+    {
+        Assert(!isDecodingMode);
+        uint64_t v = cst.m_value;
+        auto it = m_constantTableLocationMap.find(v);
+        bool hasOldEntry = (it != m_constantTableLocationMap.end());
+        uint64_t oldOrd = hasOldEntry ? it->second : 0;
+
+        uint64_t constantTableOrd = m_constantTable.size();
+        m_constantTable.push_back(v);
+        m_constantTableLocationMap[v] = constantTableOrd;
+        emitFn();
+
+        if (hasOldEntry)
+        {
+            m_constantTableLocationMap[v] = oldOrd;
+        }
+        else
+        {
+            m_constantTableLocationMap.erase(v);
+        }
+        return -static_cast<int64_t>(constantTableOrd) - 1;
+    }
+
 protected:
     template<typename MetadataType>
     void RegisterMetadataField(uint8_t* ptr)
@@ -1,8 +1,20 @@
 #include "dfg_arena.h"
-#include "deegen_options.h"
 
 namespace dfg {
 
-Arena* const g_arena = x_allow_baseline_jit_tier_up_to_optimizing_jit ? Arena::Create() : nullptr;
+thread_local constinit Arena* g_arena = nullptr;
+
+void CreateArenaForCurrentThread()
+{
+    TestAssert(g_arena == nullptr);
+    g_arena = Arena::Create();
+}
+
+void DestroyArenaForCurrentThread()
+{
+    TestAssert(g_arena != nullptr);
+    g_arena->Destroy();
+    g_arena = nullptr;
+}
 
 }   // namespace dfg
@@ -197,6 +197,21 @@ public:
         return reinterpret_cast<uint8_t*>(res);
     }
 
+    // The number of bytes handed out since the last Reset(), including alignment padding
+    //
+    size_t WARN_UNUSED GetNumBytesAllocated()
+    {
+        uintptr_t base = reinterpret_cast<uintptr_t>(this);
+        return m_curPtr - (base + RoundUpToPO2Alignment(sizeof(Arena), x_minimum_alignment));
+    }
+
+    // The number of bytes currently backed by populated memory, including the Arena header itself
+    //
+    size_t WARN_UNUSED GetNumBytesCommitted()
+    {
+        return m_boundaryPtr - reinterpret_cast<uintptr_t>(this);
+    }
+
     // Free everything in the arena
     //
     void Reset()
@@ -221,6 +236,11 @@ public:
         return res;
     }
 
+    void Destroy()
+    {
+        do_munmap(this, 1ULL << 31);
+    }
+
 private:
     Arena()
     {
@@ -320,7 +340,13 @@ private:
 // but if we compile with PIC/PIE, each access will need to go through the GOT which is much slower
 // We should either make it inline or enable LTO
 //
-extern Arena* const g_arena;
+// Each thread that owns a VM has its own arena, since VMs on different threads may compile concurrently
+// The arena is created and destroyed together with the VM (see VM::Initialize and VM::Cleanup)
+//
+extern thread_local constinit Arena* g_arena;
+
+void CreateArenaForCurrentThread();
+void DestroyArenaForCurrentThread();
 
 inline Arena* ALWAYS_INLINE WARN_UNUSED DfgAlloc()
 {
@@ -0,0 +1,182 @@
+#include "dfg_compile_pipeline.h"
+#include "dfg_arena.h"
+#include "dfg_frontend.h"
+#include "dfg_prediction_propagation.h"
+#include "dfg_speculation_assignment.h"
+#include "dfg_phantom_insertion.h"
+#include "dfg_register_bank_assignment.h"
+#include "dfg_stack_layout_planning.h"
+#include "dfg_backend.h"
+#include "jit_memory_allocator.h"
+#include "vm.h"
+
+namespace dfg {
+
+static size_t WARN_UNUSED GetNumNodesInGraph(Graph* graph)
+{
+    size_t result = 0;
+    for (BasicBlock* bb : graph->m_blocks)
+    {
+        result += bb->m_nodes.size();
+    }
+    return result;
+}
+
+void DfgCompileStats::Accumulate(const DfgCompileStats& other)
+{
+    m_frontendTime += other.m_frontendTime;
+    m_predictionPropagationTime += other.m_predictionPropagationTime;
+    m_speculationAssignmentTime += other.m_speculationAssignmentTime;
+    m_phantomInsertionTime += other.m_phantomInsertionTime;
+    m_registerBankAssignmentTime += other.m_registerBankAssignmentTime;
+    m_stackLayoutPlanningTime += other.m_stackLayoutPlanningTime;
+    m_backendTime += other.m_backendTime;
+    m_numNodesAfterFrontend += other.m_numNodesAfterFrontend;
+    m_numNodesForBackend += other.m_numNodesForBackend;
+    m_numBasicBlocks += other.m_numBasicBlocks;
+    m_dfgArenaBytesAllocated = std::max(m_dfgArenaBytesAllocated, other.m_dfgArenaBytesAllocated);
+    m_dfgArenaBytesCommitted = std::max(m_dfgArenaBytesCommitted, other.m_dfgArenaBytesCommitted);
+    m_tempArenaBytesReserved = std::max(m_tempArenaBytesReserved, other.m_tempArenaBytesReserved);
+    m_jitCodeSize += other.m_jitCodeSize;
+    m_slowPathDataSize += other.m_slowPathDataSize;
+}
+
+void DfgCompileStats::Dump(FILE* file)
+{
+    double totalTime = GetTotalTime();
+    auto dumpPass = [&](const char* passName, double passTime)
+    {
+        fprintf(file, "    %-28s %10.3lf ms (%5.1lf%%)\n", passName, passTime * 1000, (totalTime > 0) ? passTime / totalTime * 100 : 0.0);
+    };
+    fprintf(file, "DFG compile-time breakdown:\n");
+    dumpPass("Frontend", m_frontendTime);
+    dumpPass("PredictionPropagation", m_predictionPropagationTime);
+    dumpPass("SpeculationAssignment", m_speculationAssignmentTime);
+    dumpPass("PhantomInsertion", m_phantomInsertionTime);
+    dumpPass("RegisterBankAssignment", m_registerBankAssignmentTime);
+    dumpPass("StackLayoutPlanning", m_stackLayoutPlanningTime);
+    dumpPass("Backend", m_backendTime);
+    fprintf(file, "    %-28s %10.3lf ms\n", "Total", totalTime * 1000);
+    fprintf(file, "    #BasicBlocks = %llu, #Nodes after frontend = %llu, #Nodes for backend = %llu\n",
+            static_cast<unsigned long long>(m_numBasicBlocks),
+            static_cast<unsigned long long>(m_numNodesAfterFrontend),
+            static_cast<unsigned long long>(m_numNodesForBackend));
+    fprintf(file, "    JIT code = %llu bytes, slow path data = %llu bytes\n",
+            static_cast<unsigned long long>(m_jitCodeSize),
+            static_cast<unsigned long long>(m_slowPathDataSize));
+    fprintf(file, "    Peak DFG arena usage = %llu bytes (%llu bytes committed), peak temp arena usage = %llu bytes\n",
+            static_cast<unsigned long long>(m_dfgArenaBytesAllocated),
+            static_cast<unsigned long long>(m_dfgArenaBytesCommitted),
+            static_cast<unsigned long long>(m_tempArenaBytesReserved));
+}
+
+DfgCodeBlock* WARN_UNUSED RunDfgCompilePipeline(CodeBlock* codeBlock, DfgCompileStats* stats /*out*/)
+{
+    DfgCompileStats localStats;
+    if (stats == nullptr)
+    {
+        stats = &localStats;
+    }
+    *stats = DfgCompileStats();
+
+    auto updateArenaUsage = [&]()
+    {
+        stats->m_dfgArenaBytesAllocated = std::max(stats->m_dfgArenaBytesAllocated, DfgAlloc()->GetNumBytesAllocated());
+        stats->m_dfgArenaBytesCommitted = std::max(stats->m_dfgArenaBytesCommitted, DfgAlloc()->GetNumBytesCommitted());
+    };
+
+    DfgCodeBlock* dcb;
+    {
+        // 'alloc' holds the pass-local results, 'resultAlloc' holds the results needed by the backend
+        //
+        TempArenaAllocator alloc;
+        TempArenaAllocator resultAlloc;
+
+        PerfTimer frontendTimer;
+        arena_unique_ptr<Graph> graph = RunDfgFrontend(codeBlock);
+        stats->m_frontendTime = frontendTimer.GetElapsedTime();
+        stats->m_numNodesAfterFrontend = GetNumNodesInGraph(graph.get());
+        stats->m_numBasicBlocks = graph->m_blocks.size();
+        updateArenaUsage();
+
+        {
+            AutoTimer t(&stats->m_predictionPropagationTime);
+            std::ignore = RunPredictionPropagation(alloc, graph.get());
+        }
+        updateArenaUsage();
+
+        {
+            AutoTimer t(&stats->m_speculationAssignmentTime);
+            RunSpeculationAssignmentPass(graph.get());
+        }
+        updateArenaUsage();
+
+        {
+            AutoTimer t(&stats->m_phantomInsertionTime);
+            RunPhantomInsertionPass(graph.get());
+        }
+        stats->m_numNodesForBackend = GetNumNodesInGraph(graph.get());
+        updateArenaUsage();
+
+        {
+            AutoTimer t(&stats->m_registerBankAssignmentTime);
+            RunRegisterBankAssignmentPass(graph.get());
+        }
+        updateArenaUsage();
+
+        PerfTimer slpTimer;
+        StackLayoutPlanningResult slpRes = RunStackLayoutPlanningPass(resultAlloc, graph.get());
+        stats->m_stackLayoutPlanningTime = slpTimer.GetElapsedTime();
+        updateArenaUsage();
+
+        PerfTimer backendTimer;
+        DfgBackendResult backendRes = RunDfgBackend(resultAlloc, graph.get(), slpRes);
+        stats->m_backendTime = backendTimer.GetElapsedTime();
+        updateArenaUsage();
+
+#ifdef TESTBUILD
+        free(backendRes.m_codegenLogDump);
+#endif
+
+        dcb = backendRes.m_dfgCodeBlock;
+        TestAssert(dcb != nullptr);
+        stats->m_jitCodeSize = dcb->m_jitRegionSize;
+        stats->m_slowPathDataSize = dcb->m_slowPathDataStreamLength;
+        stats->m_tempArenaBytesReserved = alloc.GetNumBytesReserved() + resultAlloc.GetNumBytesReserved();
+    }
+
+    // The graph has been destroyed, so everything in the DFG arena is dead now
+    //
+    DfgAlloc()->Reset();
+    return dcb;
+}
+
+void BenchmarkDfgCompilePipeline(CodeBlock* codeBlock, size_t numIterations, FILE* file)
+{
+    ReleaseAssert(numIterations > 0);
+    VM* vm = VM::GetActiveVMForCurrentThread();
+
+    DfgCompileStats total;
+    PerfTimer timer;
+    for (size_t iter = 0; iter < numIterations; iter++)
+    {
+        DfgCompileStats stats;
+        DfgCodeBlock* dcb = RunDfgCompilePipeline(codeBlock, &stats /*out*/);
+        total.Accumulate(stats);
+        vm->GetJITMemoryAlloc()->Free(dcb->m_jitRegionStart);
+    }
+    double wallTime = timer.GetElapsedTime();
+
+    double compileTime = total.GetTotalTime();
+    fprintf(file, "DFG compile benchmark: %llu iterations in %.3lf ms (%.3lf ms spent in passes)\n",
+            static_cast<unsigned long long>(numIterations), wallTime * 1000, compileTime * 1000);
+    total.Dump(file);
+    if (compileTime > 0)
+    {
+        fprintf(file, "    Throughput: %.0lf nodes/sec, %.0lf JIT code bytes/sec\n",
+                static_cast<double>(total.m_numNodesForBackend) / compileTime,
+                static_cast<double>(total.m_jitCodeSize) / compileTime);
+    }
+}
+
+}   // namespace dfg
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "common_utils.h"
+#include "runtime_utils.h"
+
+namespace dfg {
+
+// Compile-time breakdown of one DFG compilation
+// All times are in seconds, all memory usages are in bytes
+//
+struct DfgCompileStats
+{
+    DfgCompileStats() { memset(this, 0, sizeof(DfgCompileStats)); }
+
+    // Time spent in each pass
+    // The frontend time includes bytecode translation (and speculative inlining), CFG cleanup and block-local SSA construction
+    //
+    double m_frontendTime;
+    double m_predictionPropagationTime;
+    double m_speculationAssignmentTime;
+    double m_phantomInsertionTime;
+    double m_registerBankAssignmentTime;
+    double m_stackLayoutPlanningTime;
+    double m_backendTime;
+
+    // Number of DFG nodes in the graph after the frontend and after phantom insertion (i.e., what the backend sees)
+    //
+    size_t m_numNodesAfterFrontend;
+    size_t m_numNodesForBackend;
+    size_t m_numBasicBlocks;
+
+    // Peak DFG arena usage (bytes allocated, and bytes committed) observed at pass boundaries
+    //
+    size_t m_dfgArenaBytesAllocated;
+    size_t m_dfgArenaBytesCommitted;
+    // Memory held by the TempArenaAllocators owned by the pipeline at the end of the compilation
+    //
+    size_t m_tempArenaBytesReserved;
+
+    // Size of the emitted JIT code and the DfgCodeBlock slow path data
+    //
+    size_t m_jitCodeSize;
+    size_t m_slowPathDataSize;
+
+    double GetTotalTime()
+    {
+        return m_frontendTime + m_predictionPropagationTime + m_speculationAssignmentTime + m_phantomInsertionTime +
+            m_registerBankAssignmentTime + m_stackLayoutPlanningTime + m_backendTime;
+    }
+
+    // Accumulate the stats of another compilation into this one (time and sizes are summed, peak memory usages are max'ed)
+    //
+    void Accumulate(const DfgCompileStats& other);
+
+    void Dump(FILE* file);
+};
+
+// Run the whole DFG pipeline on 'codeBlock' and return the generated DfgCodeBlock.
+// This does not install the DfgCodeBlock into 'codeBlock'.
+// If 'stats' is not nullptr, the per-pass compile-time breakdown is written to it.
+//
+// The DFG arena is reset at the end of the compilation, so no other DFG graph may be alive when this function is called.
+//
+DfgCodeBlock* WARN_UNUSED RunDfgCompilePipeline(CodeBlock* codeBlock, DfgCompileStats* stats /*out*/);
+
+// Compile 'codeBlock' with the DFG 'numIterations' times using the value profiles currently recorded in the bytecode metadata,
+// and print the accumulated per-pass breakdown, the nodes/sec and the bytes emitted/sec to 'file'.
+// The JIT code generated by each iteration is freed, but the DfgCodeBlocks themselves are leaked since
+// they live in the system heap, so this should only be used for benchmarking.
+//
+void BenchmarkDfgCompilePipeline(CodeBlock* codeBlock, size_t numIterations, FILE* file);
+
+}   // namespace dfg
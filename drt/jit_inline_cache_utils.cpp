@@ -20,6 +20,12 @@ JitGenericInlineCacheEntry* WARN_UNUSED JitGenericInlineCacheEntry::Create(VM* v
     return entry;
 }
 
+void JitGenericInlineCacheEntry::Destroy(VM* vm)
+{
+    vm->GetJITMemoryAlloc()->Free(m_jitAddr);
+    vm->DeallocateSpdsRegionObject(this);
+}
+
 void* WARN_UNUSED JitGenericInlineCacheSite::InsertForBaselineJIT(uint16_t traitKind)
 {
     Assert(m_numEntries < x_maxJitGenericInlineCacheEntries);
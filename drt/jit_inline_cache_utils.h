@@ -80,6 +80,12 @@ public:
                                                           uint16_t icTraitKind,
                                                           uint8_t allocationStepping);
 
+    // Free the JIT code stub and the entry itself.
+    // Like JitCallInlineCacheEntry::Destroy, this doesn't do anything about the singly-linked list anchored at the call site,
+    // so the only valid use case is when the owner of the call site decides to destroy all the IC it owns.
+    //
+    void Destroy(VM* vm);
+
     // The singly-linked list anchored at the callsite, 0 if last node
     //
     SpdsPtr<JitGenericInlineCacheEntry> m_nextNode;
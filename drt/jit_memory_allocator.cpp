@@ -12,28 +12,59 @@ void JitMemoryLargeAllocationHeader::Destroy()
     do_munmap(this, GetSize());
 }
 
+void* WARN_UNUSED JitMemoryAllocator::ReserveNewRange()
+{
+    static_assert(x_reserveRangeSize % x_hugePageSize == 0);
+    constexpr int x_protFlags = PROT_READ | PROT_WRITE | PROT_EXEC;
+
+    // First try to use explicit 2MB huge pages. Note that we do not pass MAP_NORESERVE, so the huge pages are reserved at mmap time,
+    // and the mmap fails cleanly if the hugetlb pool is not large enough (instead of SIGBUS at page fault time).
+    //
+    // Not all kernels honor MAP_32BIT for hugetlb mappings, so we must also check that the range is indeed in the low 2GB.
+    //
+    {
+        void* r = mmap(nullptr, x_reserveRangeSize, x_protFlags, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT) /*2MB*/, -1, 0);
+        if (r != MAP_FAILED)
+        {
+            if (reinterpret_cast<uint64_t>(r) + x_reserveRangeSize <= (1ULL << 31))
+            {
+                Assert(reinterpret_cast<uint64_t>(r) % x_hugePageSize == 0);
+                return r;
+            }
+            do_munmap(r, x_reserveRangeSize);
+        }
+    }
+
+    // Fallback to normal pages with transparent huge page hint.
+    // The range is mapped upfront but committed lazily, so only the pages we actually carve out are backed by physical memory.
+    // madvise may fail if transparent huge page is not supported by the kernel, which is harmless.
+    //
+    void* r = do_mmap_with_custom_alignment(x_hugePageSize /*alignment*/, x_reserveRangeSize, x_protFlags, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_32BIT);
+    std::ignore = madvise(r, x_reserveRangeSize, MADV_HUGEPAGE);
+    return r;
+}
+
 JitMemoryPageHeader* WARN_UNUSED JitMemoryAllocator::AllocateUninitalizedPage()
 {
     constexpr size_t x_pageSize = JitMemoryPageHeaderBase::x_pageSize;
     if (unlikely(m_reservedRangeCur == m_reservedRangeEnd))
     {
-        void* reservedRange = do_mmap_with_custom_alignment(x_pageSize /*alignment*/, x_reserveRangeSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_32BIT);
+        void* reservedRange = ReserveNewRange();
         m_reservedRangeCur = reinterpret_cast<uint64_t>(reservedRange);
-        Assert(m_reservedRangeCur % x_pageSize == 0);
+        Assert(m_reservedRangeCur % x_hugePageSize == 0);
         m_reservedRangeEnd = m_reservedRangeCur + x_reserveRangeSize;
 
         m_unmapList.push_back(reservedRange);
     }
 
+    // The reserved range is already mapped, so we simply carve out the next page.
+    // Pages are handed out sequentially, so the pages of one allocator are packed densely in as few huge pages as possible.
+    //
     Assert(m_reservedRangeCur + x_pageSize <= m_reservedRangeEnd);
     Assert(m_reservedRangeCur % x_pageSize == 0);
     void* pageAddr = reinterpret_cast<void*>(m_reservedRangeCur);
     m_reservedRangeCur += x_pageSize;
 
-    void* r = mmap(pageAddr, x_pageSize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_FIXED, -1, 0);
-    VM_FAIL_WITH_ERRNO_IF(r == MAP_FAILED, "Failed to allocate JIT memory of size %llu", static_cast<unsigned long long>(x_pageSize));
-    Assert(pageAddr == r);
-
     m_totalOsMemoryUsage += x_pageSize;
 
     return reinterpret_cast<JitMemoryPageHeader*>(pageAddr);
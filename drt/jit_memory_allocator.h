@@ -465,6 +465,10 @@ private:
     //
     JitMemoryPageHeader* WARN_UNUSED AllocateUninitalizedPage();
 
+    // Map a new x_reserveRangeSize range, backed by huge pages if possible
+    //
+    static void* WARN_UNUSED ReserveNewRange();
+
     // Deallocate everything and free all memory to OS.
     //
     void Shutdown();
@@ -483,11 +487,15 @@ private:
 
     // mmap returns 4KB-aligned memory but we want 16KB-aligned memory.
     // Of course one can do this by allocate 32KB with one mmap then cut off the unaligned parts with two munmap,
-    // but to make things better, we reserve (not allocate) x_reserveRangeSize memory range from OS once,
-    // then use MAP_FIXED to turn them into usable memory as needed
+    // but to make things better, we map a x_reserveRangeSize memory range from OS once, then carve pages out of it as needed.
+    //
+    // The range is 2MB-aligned and backed by huge pages if possible (explicit huge pages, or transparent huge pages as fallback),
+    // so that the JIT code uses as few iTLB entries as possible.
     //
+    static constexpr size_t x_hugePageSize = 2 * 1024 * 1024;
     static constexpr size_t x_reserveRangeSize = 16 * 1024 * 1024;
     static_assert(x_reserveRangeSize % JitMemoryPageHeaderBase::x_pageSize == 0);
+    static_assert(x_hugePageSize % JitMemoryPageHeaderBase::x_pageSize == 0);
 
     uint64_t m_reservedRangeCur;
     uint64_t m_reservedRangeEnd;
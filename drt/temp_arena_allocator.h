@@ -57,7 +57,7 @@ public:
         }
 
         {
-            // std::lock_guard<std::mutex> guard(m_lock);
+            std::lock_guard<std::mutex> guard(m_lock);
             if (m_freeListSize < x_maxChunksInMemoryPool)
             {
                 m_freeListSize++;
@@ -78,7 +78,7 @@ private:
     //
     uintptr_t WARN_UNUSED TryGetMemoryChunk()
     {
-        // std::lock_guard<std::mutex> guard(m_lock);
+        std::lock_guard<std::mutex> guard(m_lock);
 
         if (m_freeList == 0)
         {
@@ -92,7 +92,9 @@ private:
         return result;
     }
 
-    // std::mutex m_lock;
+    // Arenas may be created and destroyed on multiple threads (e.g., the class file parsing threads)
+    //
+    std::mutex m_lock;
     size_t m_freeListSize;
     uintptr_t m_freeList;
 };
@@ -156,6 +158,27 @@ public:
         FreeAllMemoryChunks();
     }
 
+    // The total size of memory chunks currently owned by this allocator
+    // This includes the unused tail of the current chunk, so it is an upper bound of the bytes actually allocated
+    //
+    size_t WARN_UNUSED GetNumBytesReserved() const
+    {
+        size_t result = 0;
+        uintptr_t cur = m_listHead;
+        while (cur != 0)
+        {
+            result += x_tempArenaAllocatorPageSize;
+            cur = *reinterpret_cast<uintptr_t*>(cur);
+        }
+        cur = m_customSizeListHead;
+        while (cur != 0)
+        {
+            result += reinterpret_cast<uintptr_t*>(cur)[1];
+            cur = reinterpret_cast<uintptr_t*>(cur)[0];
+        }
+        return result;
+    }
+
     class Mark
     {
         friend TempArenaAllocator;
@@ -0,0 +1,220 @@
+#include "som_embed.h"
+#include "som_compile_file.h"
+#include "som_class.h"
+#include "som_utils.h"
+#include "runtime_utils.h"
+#include "deegen_options.h"
+#include "deegen_enter_vm_from_c.h"
+
+SOMEmbeddedVM* WARN_UNUSED SOMEmbeddedVM::Create(const Options& options)
+{
+    VM* vm = VM::Create();
+    vm->m_classLoadPaths = options.m_classLoadPaths;
+
+    vm->SetHeapBackingPolicy(options.m_heapBackingPolicy);
+    vm->SetUserHeapPrefaultDistance(options.m_heapPrefaultDistance);
+
+    vm->SetEngineMaxTier(options.m_engineMaxTier);
+    if (x_allow_interpreter_tier_up_to_baseline_jit && options.m_engineMaxTier != VM::EngineMaxTier::Interpreter)
+    {
+        vm->SetEngineStartingTier(VM::EngineStartingTier::BaselineJIT);
+    }
+
+    SOMInitializationResult r = SOMBootstrapClassHierarchy(options.m_preloadClasses);
+
+    SOMEmbeddedVM* res = new SOMEmbeddedVM();
+    res->m_vm = vm;
+    res->m_systemClass = r.m_systemClass;
+    res->m_systemInstance = r.m_systemInstance;
+    return res;
+}
+
+void SOMEmbeddedVM::Destroy()
+{
+    TestAssert(VM::GetActiveVMForCurrentThread() == m_vm);
+    m_vm->Destroy();
+    delete this;
+}
+
+SOMClass* WARN_UNUSED SOMEmbeddedVM::LoadClass(const std::string& className)
+{
+    TestAssert(VM::GetActiveVMForCurrentThread() == m_vm);
+    return SOMCompileFile(className);
+}
+
+SOMClass* WARN_UNUSED SOMEmbeddedVM::LoadClassFromSource(const std::string& className, std::string source)
+{
+    TestAssert(VM::GetActiveVMForCurrentThread() == m_vm);
+    SOMAddInMemoryClassSource(className, std::move(source));
+    return SOMCompileFile(className);
+}
+
+HeapPtr<FunctionObject> WARN_UNUSED SOMEmbeddedVM::LookupMethod(SOMClass* cl, std::string_view selector)
+{
+    TestAssert(VM::GetActiveVMForCurrentThread() == m_vm);
+    return SOMGetMethodFromClass(cl, selector);
+}
+
+HeapPtr<FunctionObject> WARN_UNUSED SOMEmbeddedVM::LookupClassMethod(SOMClass* cl, std::string_view selector)
+{
+    TestAssert(VM::GetActiveVMForCurrentThread() == m_vm);
+    TestAssert(cl->m_classObject != nullptr);
+    HeapPtr<SOMClass> metaclass = SystemHeapPointer<SOMClass>(cl->m_classObject->m_hiddenClass).As();
+    return SOMGetMethodFromClass(TranslateToRawPointer(metaclass), selector);
+}
+
+SOMEmbeddedValue WARN_UNUSED SOMEmbeddedVM::GetClassObject(SOMClass* cl)
+{
+    TestAssert(cl->m_classObject != nullptr);
+    return SOMEmbeddedValue::Object(TValue::Create<tObject>(TranslateToHeapPtr(cl->m_classObject)));
+}
+
+TValue WARN_UNUSED SOMEmbeddedVM::ToTValue(const SOMEmbeddedValue& value)
+{
+    switch (value.m_kind)
+    {
+    case SOMEmbeddedValue::Kind::Nil:
+    {
+        return TValue::Create<tNil>();
+    }
+    case SOMEmbeddedValue::Kind::Boolean:
+    {
+        return TValue::Create<tBool>(value.m_bool);
+    }
+    case SOMEmbeddedValue::Kind::Integer:
+    {
+        return MakeSOMInteger(value.m_integer);
+    }
+    case SOMEmbeddedValue::Kind::Double:
+    {
+        return TValue::Create<tDouble>(value.m_double);
+    }
+    case SOMEmbeddedValue::Kind::String:
+    {
+        SOMObject* str = SOMObject::AllocateString(value.m_string);
+        return TValue::Create<tObject>(TranslateToHeapPtr(str));
+    }
+    case SOMEmbeddedValue::Kind::Object:
+    {
+        return value.m_object;
+    }
+    }   /*switch*/
+    ReleaseAssert(false);
+    __builtin_unreachable();
+}
+
+SOMEmbeddedValue WARN_UNUSED SOMEmbeddedVM::FromTValue(TValue value)
+{
+    if (value.Is<tNil>())
+    {
+        return SOMEmbeddedValue::Nil();
+    }
+    if (value.Is<tBool>())
+    {
+        return SOMEmbeddedValue::Boolean(value.As<tBool>());
+    }
+    if (value.Is<tDouble>())
+    {
+        return SOMEmbeddedValue::Double(value.As<tDouble>());
+    }
+    int64_t intValue;
+    if (TryGetSOMIntegerValue(value, &intValue /*out*/))
+    {
+        return SOMEmbeddedValue::Integer(intValue);
+    }
+    // Symbols are strings as well, but they are kept opaque so the host can pass them back as symbols
+    //
+    if (value.Is<tObject>())
+    {
+        HeapPtr<SOMObject> o = value.As<tObject>();
+        if (o->m_arrayType == SOM_String && SystemHeapPointer<SOMClass>(o->m_hiddenClass).As() != m_vm->m_symbolClass)
+        {
+            SOMObject* raw = TranslateToRawPointer(o);
+            size_t len = raw->m_data[0].m_value;
+            return SOMEmbeddedValue::String(std::string(reinterpret_cast<char*>(&raw->m_data[1]), len));
+        }
+    }
+    return SOMEmbeddedValue::Object(value);
+}
+
+bool WARN_UNUSED SOMEmbeddedVM::Invoke(HeapPtr<FunctionObject> fn, const SOMEmbeddedValue& receiver, std::span<const SOMEmbeddedValue> args, SOMEmbeddedValue& result /*out*/)
+{
+    TestAssert(VM::GetActiveVMForCurrentThread() == m_vm);
+    ReleaseAssert(fn != nullptr);
+
+    HeapPtr<ExecutableCode> ec = TCGet(fn->m_executable).As();
+    if (!ec->m_hasVariadicArguments && ec->m_numFixedArguments != args.size() + 1)
+    {
+        fprintf(stderr, "Method expects %u arguments, but %u were given.\n",
+                static_cast<unsigned int>(ec->m_numFixedArguments - 1), static_cast<unsigned int>(args.size()));
+        abort();
+    }
+
+    // The arguments are converted before entering the VM, since converting a string allocates
+    //
+    std::vector<TValue> aa;
+    aa.reserve(args.size() + 1);
+    aa.push_back(ToTValue(receiver));
+    for (const SOMEmbeddedValue& arg : args)
+    {
+        aa.push_back(ToTValue(arg));
+    }
+
+    // 'System>>exit:' returns control to the host instead of terminating the process.
+    // It unwinds the whole VM stack and closes all upvalues, so the root coroutine is ready for the next call.
+    //
+    bool oldReturnToHostOnExit = m_vm->m_returnToHostOnExit;
+    m_vm->m_returnToHostOnExit = true;
+
+    CoroutineRuntimeContext* rc = m_vm->GetRootCoroutine();
+    auto [retStart, numRets] = DeegenEnterVMFromC(rc, fn, rc->m_stackBegin, aa.data(), aa.size());
+    m_vm->m_returnToHostOnExit = oldReturnToHostOnExit;
+    if (m_vm->m_exitRequested)
+    {
+        m_vm->m_exitRequested = false;
+        return false;
+    }
+
+    // The returned values live on the VM stack, so they must be converted before the next call into the VM
+    //
+    result = (numRets > 0) ? FromTValue(retStart[0]) : SOMEmbeddedValue::Nil();
+    return true;
+}
+
+bool WARN_UNUSED SOMEmbeddedVM::RunProgram(const std::vector<std::string>& args)
+{
+    HeapPtr<FunctionObject> runFn = SOMGetMethodFromClass(m_systemClass, "initialize:");
+    TestAssert(runFn != nullptr);
+
+    SOMObject* argsArr = SOMObject::AllocateArray(args.size());
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        SOMObject* str = SOMObject::AllocateString(args[i]);
+        argsArr->m_data[i + 1] = TValue::Create<tObject>(TranslateToHeapPtr(str));
+    }
+
+    SOMEmbeddedValue systemInstance = SOMEmbeddedValue::Object(TValue::Create<tObject>(TranslateToHeapPtr(m_systemInstance)));
+    SOMEmbeddedValue result;
+    return Invoke(runFn, systemInstance, { SOMEmbeddedValue::Object(TValue::Create<tObject>(TranslateToHeapPtr(argsArr))) }, result /*out*/);
+}
+
+SOMEmbeddedVMStats WARN_UNUSED SOMEmbeddedVM::GetStats()
+{
+    VM::ProcessMemoryStats memStats = VM::GetProcessMemoryStats();
+
+    return SOMEmbeddedVMStats {
+        .m_baselineJitCompilations = m_vm->GetNumTotalBaselineJitCompilations(),
+        .m_baselineJitCodeReclaimed = m_vm->GetNumTotalBaselineJitCodeReclaimed(),
+        .m_jitCodeSize = m_vm->GetTotalJITCodeSize(),
+        .m_globalWatchpointsFired = m_vm->GetNumGlobalWatchpointsFired(),
+        .m_lazyMethodStubs = m_vm->m_numLazyMethodStubs,
+        .m_lazyMethodsCompiled = m_vm->m_numLazyMethodsCompiled,
+        .m_classesPreparsed = m_vm->m_numClassesPreparsed,
+        .m_userHeapMappedBytes = m_vm->GetUserHeapMappedSize(),
+        .m_systemHeapMappedBytes = m_vm->GetSystemHeapMappedSize(),
+        .m_minorPageFaults = memStats.m_minorPageFaults,
+        .m_majorPageFaults = memStats.m_majorPageFaults,
+        .m_rssKb = memStats.m_rssKb,
+        .m_peakRssKb = memStats.m_peakRssKb
+    };
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "common_utils.h"
+#include "heap_ptr_utils.h"
+#include "tvalue.h"
+#include "vm.h"
+
+class SOMClass;
+class FunctionObject;
+
+// The API for embedding the SOM engine into a host program (the 'dsom_embed' library)
+//
+// Unlike the 'dsom' executable, which runs one program per process, the host keeps a VM alive and calls into it
+// as many times as it wants, so the JIT'ed code and the inline caches warmed up by earlier calls are reused by later calls.
+//
+// Typical usage:
+//     SOMEmbeddedVM* vm = SOMEmbeddedVM::Create(options);
+//     SOMClass* cl = vm->LoadClass("MyService");
+//     HeapPtr<FunctionObject> fn = vm->LookupClassMethod(cl, "handle:with:");
+//     for each request:
+//         SOMEmbeddedValue result;
+//         if (!vm->Invoke(fn, vm->GetClassObject(cl), { SOMEmbeddedValue::String(...), SOMEmbeddedValue::Integer(...) }, result /*out*/)) { ... }
+//     vm->Destroy();
+//
+// The VM is bound to the thread that created it (it is found through a per-thread segment register),
+// so all calls on a SOMEmbeddedVM must be made on that thread, and each thread may have at most one VM.
+// Different threads may each have their own VM.
+//
+// Errors in the SOM program (e.g., a message not understood) are fatal, same as in the 'dsom' executable.
+//
+
+// A value passed to or returned from SOM code
+//
+// Nil, booleans, integers, doubles and strings are converted to and from the corresponding C++ types.
+// Any other SOM value (e.g., an instance of an application class) is kept opaque as 'Object', and can only be passed back to SOM code.
+// Strings are copied, but an 'Object' value refers to the object in the VM heap, so it must not outlive the VM.
+//
+struct SOMEmbeddedValue
+{
+    enum class Kind : uint8_t
+    {
+        Nil,
+        Boolean,
+        Integer,
+        Double,
+        String,
+        Object
+    };
+
+    static SOMEmbeddedValue WARN_UNUSED Nil() { return SOMEmbeddedValue(); }
+
+    static SOMEmbeddedValue WARN_UNUSED Boolean(bool value)
+    {
+        SOMEmbeddedValue r;
+        r.m_kind = Kind::Boolean;
+        r.m_bool = value;
+        return r;
+    }
+
+    static SOMEmbeddedValue WARN_UNUSED Integer(int64_t value)
+    {
+        SOMEmbeddedValue r;
+        r.m_kind = Kind::Integer;
+        r.m_integer = value;
+        return r;
+    }
+
+    static SOMEmbeddedValue WARN_UNUSED Double(double value)
+    {
+        SOMEmbeddedValue r;
+        r.m_kind = Kind::Double;
+        r.m_double = value;
+        return r;
+    }
+
+    static SOMEmbeddedValue WARN_UNUSED String(std::string value)
+    {
+        SOMEmbeddedValue r;
+        r.m_kind = Kind::String;
+        r.m_string = std::move(value);
+        return r;
+    }
+
+    static SOMEmbeddedValue WARN_UNUSED Object(TValue value)
+    {
+        SOMEmbeddedValue r;
+        r.m_kind = Kind::Object;
+        r.m_object = value;
+        return r;
+    }
+
+    Kind m_kind = Kind::Nil;
+    bool m_bool = false;
+    int64_t m_integer = 0;
+    double m_double = 0;
+    std::string m_string;
+    TValue m_object;
+};
+
+// Engine statistics, the same as those written by 'dsom --stats-json'
+//
+struct SOMEmbeddedVMStats
+{
+    uint32_t m_baselineJitCompilations;
+    uint32_t m_baselineJitCodeReclaimed;
+    uint64_t m_jitCodeSize;
+    uint32_t m_globalWatchpointsFired;
+    uint32_t m_lazyMethodStubs;
+    uint32_t m_lazyMethodsCompiled;
+    uint32_t m_classesPreparsed;
+    uint64_t m_userHeapMappedBytes;
+    uint64_t m_systemHeapMappedBytes;
+    // Page faults and RSS of the whole process, an RSS is -1 if unavailable
+    //
+    uint64_t m_minorPageFaults;
+    uint64_t m_majorPageFaults;
+    int64_t m_rssKb;
+    int64_t m_peakRssKb;
+};
+
+class SOMEmbeddedVM
+{
+public:
+    struct Options
+    {
+        // The directories to search for class files, in order
+        // Must include the SOM standard library (the 'Smalltalk' directory)
+        //
+        std::vector<std::string> m_classLoadPaths;
+        VM::EngineMaxTier m_engineMaxTier = VM::EngineMaxTier::Unrestricted;
+        VM::HeapBackingPolicy m_heapBackingPolicy = VM::HeapBackingPolicy::LazyHugePages;
+        // See VM::SetUserHeapPrefaultDistance
+        //
+        size_t m_heapPrefaultDistance = 0;
+        // Classes the host is going to load, they are parsed in parallel with the system classes during bootstrap
+        //
+        std::vector<std::string> m_preloadClasses;
+    };
+
+    // Create and bootstrap a VM on the current thread
+    //
+    static SOMEmbeddedVM* WARN_UNUSED Create(const Options& options);
+
+    // Destroy the VM, must be called on the thread that created it
+    //
+    void Destroy();
+
+    // Load a class (and its superclasses) from the class path, or return the class if it has been loaded
+    //
+    SOMClass* WARN_UNUSED LoadClass(const std::string& className);
+
+    // Load a class from 'source' instead of '<className>.som' in the class path
+    // The class must not have been loaded. Its superclass is loaded as usual.
+    //
+    SOMClass* WARN_UNUSED LoadClassFromSource(const std::string& className, std::string source);
+
+    // Look up an instance method (e.g., "foo", "+", "at:put:") of the class, return nullptr if not found
+    // The returned function can be invoked any number of times with an instance of the class as the receiver
+    //
+    HeapPtr<FunctionObject> WARN_UNUSED LookupMethod(SOMClass* cl, std::string_view selector);
+
+    // Look up a class-side method of the class, return nullptr if not found
+    // The receiver should be GetClassObject(cl)
+    //
+    HeapPtr<FunctionObject> WARN_UNUSED LookupClassMethod(SOMClass* cl, std::string_view selector);
+
+    // The class object of the class (i.e., the value of the global named by the class name)
+    //
+    SOMEmbeddedValue WARN_UNUSED GetClassObject(SOMClass* cl);
+
+    // Invoke 'fn' with 'receiver' as 'self' and 'args' as the arguments, the number of arguments must match the selector
+    //
+    // Return true and store the return value to 'result' if the method returns normally.
+    // Return false if the SOM code called 'System>>exit:', in which case the exit code is available from GetExitCode().
+    // The VM can still be used after that.
+    //
+    bool WARN_UNUSED Invoke(HeapPtr<FunctionObject> fn, const SOMEmbeddedValue& receiver, std::span<const SOMEmbeddedValue> args, SOMEmbeddedValue& result /*out*/);
+
+    bool WARN_UNUSED Invoke(HeapPtr<FunctionObject> fn, const SOMEmbeddedValue& receiver, std::initializer_list<SOMEmbeddedValue> args, SOMEmbeddedValue& result /*out*/)
+    {
+        return Invoke(fn, receiver, std::span<const SOMEmbeddedValue>(args.begin(), args.size()), result /*out*/);
+    }
+
+    // Run 'System>>initialize:' with 'args', the same as running 'dsom <args...>'
+    // Return false if the program called 'System>>exit:'
+    //
+    bool WARN_UNUSED RunProgram(const std::vector<std::string>& args);
+
+    int32_t WARN_UNUSED GetExitCode() { return m_vm->m_exitCode; }
+
+    SOMEmbeddedVMStats WARN_UNUSED GetStats();
+
+    // Give back the memory of the heap pages that are not used yet, e.g., after a burst of requests
+    //
+    void ReleaseUnusedMemory() { m_vm->ReleaseUnusedHeapMemory(); }
+
+    VM* WARN_UNUSED GetVM() { return m_vm; }
+
+private:
+    TValue WARN_UNUSED ToTValue(const SOMEmbeddedValue& value);
+    SOMEmbeddedValue WARN_UNUSED FromTValue(TValue value);
+
+    VM* m_vm;
+    SOMClass* m_systemClass;
+    SOMObject* m_systemInstance;
+};
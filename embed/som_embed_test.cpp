@@ -0,0 +1,108 @@
+#include "som_embed.h"
+
+// A small host program that exercises the embedding API (see som_embed.h), and exits with a non-zero code on failure
+//
+// Usage: dsom_embed_test [path to the 'Smalltalk' directory]
+//
+
+static const char* x_testServiceSource = R"(
+EmbedTestService = (
+    ----
+    add: a to: b = ( ^ a + b )
+    echo: value = ( ^ value )
+    concat: a with: b = ( ^ a + b )
+    exitWith: code = (
+        system exit: code.
+        ^ 42
+    )
+)
+)";
+
+static size_t g_numFailures = 0;
+
+static void Check(bool cond, const char* what)
+{
+    if (!cond)
+    {
+        fprintf(stderr, "FAILED: %s\n", what);
+        g_numFailures++;
+    }
+}
+
+static bool WARN_UNUSED IsInteger(const SOMEmbeddedValue& value, int64_t expected)
+{
+    return value.m_kind == SOMEmbeddedValue::Kind::Integer && value.m_integer == expected;
+}
+
+int main(int argc, char** argv)
+{
+    SOMEmbeddedVM::Options options;
+    options.m_classLoadPaths.push_back((argc > 1) ? argv[1] : "Smalltalk");
+
+    SOMEmbeddedVM* vm = SOMEmbeddedVM::Create(options);
+
+    SOMClass* cl = vm->LoadClassFromSource("EmbedTestService", x_testServiceSource);
+    Check(cl != nullptr, "LoadClassFromSource");
+    SOMEmbeddedValue service = vm->GetClassObject(cl);
+
+    HeapPtr<FunctionObject> addFn = vm->LookupClassMethod(cl, "add:to:");
+    HeapPtr<FunctionObject> echoFn = vm->LookupClassMethod(cl, "echo:");
+    HeapPtr<FunctionObject> concatFn = vm->LookupClassMethod(cl, "concat:with:");
+    HeapPtr<FunctionObject> exitFn = vm->LookupClassMethod(cl, "exitWith:");
+    Check(addFn != nullptr && echoFn != nullptr && concatFn != nullptr && exitFn != nullptr, "LookupClassMethod");
+    Check(vm->LookupClassMethod(cl, "noSuchMethod") == nullptr, "LookupClassMethod of a missing selector");
+
+    SOMEmbeddedValue result;
+
+    // Small integers, and a result that overflows int32 into a LargeInteger
+    //
+    Check(vm->Invoke(addFn, service, { SOMEmbeddedValue::Integer(1), SOMEmbeddedValue::Integer(2) }, result /*out*/) && IsInteger(result, 3),
+          "Invoke with small integers");
+    Check(vm->Invoke(addFn, service, { SOMEmbeddedValue::Integer(2147483647), SOMEmbeddedValue::Integer(1) }, result /*out*/) && IsInteger(result, 2147483648LL),
+          "Invoke with an integer result overflowing int32");
+
+    // LargeInteger arguments round-trip through the VM
+    //
+    for (int64_t value : { static_cast<int64_t>(1) << 40, -(static_cast<int64_t>(1) << 40), std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() })
+    {
+        Check(vm->Invoke(echoFn, service, { SOMEmbeddedValue::Integer(value) }, result /*out*/) && IsInteger(result, value),
+              "LargeInteger round-trip");
+    }
+    Check(vm->Invoke(addFn, service, { SOMEmbeddedValue::Integer(static_cast<int64_t>(1) << 40), SOMEmbeddedValue::Integer(5) }, result /*out*/) &&
+          IsInteger(result, (static_cast<int64_t>(1) << 40) + 5),
+          "Invoke with a LargeInteger argument");
+
+    // Other value kinds
+    //
+    Check(vm->Invoke(concatFn, service, { SOMEmbeddedValue::String("foo"), SOMEmbeddedValue::String("bar") }, result /*out*/) &&
+          result.m_kind == SOMEmbeddedValue::Kind::String && result.m_string == "foobar",
+          "Invoke with strings");
+    Check(vm->Invoke(echoFn, service, { SOMEmbeddedValue::Double(1.5) }, result /*out*/) &&
+          result.m_kind == SOMEmbeddedValue::Kind::Double && UnsafeFloatEqual(result.m_double, 1.5),
+          "Double round-trip");
+    Check(vm->Invoke(echoFn, service, { SOMEmbeddedValue::Boolean(true) }, result /*out*/) &&
+          result.m_kind == SOMEmbeddedValue::Kind::Boolean && result.m_bool,
+          "Boolean round-trip");
+    Check(vm->Invoke(echoFn, service, { SOMEmbeddedValue::Nil() }, result /*out*/) && result.m_kind == SOMEmbeddedValue::Kind::Nil,
+          "Nil round-trip");
+    Check(vm->Invoke(echoFn, service, { service }, result /*out*/) &&
+          result.m_kind == SOMEmbeddedValue::Kind::Object && result.m_object.m_value == service.m_object.m_value,
+          "Object round-trip");
+
+    // 'System>>exit:' returns to the host, and the VM is still usable afterwards
+    //
+    Check(!vm->Invoke(exitFn, service, { SOMEmbeddedValue::Integer(3) }, result /*out*/), "Invoke returns false on System>>exit:");
+    Check(vm->GetExitCode() == 3, "Exit code of System>>exit:");
+    Check(vm->Invoke(addFn, service, { SOMEmbeddedValue::Integer(40), SOMEmbeddedValue::Integer(2) }, result /*out*/) && IsInteger(result, 42),
+          "Invoke after System>>exit:");
+
+    vm->Destroy();
+
+    if (g_numFailures > 0)
+    {
+        fprintf(stderr, "%llu checks failed.\n", static_cast<unsigned long long>(g_numFailures));
+        return 1;
+    }
+    fprintf(stderr, "All checks passed.\n");
+    return 0;
+}
@@ -220,7 +220,6 @@ CoroutineRuntimeContext* CoroutineRuntimeContext::Create(VM* vm, UserHeapPointer
     r->m_globalObject = globalObject;
     r->m_numVariadicRets = 0;
     r->m_variadicRetStart = nullptr;
-    r->m_upvalueList.m_value = 0;
     size_t bytesToAllocate = numStackSlots * sizeof(TValue);
     bytesToAllocate = RoundUpToMultipleOf<VM::x_pageSize>(bytesToAllocate);
     void* stackAreaWithOverflowProtection = mmap(nullptr, bytesToAllocate + x_stackOverflowProtectionAreaSize * 2,
@@ -235,6 +234,24 @@ CoroutineRuntimeContext* CoroutineRuntimeContext::Create(VM* vm, UserHeapPointer
                           "Out of Memory: Allocation of length %llu failed", static_cast<unsigned long long>(bytesToAllocate));
     Assert(stackArea == reinterpret_cast<uint8_t*>(stackAreaWithOverflowProtection) + x_stackOverflowProtectionAreaSize);
     r->m_stackBegin = reinterpret_cast<TValue*>(stackArea);
+    r->m_stackEnd = reinterpret_cast<TValue*>(reinterpret_cast<uint8_t*>(stackArea) + bytesToAllocate);
+    r->m_openUpvalueWatermark = r->m_stackBegin;
+
+    // Allocate the open upvalue side table and bitmap in one mapping.
+    // The pages are lazily populated (and zero-initialized) by the OS, so only the part of the table covering
+    // the deepest stack depth ever reached actually consumes memory.
+    //
+    {
+        size_t numSlots = bytesToAllocate / sizeof(TValue);
+        size_t tableBytes = numSlots * sizeof(UserHeapPointer<Upvalue>);
+        size_t bitmapBytes = RoundUpToMultipleOf<64>(numSlots) / 8;
+        size_t sideTableBytes = RoundUpToMultipleOf<VM::x_pageSize>(tableBytes + bitmapBytes);
+        void* sideTable = mmap(nullptr, sideTableBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        VM_FAIL_WITH_ERRNO_IF(sideTable == MAP_FAILED,
+                              "Out of Memory: Allocation of length %llu failed", static_cast<unsigned long long>(sideTableBytes));
+        r->m_openUpvalueTable = reinterpret_cast<UserHeapPointer<Upvalue>*>(sideTable);
+        r->m_openUpvalueBitmap = reinterpret_cast<uint64_t*>(reinterpret_cast<uint8_t*>(sideTable) + tableBytes);
+    }
     return r;
 }
 
@@ -243,7 +260,9 @@ BaselineCodeBlock* WARN_UNUSED BaselineCodeBlock::Create(CodeBlock* cb,
                                                          uint32_t slowPathDataStreamLength,
                                                          void* jitCodeEntry,
                                                          void* jitRegionStart,
-                                                         uint32_t jitRegionSize)
+                                                         uint32_t jitRegionSize,
+                                                         void* jitColdRegionStart,
+                                                         uint32_t jitColdRegionSize)
 {
     size_t numEntriesInConstantTable = cb->m_owner->m_cstTableLength;
     static_assert(alignof(BaselineCodeBlock) == 8);         // the computation below relies on this
@@ -262,9 +281,12 @@ BaselineCodeBlock* WARN_UNUSED BaselineCodeBlock::Create(CodeBlock* cb,
     res->m_numBytecodes = numBytecodes;
     res->m_stackFrameNumSlots = cb->m_stackFrameNumSlots;
     res->m_maxObservedNumVariadicArgs = 0;
+    res->m_indexInLiveList = static_cast<uint32_t>(-1);
     res->m_slowPathDataStreamLength = slowPathDataStreamLength;
     res->m_jitRegionStart = jitRegionStart;
     res->m_jitRegionSize = jitRegionSize;
+    res->m_jitColdRegionStart = jitColdRegionStart;
+    res->m_jitColdRegionSize = jitColdRegionSize;
 
     TestAssert(cb->m_baselineCodeBlock == nullptr);
     cb->m_baselineCodeBlock = res;
@@ -89,9 +89,10 @@ public:
     uint32_t m_numVariadicRets;
     uint32_t m_unused1;
 
-    // The linked list head of the list of open upvalues
+    // All open upvalues are at stack slots < m_openUpvalueWatermark (it is an upper bound, not necessarily tight)
+    // This allows CloseUpvalues to return immediately when the current frame has nothing to close.
     //
-    UserHeapPointer<Upvalue> m_upvalueList;
+    TValue* m_openUpvalueWatermark;
 
     // The global object of this coroutine
     //
@@ -126,6 +127,19 @@ public:
     // The beginning of the stack
     //
     TValue* m_stackBegin;
+
+    // The end of the stack (exclusive)
+    //
+    TValue* m_stackEnd;
+
+    // The open upvalues are tracked in a side table indexed by stack slot (i.e., slot 'm_stackBegin + i' has entry i),
+    // so finding or creating the open upvalue for a slot is O(1).
+    // m_openUpvalueTable[i] is the open upvalue for slot i, or 0 if the slot has no open upvalue.
+    // Bit i of m_openUpvalueBitmap is set iff m_openUpvalueTable[i] is not 0, so closing the upvalues of a frame only needs
+    // to scan one bit per slot of that frame.
+    //
+    UserHeapPointer<Upvalue>* m_openUpvalueTable;
+    uint64_t* m_openUpvalueBitmap;
 };
 
 // Base class for some executable, either an intrinsic, or a bytecode function with some fixed global object, or a user C function
@@ -589,13 +603,20 @@ public:
                                                  uint32_t slowPathDataStreamLength,
                                                  void* jitCodeEntry,
                                                  void* jitRegionStart,
-                                                 uint32_t jitRegionSize);
+                                                 uint32_t jitRegionSize,
+                                                 void* jitColdRegionStart,
+                                                 uint32_t jitColdRegionSize);
 
     static constexpr size_t GetTrailingArrayOffset()
     {
         return offsetof_member_v<&BaselineCodeBlock::m_sbIndex>;
     }
 
+    TValue* GetConstantTableEnd()
+    {
+        return reinterpret_cast<TValue*>(this);
+    }
+
     // The layout of this struct is currently hardcoded
     // If you change this, be sure to make corresponding changes in DeegenBytecodeBaselineJitInfo
     //
@@ -688,20 +709,29 @@ public:
     // Updated by profiling logic
     //
     uint32_t m_maxObservedNumVariadicArgs;
+    // The index of this BaselineCodeBlock in VM::GetLiveBaselineCodeBlocks(), or -1 if the JIT code has been jettisoned
+    //
+    uint32_t m_indexInLiveList;
 
     // Currently the JIT code is layouted as follow:
-    //     [ Data Section ] [ FastPath Code ] [ SlowPath Code ]
+    //     Hot region:  [ FastPath Code ]
+    //     Cold region: [ Data Section ] [ SlowPath Code ]
     //
     void* m_jitCodeEntry;
 
     CodeBlock* m_owner;
 
-    // The JIT region is [m_jitRegionStart, m_jitRegionStart + m_jitRegionSize)
+    // The hot JIT region is [m_jitRegionStart, m_jitRegionStart + m_jitRegionSize), allocated from VM::GetJITMemoryAlloc()
     //
     void* m_jitRegionStart;
     uint32_t m_jitRegionSize;
     uint32_t m_slowPathDataStreamLength;
 
+    // The cold JIT region is [m_jitColdRegionStart, m_jitColdRegionStart + m_jitColdRegionSize), allocated from VM::GetColdJITMemoryAlloc()
+    //
+    void* m_jitColdRegionStart;
+    uint32_t m_jitColdRegionSize;
+
     SlowPathDataAndBytecodeOffset m_sbIndex[0];
 };
 
@@ -752,7 +782,7 @@ class FunctionObject;
 class Upvalue
 {
 public:
-    static HeapPtr<Upvalue> WARN_UNUSED CreateUpvalueImpl(UserHeapPointer<Upvalue> prev, TValue* dst, bool isImmutable)
+    static HeapPtr<Upvalue> WARN_UNUSED CreateUpvalueImpl(TValue* dst, bool isImmutable)
     {
         VM* vm = VM::GetActiveVMForCurrentThread();
         HeapPtr<Upvalue> r = vm->AllocFromUserHeap(static_cast<uint32_t>(sizeof(Upvalue))).AsNoAssert<Upvalue>();
@@ -761,7 +791,6 @@ public:
         r->m_ptr = dst;
         r->m_isClosed = false;
         r->m_isImmutable = isImmutable;
-        TCSet(r->m_prev, prev);
         return r;
     }
 
@@ -783,64 +812,28 @@ public:
 
     static HeapPtr<Upvalue> WARN_UNUSED Create(CoroutineRuntimeContext* rc, TValue* dst, bool isImmutable)
     {
-        if (rc->m_upvalueList.m_value == 0 || rc->m_upvalueList.As()->m_ptr < dst)
+        Assert(rc->m_stackBegin <= dst && dst < rc->m_stackEnd);
+        size_t slot = static_cast<size_t>(dst - rc->m_stackBegin);
+        UserHeapPointer<Upvalue>& entry = rc->m_openUpvalueTable[slot];
+        if (entry.m_value != 0)
         {
-            // Edge case: the open upvalue list is empty, or the upvalue shall be inserted as the first element in the list
+            // We found an open upvalue for that slot, we are good
             //
-            HeapPtr<Upvalue> newNode = CreateUpvalueImpl(rc->m_upvalueList /*prev*/, dst, isImmutable);
-            rc->m_upvalueList = newNode;
-            //WriteBarrier(rc);
-            return newNode;
+            Assert(!entry.As()->m_isClosed);
+            Assert(entry.As()->m_ptr == dst);
+            Assert(rc->m_openUpvalueBitmap[slot / 64] & (static_cast<uint64_t>(1) << (slot % 64)));
+            return entry.As();
         }
-        else
-        {
-            // Invariant: after the loop, the node shall be inserted between 'cur' and 'prev'
-            //
-            HeapPtr<Upvalue> cur = rc->m_upvalueList.As();
-            TValue* curVal = cur->m_ptr;
-            UserHeapPointer<Upvalue> prev;
-            while (true)
-            {
-                Assert(!cur->m_isClosed);
-                Assert(dst <= curVal);
-                if (curVal == dst)
-                {
-                    // We found an open upvalue for that slot, we are good
-                    //
-                    return cur;
-                }
-
-                prev = TCGet(cur->m_prev);
-                if (prev.m_value == 0)
-                {
-                    // 'cur' is the last node, so we found the insertion location
-                    //
-                    break;
-                }
-
-                Assert(!prev.As()->m_isClosed);
-                TValue* prevVal = prev.As()->m_ptr;
-                Assert(prevVal < curVal);
-                if (prevVal < dst)
-                {
-                    // prevVal < dst < curVal, so we found the insertion location
-                    //
-                    break;
-                }
-
-                cur = prev.As();
-                curVal = prevVal;
-            }
 
-            Assert(curVal == cur->m_ptr);
-            Assert(prev == TCGet(cur->m_prev));
-            Assert(dst < curVal);
-            Assert(prev.m_value == 0 || prev.As()->m_ptr < dst);
-            HeapPtr<Upvalue> newNode = CreateUpvalueImpl(prev, dst, isImmutable);
-            TCSet(cur->m_prev, UserHeapPointer<Upvalue>(newNode));
-            //WriteBarrier(cur);
-            return newNode;
+        HeapPtr<Upvalue> newNode = CreateUpvalueImpl(dst, isImmutable);
+        entry = newNode;
+        rc->m_openUpvalueBitmap[slot / 64] |= static_cast<uint64_t>(1) << (slot % 64);
+        if (dst >= rc->m_openUpvalueWatermark)
+        {
+            rc->m_openUpvalueWatermark = dst + 1;
         }
+        //WriteBarrier(rc);
+        return newNode;
     }
 
     void Close()
@@ -854,7 +847,7 @@ public:
 
     static constexpr int32_t x_hiddenClassForUpvalue = 0x18;
 
-    // TODO: we could have made this structure 16 bytes instead of 32 bytes by making m_ptr a GeneralHeapPointer and takes the place of m_hiddenClass
+    // TODO: we could have made this structure 16 bytes instead of 24 bytes by making m_ptr a GeneralHeapPointer and takes the place of m_hiddenClass
     // (normally this is a bit risky as it might confuse all sort of things (like IC), but upvalue is so special: it is never exposed to user,
     // so an Upvalue object will never be used as operand into any bytecode instruction other than the upvalue-dedicated ones, so we are fine).
     // However, we are not doing this now because our stack is currently not placed in the VM memory range.
@@ -868,39 +861,53 @@ public:
     bool m_isImmutable;
 
     // Points to &tv for closed upvalue, or the stack slot for open upvalue
-    // All the open values are chained into a linked list (through prev) in reverse sorted order of m_ptr (i.e. absolute stack slot from high to low)
+    // The open upvalues are tracked by the side table in CoroutineRuntimeContext
     //
     TValue* m_ptr;
     // Stores the value for closed upvalue
     //
     TValue m_tv;
-    // Stores the linked list if the upvalue is open
-    //
-    UserHeapPointer<Upvalue> m_prev;
 };
-static_assert(sizeof(Upvalue) == 32);
+static_assert(sizeof(Upvalue) == 24);
 
 inline void __attribute__((__used__)) CoroutineRuntimeContext::CloseUpvalues(TValue* base)
 {
+    TValue* end = m_openUpvalueWatermark;
+    if (likely(end <= base))
+    {
+        return;
+    }
+
+    // Close every open upvalue in [base, end), which are all in the current frame
+    //
     VM* vm = VM::GetActiveVMForCurrentThread();
-    UserHeapPointer<Upvalue> cur = m_upvalueList;
-    while (cur.m_value != 0)
+    Assert(m_stackBegin <= base && end <= m_stackEnd);
+    size_t slot = static_cast<size_t>(base - m_stackBegin);
+    size_t endSlot = static_cast<size_t>(end - m_stackBegin);
+    size_t wordIdx = slot / 64;
+    uint64_t mask = ~static_cast<uint64_t>(0) << (slot % 64);
+    while (wordIdx * 64 < endSlot)
     {
-        if (cur.As()->m_ptr < base)
+        uint64_t bits = m_openUpvalueBitmap[wordIdx] & mask;
+        if (bits != 0)
         {
-            break;
+            m_openUpvalueBitmap[wordIdx] &= ~mask;
+            while (bits != 0)
+            {
+                size_t curSlot = wordIdx * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+                Assert(curSlot < endSlot);
+                Assert(m_openUpvalueTable[curSlot].m_value != 0);
+                Upvalue* uv = TranslateToRawPointer(vm, m_openUpvalueTable[curSlot].As());
+                Assert(uv->m_ptr == m_stackBegin + curSlot);
+                uv->Close();
+                m_openUpvalueTable[curSlot].m_value = 0;
+                bits &= bits - 1;
+            }
         }
-        Assert(!cur.As()->m_isClosed);
-        Upvalue* uv = TranslateToRawPointer(vm, cur.As());
-        cur = uv->m_prev;
-        Assert(cur.m_value == 0 || cur.As()->m_ptr < uv->m_ptr);
-        uv->Close();
-    }
-    m_upvalueList = cur;
-    if (cur.m_value != 0)
-    {
-        //WriteBarrier(this);
+        mask = ~static_cast<uint64_t>(0);
+        wordIdx++;
     }
+    m_openUpvalueWatermark = base;
 }
 
 class FunctionObject
@@ -1062,6 +1069,21 @@ public:
 };
 static_assert(sizeof(FunctionObject) == 8);
 
+// Compile a method created by SOMCompileFile as a lazy method stub, and turn the stub into the compiled method in place.
+// Does nothing if the method has already been compiled. Defined in som_compile_file.cpp
+//
+void NO_INLINE SOMCompileLazyMethod(HeapPtr<FunctionObject> fn);
+
+inline GeneralHeapPointer<FunctionObject> WARN_UNUSED ALWAYS_INLINE SOMClass::GetMethod(HeapPtr<SOMClass> self, SOMUniquedString name)
+{
+    GeneralHeapPointer<FunctionObject> res = GetMethodNoCompile(self, name);
+    if (res.m_value != 0 && unlikely((res.As()->m_invalidArrayType >> 4) == SOM_LazyMethod))
+    {
+        SOMCompileLazyMethod(res.As());
+    }
+    return res;
+}
+
 inline ExecutableCode* WARN_UNUSED JitCallInlineCacheEntry::GetTargetExecutableCode(VM* vm)
 {
     AssertIff(m_entity.IsUserHeapPointer(), GetIcTrait()->m_isDirectCallMode);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common_utils.h"
+#include "tvalue.h"
+
+// SSE4 kernels for the bulk Array primitives
+//
+// A TValue is a 64-bit word, so one 128-bit vector holds two elements.
+//
+
+// Return the index of the first element in [ptr, ptr + len) that is bitwise identical to 'value', or 'len' if there is none
+//
+inline size_t WARN_UNUSED SOMArrayFindIdentical(const TValue* ptr, size_t len, TValue value)
+{
+    __m128i needle = _mm_set1_epi64x(static_cast<int64_t>(value.m_value));
+    size_t i = 0;
+    while (i + 4 <= len)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i + 2));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi64(a, needle))) |
+            (static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi64(b, needle))) << 16);
+        if (mask != 0)
+        {
+            // Each matching element sets 8 bits in the mask
+            //
+            return i + static_cast<size_t>(__builtin_ctz(mask)) / 8;
+        }
+        i += 4;
+    }
+    while (i < len)
+    {
+        if (ptr[i].m_value == value.m_value)
+        {
+            return i;
+        }
+        i++;
+    }
+    return len;
+}
+
+inline void SOMArrayFill(TValue* ptr, size_t len, TValue value)
+{
+    __m128i v = _mm_set1_epi64x(static_cast<int64_t>(value.m_value));
+    size_t i = 0;
+    while (i + 2 <= len)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr + i), v);
+        i += 2;
+    }
+    if (i < len)
+    {
+        ptr[i] = value;
+    }
+}
@@ -159,9 +159,11 @@ struct AstSymbol final : AstLiteral
 struct AstInteger final : AstLiteral
 {
     AstInteger() : AstLiteral(AstExprKind::Integer), m_value(0) { }
-    AstInteger(int32_t value) : AstInteger() { m_value = value; }
+    AstInteger(int64_t value) : AstInteger() { m_value = value; }
 
-    int32_t m_value;
+    // Values outside the int32 range become a LargeInteger constant (see MakeSOMInteger)
+    //
+    int64_t m_value;
 };
 
 struct AstDouble final : AstLiteral
@@ -264,12 +266,22 @@ struct AstClass
         , m_classFields(alloc)
         , m_instanceMethods(alloc)
         , m_classMethods(alloc)
+        , m_referencedClassNames(alloc)
     { }
 
     AstSymbol* m_name;
+    // Empty if the superclass is nil, which is only allowed for Object
+    //
+    std::string_view m_superClassName;
+    // Resolved from m_superClassName by SOMCompileFile, the parser does not load other classes
+    //
     SOMClass* m_superClass;
     TempVector<VariableInfo> m_instanceFields;
     TempVector<VariableInfo> m_classFields;
     TempVector<AstMethod*> m_instanceMethods;
     TempVector<AstMethod*> m_classMethods;
+    // Capitalized variable names used in the methods, which may be classes that the class depends on
+    // Only used to discover the classes to parse ahead of time (see SOMPreparseClasses), may contain duplicates
+    //
+    TempVector<std::string_view> m_referencedClassNames;
 };
@@ -240,7 +240,7 @@ SOMClass* WARN_UNUSED SOMClass::Create(StringInterner* interner,
                 .m_id = static_cast<uint32_t>(it.m_stringId),
                 .m_hash = static_cast<uint32_t>(interner->GetHash(it.m_stringId))
             };
-            GeneralHeapPointer<FunctionObject> fn = SOMClass::GetMethod(TranslateToHeapPtr(c), str);
+            GeneralHeapPointer<FunctionObject> fn = SOMClass::GetMethodNoCompile(TranslateToHeapPtr(c), str);
             TestAssert(fn.m_value != 0);
             TestAssert(TranslateToRawPointer(fn.As()) == it.m_fnObj);
 
@@ -277,9 +277,10 @@ SOMObject* WARN_UNUSED SOMObject::AllocateUninitialized(size_t trailingArraySize
 SOMObject* WARN_UNUSED SOMObject::AllocateString(std::string_view str)
 {
     VM* vm = VM_GetActiveVMForCurrentThread();
-    SOMObject* o = AllocateUninitialized(8 + str.size() + 1);
+    SOMObject* o = AllocateUninitialized(GetStringTrailingArraySize(str.size()));
     SOMObject::Populate(o);
     o->m_hiddenClass = SystemHeapPointer<SOMClass>(vm->m_stringHiddenClass).m_value;
+    o->m_opaque = 0;
     o->m_arrayType = SOM_String;
     o->m_data[0].m_value = str.size();
     memcpy(&o->m_data[1], str.data(), str.size());
@@ -322,9 +323,10 @@ HeapPtr<SOMObject> WARN_UNUSED SOMObject::DoStringConcat(HeapPtr<SOMObject> lhs,
     size_t llen = lhs->m_data[0].m_value;
     size_t rlen = rhs->m_data[0].m_value;
     VM* vm = VM_GetActiveVMForCurrentThread();
-    SOMObject* o = AllocateUninitialized(8 + llen + rlen + 1);
+    SOMObject* o = AllocateUninitialized(GetStringTrailingArraySize(llen + rlen));
     SOMObject::Populate(o);
     o->m_hiddenClass = SystemHeapPointer<SOMClass>(vm->m_stringHiddenClass).m_value;
+    o->m_opaque = 0;
     o->m_arrayType = SOM_String;
     o->m_data[0].m_value = llen + rlen;
     char* buf = reinterpret_cast<char*>(&o->m_data[1]);
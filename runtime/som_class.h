@@ -32,7 +32,19 @@ enum SOMDetailEntityType : uint8_t
     SOM_Array,
     // This is either a string or a symbol
     //
-    SOM_String
+    SOM_String,
+    // A native hash table, i.e. an instance of the 'HashMap' class (see som_hash_table.h)
+    //
+    SOM_HashTable,
+    // A native growable vector, i.e. an instance of the 'Vector' class (see som_vector.h)
+    //
+    SOM_Vector,
+    // An integer outside the int32 range, i.e. an instance of the 'LargeInteger' class (see som_large_integer.h)
+    //
+    SOM_LargeInteger,
+    // A file reader, i.e. an instance of the 'FileReader' class (see som_file_reader.h)
+    //
+    SOM_FileReader
 };
 
 // Takes bit [4:8) of the m_arrayType field
@@ -46,7 +58,11 @@ enum SOMMethodLookupResultKind : uint8_t
     SOM_SelfReturn,
     SOM_Getter,
     SOM_Setter,
-    SOM_CallBaseNotObject
+    SOM_CallBaseNotObject,
+    // A method that has not been compiled yet (see SOMCompileLazyMethod)
+    // Never returned by GetMethod, since GetMethod compiles the method before returning it
+    //
+    SOM_LazyMethod
 };
 
 class SOMObject : public UserHeapGcObjectHeader
@@ -60,6 +76,24 @@ public:
 
     static HeapPtr<SOMObject> WARN_UNUSED DoStringConcat(HeapPtr<SOMObject> lhs, HeapPtr<SOMObject> rhs);
 
+    // String layout: m_data[0] is the length, followed by the content, the NULL terminator, and a 4-byte slot holding the cached hash code.
+    // SOM strings are immutable, so the hash code is computed lazily on first use and never invalidated.
+    // Bit 0 of 'm_opaque' tells whether the cached hash code is valid.
+    //
+    static constexpr uint8_t x_stringHashCodeCachedBit = 1;
+
+    // The offset of the hash code slot, relative to the start of the string content
+    //
+    static constexpr size_t GetStringHashCodeSlotOffset(size_t length)
+    {
+        return RoundUpToMultipleOf<4>(length + 1);
+    }
+
+    static constexpr size_t GetStringTrailingArraySize(size_t length)
+    {
+        return 8 + GetStringHashCodeSlotOffset(length) + 4;
+    }
+
     TValue m_data[0];
 };
 
@@ -72,7 +106,13 @@ public:
         GeneralHeapPointer<FunctionObject> m_data;
     };
 
-    static GeneralHeapPointer<FunctionObject> WARN_UNUSED GetMethod(HeapPtr<SOMClass> self, SOMUniquedString name)
+    // Compiles the method if it has not been compiled yet, defined in runtime_utils.h
+    //
+    static GeneralHeapPointer<FunctionObject> WARN_UNUSED GetMethod(HeapPtr<SOMClass> self, SOMUniquedString name);
+
+    // The method returned may not have been compiled yet
+    //
+    static GeneralHeapPointer<FunctionObject> WARN_UNUSED GetMethodNoCompile(HeapPtr<SOMClass> self, SOMUniquedString name)
     {
         size_t slot1 = name.m_hash & self->m_methodHtMask;
         size_t slot2 = (name.m_hash >> 16) & self->m_methodHtMask;
@@ -3,35 +3,55 @@
 #include "som_class.h"
 #include "vm.h"
 #include "runtime_utils.h"
-#include <fstream>
+#include "som_file_reader.h"
+#include "som_large_integer.h"
+#include <filesystem>
+#include <chrono>
+#include <condition_variable>
 #include "bytecode_builder.h"
 #include "tvalue.h"
 
 using namespace DeegenBytecodeBuilder;
 
-std::vector<std::string> g_classLoadPaths = { };
+size_t g_numClassParseThreads = 0;
 
-static std::ifstream WARN_UNUSED OpenFileForClass(std::string className)
+// Return false if the class is not found in the class path
+// The source is memory-mapped, and the lexer works on it directly
+//
+static bool WARN_UNUSED TryOpenFileForClass(const std::vector<std::string>& classLoadPaths, const std::string& className, SOMFileContent& content /*out*/)
 {
-    for (const std::string& path : g_classLoadPaths)
+    for (const std::string& path : classLoadPaths)
     {
         std::string filename = path + "/" + className + ".som";
-        std::ifstream fp{};
-        fp.open(filename.c_str(), std::ios_base::in);
-        if (fp.is_open())
+        if (content.Open(filename.c_str()))
         {
-            return fp;
+            return true;
         }
     }
-    fprintf(stderr, "Failed to load class %s (file not found)\n", className.c_str());
-    abort();
+    return false;
+}
+
+static void OpenFileForClass(VM* vm, const std::string& className, SOMFileContent& content /*out*/)
+{
+    if (!TryOpenFileForClass(vm->m_classLoadPaths, className, content /*out*/))
+    {
+        fprintf(stderr, "Failed to load class %s (file not found)\n", className.c_str());
+        abort();
+    }
+}
+
+void SOMAddInMemoryClassSource(const std::string& className, std::string source)
+{
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    TestAssert(!vm->m_parsedClasses.count(vm->m_interner.InternString(className)));
+    vm->m_inMemoryClassSources[className] = std::move(source);
 }
 
 void SetSOMGlobal(VM* vm, std::string_view key, TValue value)
 {
     size_t slot = vm->GetSlotForGlobal(key);
     TestAssert(vm->m_somGlobals[slot].m_value == TValue::CreateImpossibleValue().m_value);
-    vm->m_somGlobals[slot] = value;
+    vm->SetGlobal(slot, value);
 }
 
 SOMUniquedString GetUniquedString(VM* vm, std::string_view str)
@@ -57,6 +77,7 @@ struct LocalVarInfo
         , m_slotOrd(slotOrd)
         , m_isUsed(false)
         , m_isWritten(false)
+        , m_isCaptured(false)
         , m_isImmutable(true)
     { }
 
@@ -64,11 +85,21 @@ struct LocalVarInfo
     //
     BlockTranslationContext* m_bctx;
     uint32_t m_slotOrd;
-    // If all writes to the variable happens before all uses to the variable, and all writes are in the block where it is defined,
-    // it can be treated as immutable for upvalue purpose
-    //
     bool m_isUsed;
     bool m_isWritten;
+    // True if a closure textually before the current point captures this variable
+    //
+    bool m_isCaptured;
+    // If all writes to the variable happens before all captures of the variable, and all writes are in the block where it is defined,
+    // it can be treated as immutable for upvalue purpose: every closure can capture the value at the time it is created, so
+    // no Upvalue object is needed.
+    //
+    // Note that uses of the variable in the defining function itself do not matter: they read the stack slot directly,
+    // so something like 'sum := 0. sum := sum + 1. ^ [ sum ]' still captures 'sum' by value.
+    // Also note that inlined blocks (e.g., loop bodies and conditional branches) have their own BlockTranslationContext,
+    // so the code in the defining block executes in textual order exactly once per activation of the defining block,
+    // and "textually before" is the same as "executed before" here.
+    //
     bool m_isImmutable;
 
     void NotifyUse()
@@ -76,9 +107,14 @@ struct LocalVarInfo
         m_isUsed = true;
     }
 
+    void NotifyCapture()
+    {
+        m_isCaptured = true;
+    }
+
     void NotifyWrite(bool isInDefiningBlock)
     {
-        if (m_isUsed || !isInDefiningBlock)
+        if (m_isCaptured || !isInDefiningBlock)
         {
             m_isImmutable = false;
         }
@@ -102,9 +138,13 @@ struct TranslationContext
         , m_superClass(superClass)
         , m_builder()
         , m_allUpvalueGetBytecodes(alloc)
+        , m_foldedGlobals(alloc)
         , m_results(resultTcs)
         , m_resultUcb(nullptr)
         , m_resultBCtx(nullptr)
+        , m_selfRecursionHolder(nullptr)
+        , m_selfFn(nullptr)
+        , m_methodSelectorId(static_cast<size_t>(-1))
     {
         m_results.push_back(this);
         m_resultUcb = UnlinkedCodeBlock::Create(VM_GetActiveVMForCurrentThread(), nullptr);
@@ -127,9 +167,18 @@ struct TranslationContext
     SOMClass* m_superClass;
     BytecodeBuilder m_builder;
     TempVector<size_t> m_allUpvalueGetBytecodes;
+    // The (global index, constant table ordinal) of each global read folded to a constant
+    //
+    TempVector<std::pair<size_t, int64_t>> m_foldedGlobals;
     TempVector<TranslationContext*>& m_results;
     UnlinkedCodeBlock* m_resultUcb;
     BlockTranslationContext* m_resultBCtx;
+    // Only set for the context of a method body (not a block) when the method is known to be defined in 'm_selfRecursionHolder',
+    // so a 'self' call to selector 'm_methodSelectorId' is a self-recursive call to 'm_selfFn' if 'self' is exactly a 'm_selfRecursionHolder'
+    //
+    SOMClass* m_selfRecursionHolder;
+    HeapPtr<FunctionObject> m_selfFn;
+    size_t m_methodSelectorId;
 };
 
 struct UVInfo
@@ -317,7 +366,7 @@ TValue WARN_UNUSED CreateConstantNonArray(AstLiteral* node)
     case AstExprKind::Integer:
     {
         AstInteger* val = assert_cast<AstInteger*>(node);
-        return TValue::Create<tInt32>(val->m_value);
+        return MakeSOMInteger(val->m_value);
     }
     case AstExprKind::String:
     {
@@ -469,6 +518,7 @@ VarResolveResult WARN_UNUSED ResolveVariable(TranslationContext& ctx, BlockTrans
                 // This is a variable defined in an outer function
                 //
                 TestAssertImp(mode == VarResolveMode::ForWrite, !var->m_isImmutable);
+                var->NotifyCapture();
                 size_t uvOrd = bctx.m_owningContext->AddUpvalue(var);
                 return VarResolveResult {
                     .m_kind = VarUseKind::Upvalue,
@@ -616,17 +666,34 @@ void CompileVarUse(TranslationContext& ctx, BlockTranslationContext& bctx, AstVa
     }
     else if (vr.m_kind == VarUseKind::Global)
     {
-#ifdef TESTBUILD
         VM* vm = VM_GetActiveVMForCurrentThread();
+#ifdef TESTBUILD
         TestAssert(vr.m_ord < vm->m_globalStringIdWithIndex.size());
         std::string_view globalName = vm->m_interner.Get(vm->m_globalStringIdWithIndex[vr.m_ord]);
         TestAssert(globalName != "false" && globalName != "true" && globalName != "nil");
 #endif
-        ctx.m_builder.CreateSOMGlobalGet({
-            .self = Local(0),
-            .index = SafeIntegerCast<uint16_t>(vr.m_ord),
-            .output = Local(destSlot)
-        });
+        if (vm->CanFoldGlobal(vr.m_ord))
+        {
+            // The global has been written exactly once, fold it to a constant guarded by the global's watchpoint
+            // The constant table entry is recorded after the constant table is built, see CompileMethod
+            //
+            TValue value = vm->m_somGlobals[vr.m_ord];
+            int64_t cstOrd = ctx.m_builder.EmitWithUnsharedConstant(value, [&]() {
+                ctx.m_builder.CreateMov({
+                    .input = value,
+                    .output = Local(destSlot)
+                });
+            });
+            ctx.m_foldedGlobals.push_back(std::make_pair(vr.m_ord, cstOrd));
+        }
+        else
+        {
+            ctx.m_builder.CreateSOMGlobalGet({
+                .self = Local(0),
+                .index = SafeIntegerCast<uint16_t>(vr.m_ord),
+                .output = Local(destSlot)
+            });
+        }
     }
     else
     {
@@ -1669,6 +1736,13 @@ void CompileSOMCall(TranslationContext& ctx, BlockTranslationContext& bctx, AstE
                     .output = Local(destSlot)
                 });
             }
+            else if (selectorStringId == vm->m_strOperatorAtRandom.m_id)
+            {
+                ctx.m_builder.CreateOperatorAtRandom({
+                    .op = Local(lhsSlot),
+                    .output = Local(destSlot)
+                });
+            }
             else
             {
                 TestAssert(selectorStringId == vm->m_strOperatorLength.m_id);
@@ -1761,6 +1835,19 @@ void CompileSOMCall(TranslationContext& ctx, BlockTranslationContext& bctx, AstE
             .output = Local(destSlot)
         });
     }
+    else if (rcvKind == SOMReceiverKind::ObjectSelf && ctx.m_selfRecursionHolder != nullptr && selectorStringId == ctx.m_methodSelectorId)
+    {
+        TValue holderTv; holderTv.m_value = SystemHeapPointer<SOMClass>(ctx.m_selfRecursionHolder).m_value;
+        ctx.m_builder.CreateSOMSelfRecursiveCall({
+            .base = Local(clobberSlot),
+            .self = Local(0),
+            .meth = tv,
+            .holder = holderTv,
+            .selfFn = TValue::Create<tFunction>(ctx.m_selfFn),
+            .numArgs = SafeIntegerCast<uint16_t>(args.size() + 1),
+            .output = Local(destSlot)
+        });
+    }
     else if (rcvKind == SOMReceiverKind::ObjectSelf)
     {
         ctx.m_builder.CreateSOMSelfCall({
@@ -2184,13 +2271,15 @@ void CompileExpression(TranslationContext& ctx, BlockTranslationContext& bctx, A
     }
 }
 
-HeapPtr<FunctionObject> CompileMethod(TempArenaAllocator& alloc,
+CodeBlock* WARN_UNUSED CompileMethod(TempArenaAllocator& alloc,
                                       SOMClass* superClass,
                                       TempUnorderedMap<std::string_view, uint32_t /*objectSlotOrd*/>& fieldMap,
                                       AstMethod* meth,
                                       bool isSelfObject,
                                       [[maybe_unused]] std::string_view className,
-                                      [[maybe_unused]] bool isClassSide)
+                                      [[maybe_unused]] bool isClassSide,
+                                      SOMClass* holderClass,
+                                      HeapPtr<FunctionObject> selfFn)
 {
     VM* vm = VM_GetActiveVMForCurrentThread();
     TempUnorderedMap<std::string_view, TempVector<LocalVarInfo*>> localVarMap(alloc);
@@ -2204,6 +2293,14 @@ HeapPtr<FunctionObject> CompileMethod(TempArenaAllocator& alloc,
                                                                        superClass,
                                                                        allCtx);
 
+    if (holderClass != nullptr)
+    {
+        TestAssert(selfFn != nullptr);
+        ctx->m_selfRecursionHolder = holderClass;
+        ctx->m_selfFn = selfFn;
+        ctx->m_methodSelectorId = meth->m_selectorName->m_globalOrd;
+    }
+
     BlockTranslationContext* bctx = alloc.AllocateObject<BlockTranslationContext>(alloc,
                                                                                   nullptr /*lexicalParent*/,
                                                                                   nullptr /*trueParent*/);
@@ -2376,7 +2473,7 @@ HeapPtr<FunctionObject> CompileMethod(TempArenaAllocator& alloc,
             {
                 // Note that despite that 'self' is never mutable, we must capture it as mutable if non-local return is possible,
                 // since we need to use the open/closeness of this upvalue to determine if the
-                // closure that created this closure is still on the stack frame to implement non-local return
+                // method that created this closure is still on the stack frame to implement non-local return
                 //
                 TestAssert(ucb->m_fnKind == SOM_BlockNoArg || ucb->m_fnKind == SOM_BlockNoArgImmSelf ||
                            ucb->m_fnKind == SOM_BlockOneArg || ucb->m_fnKind == SOM_BlockOneArgImmSelf ||
@@ -2384,8 +2481,28 @@ HeapPtr<FunctionObject> CompileMethod(TempArenaAllocator& alloc,
                 uv.m_isImmutable = (ucb->m_fnKind == SOM_BlockNoArgImmSelf ||
                                     ucb->m_fnKind == SOM_BlockOneArgImmSelf ||
                                     ucb->m_fnKind == SOM_BlockTwoArgsImmSelf);
-                uv.m_isParentLocal = true;
-                uv.m_slot = 0;
+                TestAssert(ucb->m_parent != nullptr);
+                if (!uv.m_isImmutable && ucb->m_parent->m_fnKind != SOM_Method)
+                {
+                    // This closure may do non-local return and is created by another block.
+                    // Instead of capturing the 'self' slot of the creator block's frame, share the creator block's upvalue 0,
+                    // so upvalue 0 of every such block points directly at the 'self' slot of the home method's frame.
+                    // This way, non-local return can find the home method frame in O(1), and the upvalue is open
+                    // iff the home method is still on the stack.
+                    //
+                    // The creator block contains a closure that may do non-local return, so it must also capture self mutably.
+                    //
+                    TestAssert(ucb->m_parent->m_fnKind == SOM_BlockNoArg ||
+                               ucb->m_parent->m_fnKind == SOM_BlockOneArg ||
+                               ucb->m_parent->m_fnKind == SOM_BlockTwoArgs);
+                    uv.m_isParentLocal = false;
+                    uv.m_slot = 0;
+                }
+                else
+                {
+                    uv.m_isParentLocal = true;
+                    uv.m_slot = 0;
+                }
             }
             else
             {
@@ -2421,6 +2538,11 @@ HeapPtr<FunctionObject> CompileMethod(TempArenaAllocator& alloc,
         ucb->m_cstTableLength = static_cast<uint32_t>(constantTableData.second);
         ucb->m_cstTable = constantTableData.first;
 
+        for (auto& item : c->m_foldedGlobals)
+        {
+            vm->RegisterFoldedGlobalConstant(item.first, ucb, item.second);
+        }
+
         ucb->m_bytecode = bytecodeData.first;
         ucb->m_bytecodeLengthIncludingTailPadding = static_cast<uint32_t>(bytecodeData.second);
         ucb->m_bytecodeMetadataLength = bw.GetBytecodeMetadataTotalLength();
@@ -2466,12 +2588,83 @@ HeapPtr<FunctionObject> CompileMethod(TempArenaAllocator& alloc,
 
     CodeBlock* cb = ctx->m_resultUcb->m_defaultCodeBlock;
     TestAssert(cb->m_numUpvalues == 0);
+    return cb;
+}
 
-    return FunctionObject::CreateAndFillUpvalues(cb,
-                                                 nullptr /*CoroRuntimeCtx*/,
-                                                 nullptr /*stackBase*/,
-                                                 nullptr /*parent*/,
-                                                 static_cast<size_t>(-1) /*selfOrdInStackFrame*/).As();
+// Everything needed to compile a method lazily (see SOMCompileLazyMethod)
+//
+// The AST, the field map and this struct itself live in the arena of the class,
+// which is kept alive as long as the class has methods that are not compiled yet.
+//
+struct SOMLazyMethodInfo
+{
+    SOMLazyMethodArena* m_arena;
+    SOMClass* m_superClass;
+    TempUnorderedMap<std::string_view, uint32_t /*objectSlotOrd*/>* m_fieldMap;
+    AstMethod* m_meth;
+    std::string_view m_className;
+    // The class (or metaclass) that defines the method, set once it is created
+    // Null for the class-side methods of the root classes, whose metaclasses are set up separately
+    //
+    SOMClass* m_holderClass;
+    bool m_isSelfObject;
+    bool m_isClassSide;
+};
+
+// SOMCompileFile does not compile non-primitive methods. Instead, each of them is a stub FunctionObject
+// (see SOMPrimitivesContainer::CreateLazyMethodStub), and the method is compiled when it is looked up for the first time.
+// The stub has one upvalue slot, which is enough for the extra upvalue of a trivial method,
+// so the stub can be turned into the compiled method in place, and all method tables that hold the stub need no update.
+//
+// Drop one reference to 'arena', and free it if it was the last one
+//
+static void ReleaseLazyMethodArena(VM* vm, SOMLazyMethodArena* arena)
+{
+    TestAssert(arena->m_numUncompiledMethods > 0);
+    arena->m_numUncompiledMethods--;
+    if (arena->m_numUncompiledMethods > 0)
+    {
+        return;
+    }
+    std::vector<SOMLazyMethodArena*>& list = vm->m_lazyMethodArenas;
+    TestAssert(arena->m_index < list.size() && list[arena->m_index] == arena);
+    list[arena->m_index] = list.back();
+    list[arena->m_index]->m_index = arena->m_index;
+    list.pop_back();
+    delete arena->m_alloc;
+    delete arena;
+}
+
+void NO_INLINE SOMCompileLazyMethod(HeapPtr<FunctionObject> fnHeapPtr)
+{
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    FunctionObject* fn = TranslateToRawPointer(vm, fnHeapPtr);
+    if ((fn->m_invalidArrayType >> 4) != SOM_LazyMethod)
+    {
+        return;
+    }
+    TestAssert(fn->m_numUpvalues == 1);
+    SOMLazyMethodInfo* info = reinterpret_cast<SOMLazyMethodInfo*>(fn->m_upvalues[0].m_value);
+
+    TempArenaAllocator alloc;
+    CodeBlock* cb = CompileMethod(alloc, info->m_superClass, *info->m_fieldMap, info->m_meth, info->m_isSelfObject, info->m_className, info->m_isClassSide,
+                                  info->m_holderClass, fnHeapPtr);
+
+    fn->m_executable = SystemHeapPointer<ExecutableCode>(static_cast<ExecutableCode*>(cb));
+    if (cb->m_needExtraUpvalueDueToTrivialFn)
+    {
+        fn->m_upvalues[0].m_value = cb->m_trivialFnExtraInfo;
+    }
+    else
+    {
+        fn->m_numUpvalues = 0;
+    }
+    fn->m_invalidArrayType = cb->m_fnTyMask;
+    vm->m_numLazyMethodsCompiled++;
+
+    // 'info' lives in the arena, so it must not be used after this
+    //
+    ReleaseLazyMethodArena(vm, info->m_arena);
 }
 
 // Populate the SOMClass's method array and static method array after both the class and the class-class is available
@@ -2503,12 +2696,49 @@ SOMClass* WARN_UNUSED SOMCompileFile(std::string className, bool isSystemClass)
     }
     Auto(TestAssert(vm->m_parsedClasses.count(stringId)));
 
-    std::ifstream inFile = OpenFileForClass(className);
-    TempArenaAllocator alloc;
-
-    SOMParser parser(alloc, interner, className, inFile);
+    // The arena owns the AST, so it must outlive the class until all its methods to be compiled lazily have been compiled
+    //
+    TempArenaAllocator* classAlloc;
+    AstClass* cl;
+    if (auto it = vm->m_inMemoryClassSources.find(className); it != vm->m_inMemoryClassSources.end())
+    {
+        classAlloc = new TempArenaAllocator();
+        SOMParser parser(*classAlloc, interner, className, it->second);
+        cl = parser.ParseClass();
+    }
+    else if (auto preparsedIt = vm->m_preparsedClasses.find(stringId); preparsedIt != vm->m_preparsedClasses.end())
+    {
+        if (preparsedIt->second.m_ast == nullptr)
+        {
+            fprintf(stderr, "%s\n", preparsedIt->second.m_parseError.c_str());
+            abort();
+        }
+        classAlloc = preparsedIt->second.m_alloc;
+        cl = preparsedIt->second.m_ast;
+        vm->m_preparsedClasses.erase(preparsedIt);
+    }
+    else
+    {
+        SOMFileContent content;
+        OpenFileForClass(vm, className, content /*out*/);
+        Auto(content.Close());
+        classAlloc = new TempArenaAllocator();
+        SOMParser parser(*classAlloc, interner, className, content.GetContent());
+        cl = parser.ParseClass();
+    }
+    TempArenaAllocator& alloc = *classAlloc;
+    SOMLazyMethodArena* lazyArena = new SOMLazyMethodArena {
+        .m_alloc = classAlloc,
+        .m_numUncompiledMethods = 1,
+        .m_index = static_cast<uint32_t>(vm->m_lazyMethodArenas.size())
+    };
+    vm->m_lazyMethodArenas.push_back(lazyArena);
+    Auto(ReleaseLazyMethodArena(vm, lazyArena));
 
-    AstClass* cl = parser.ParseClass();
+    if (!cl->m_superClassName.empty())
+    {
+        cl->m_superClass = SOMCompileFile(std::string(cl->m_superClassName));
+    }
 
     TestAssertIff(className == "Object", cl->m_superClass == nullptr);
 
@@ -2595,6 +2825,7 @@ SOMClass* WARN_UNUSED SOMCompileFile(std::string className, bool isSystemClass)
         else if (className == "True") { preallocatedAddr = vm->m_trueClass; }
         else if (className == "False") { preallocatedAddr = vm->m_falseClass; }
         else if (className == "Integer") { preallocatedAddr = vm->m_integerClass; }
+        else if (className == "LargeInteger") { preallocatedAddr = vm->m_largeIntegerClass; }
         else if (className == "Double") { preallocatedAddr = vm->m_doubleClass; }
         else if (className == "Block") { preallocatedAddr = vm->m_blockClass; }
         else if (className == "Block1") { preallocatedAddr = vm->m_block1Class; }
@@ -2609,8 +2840,38 @@ SOMClass* WARN_UNUSED SOMCompileFile(std::string className, bool isSystemClass)
         res = TranslateToRawPointer(vm, preallocatedAddr);
     }
 
+    std::string_view classNameInArena;
+    {
+        char* buf = alloc.AllocateArray<char>(className.size());
+        memcpy(buf, className.data(), className.size());
+        classNameInArena = std::string_view(buf, className.size());
+    }
+
+    TempVector<SOMLazyMethodInfo*> instanceSideLazyMethods(alloc);
+    TempVector<SOMLazyMethodInfo*> classSideLazyMethods(alloc);
+    auto createLazyMethod = [&](SOMClass* superClass,
+                                TempUnorderedMap<std::string_view, uint32_t /*objectSlotOrd*/>* fieldMap,
+                                AstMethod* meth,
+                                bool isSelfObject,
+                                bool isClassSide) -> HeapPtr<FunctionObject>
+    {
+        SOMLazyMethodInfo* info = alloc.AllocateObject<SOMLazyMethodInfo>();
+        info->m_arena = lazyArena;
+        lazyArena->m_numUncompiledMethods++;
+        info->m_superClass = superClass;
+        info->m_fieldMap = fieldMap;
+        info->m_meth = meth;
+        info->m_className = classNameInArena;
+        info->m_holderClass = nullptr;
+        info->m_isSelfObject = isSelfObject;
+        info->m_isClassSide = isClassSide;
+        (isClassSide ? classSideLazyMethods : instanceSideLazyMethods).push_back(info);
+        vm->m_numLazyMethodStubs++;
+        return vm->m_somPrimitives.CreateLazyMethodStub(info);
+    };
+
     {
-        TempUnorderedMap<std::string_view, uint32_t /*objectSlotOrd*/> fieldMap(alloc);
+        TempUnorderedMap<std::string_view, uint32_t /*objectSlotOrd*/>& fieldMap = *alloc.AllocateObject<TempUnorderedMap<std::string_view, uint32_t /*objectSlotOrd*/>>(alloc);
         uint32_t curFieldOrd = 0;
         if (cl->m_superClass != nullptr)
         {
@@ -2647,7 +2908,7 @@ SOMClass* WARN_UNUSED SOMCompileFile(std::string className, bool isSystemClass)
             HeapPtr<FunctionObject> fn;
             if (!meth->m_isPrimitive)
             {
-                fn = CompileMethod(alloc, cl->m_superClass, fieldMap, meth, isSelfObject, className, false /*isClassSide*/);
+                fn = createLazyMethod(cl->m_superClass, &fieldMap, meth, isSelfObject, false /*isClassSide*/);
             }
             else
             {
@@ -2687,6 +2948,10 @@ SOMClass* WARN_UNUSED SOMCompileFile(std::string className, bool isSystemClass)
                                methods,
                                fields,
                                res);
+        for (SOMLazyMethodInfo* info : instanceSideLazyMethods)
+        {
+            info->m_holderClass = res;
+        }
     }
 
     // The class objects for these "root" classes are specially set up by caller logic
@@ -2696,7 +2961,7 @@ SOMClass* WARN_UNUSED SOMCompileFile(std::string className, bool isSystemClass)
         SOMClass* SClass = TranslateToRawPointer(vm, SystemHeapPointer<SOMClass>(res->m_superClass->m_classObject->m_hiddenClass).As());
 
         {
-            TempUnorderedMap<std::string_view, uint32_t /*objectSlotOrd*/> fieldMap(alloc);
+            TempUnorderedMap<std::string_view, uint32_t /*objectSlotOrd*/>& fieldMap = *alloc.AllocateObject<TempUnorderedMap<std::string_view, uint32_t /*objectSlotOrd*/>>(alloc);
             uint32_t curFieldOrd = 0;
             for (size_t i = 0; i < SClass->m_numFields; i++)
             {
@@ -2723,7 +2988,7 @@ SOMClass* WARN_UNUSED SOMCompileFile(std::string className, bool isSystemClass)
                 HeapPtr<FunctionObject> fn;
                 if (!meth->m_isPrimitive)
                 {
-                    fn = CompileMethod(alloc, SClass /*superClass*/, fieldMap, meth, true /*isSelfObject*/, className, true /*isClassSide*/);
+                    fn = createLazyMethod(SClass /*superClass*/, &fieldMap, meth, true /*isSelfObject*/, true /*isClassSide*/);
                 }
                 else
                 {
@@ -2757,6 +3022,10 @@ SOMClass* WARN_UNUSED SOMCompileFile(std::string className, bool isSystemClass)
                                             SClass,
                                             methods,
                                             fields);
+        for (SOMLazyMethodInfo* info : classSideLazyMethods)
+        {
+            info->m_holderClass = CClass;
+        }
 
         TestAssert(vm->m_metaclassClassLoaded);
         CClass->m_classObject = TranslateToRawPointer(vm->m_metaclassClass)->Instantiate();
@@ -2811,12 +3080,269 @@ void SetupSystemClassObject(SOMClass* cl, std::string_view name, SOMClass* class
     FinishSOMClassMethodArray(cl);
 }
 
-SOMInitializationResult SOMBootstrapClassHierarchy()
+// Lexing and parsing a class file does not depend on any other class, so they are done on multiple threads ahead of time.
+// Starting from the root classes, the classes to parse are discovered from the superclass names and the capitalized variable
+// names used in each parsed class, and a name is ignored if no file in the class path has this name.
+// Bytecode generation and everything else that touches the VM heap are still done by SOMCompileFile on the main thread.
+//
+// A class found this way is parsed even if it is never loaded by the program, so a syntax error is not reported here.
+// It is stored and only reported if SOMCompileFile loads the class.
+//
+// Each class is parsed with its own StringInterner, and the strings are interned into the VM's interner afterwards,
+// class by class in the order of the class names, so the string ordinals do not depend on how the work was scheduled.
+//
+// The main thread starts parsing alone, and another thread is only started each time the source parsed so far
+// exceeds x_minSourceBytesPerParseThread per running thread, so small programs do not pay for starting threads.
+//
+static constexpr size_t x_minSourceBytesPerParseThread = 64 * 1024;
+
+void SOMPreparseClasses(const std::vector<std::string>& rootClassNames)
+{
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    StringInterner* interner = &vm->m_interner;
+    // The worker threads have no active VM, so they must not call VM_GetActiveVMForCurrentThread
+    //
+    const std::vector<std::string>& classLoadPaths = vm->m_classLoadPaths;
+
+    size_t maxThreads = g_numClassParseThreads;
+    if (maxThreads == 0)
+    {
+        maxThreads = std::min(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(8));
+    }
+    if (maxThreads <= 1)
+    {
+        return;
+    }
+
+    struct ParseResult
+    {
+        std::string m_className;
+        TempArenaAllocator* m_alloc;
+        AstClass* m_ast;
+        std::unique_ptr<StringInterner> m_interner;
+        TempVector<size_t*>* m_internedOrdSlots;
+        std::string m_parseError;
+    };
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> worklist;
+    size_t numInProgress = 0;
+    size_t numSourceBytesParsed = 0;
+    std::vector<std::thread> threads;
+    std::vector<ParseResult> results;
+
+    for (auto& it : vm->m_parsedClasses)
+    {
+        seen.insert(std::string(interner->Get(it.first)));
+    }
+    for (auto& it : vm->m_preparsedClasses)
+    {
+        seen.insert(std::string(interner->Get(it.first)));
+    }
+
+    // Must be called with the lock held
+    //
+    auto enqueue = [&](std::string_view className)
+    {
+        if (seen.insert(std::string(className)).second)
+        {
+            worklist.push_back(std::string(className));
+            cv.notify_one();
+        }
+    };
+
+    for (const std::string& className : rootClassNames)
+    {
+        enqueue(className);
+    }
+
+    std::function<void()> workerFn = [&]()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true)
+        {
+            cv.wait(guard, [&]() { return !worklist.empty() || numInProgress == 0; });
+            if (worklist.empty())
+            {
+                break;
+            }
+            std::string className = std::move(worklist.back());
+            worklist.pop_back();
+            numInProgress++;
+            guard.unlock();
+
+            ParseResult r {
+                .m_className = std::move(className),
+                .m_alloc = nullptr,
+                .m_ast = nullptr,
+                .m_interner = nullptr,
+                .m_internedOrdSlots = nullptr,
+                .m_parseError = ""
+            };
+            size_t sourceSize = 0;
+            SOMFileContent content;
+            if (TryOpenFileForClass(classLoadPaths, r.m_className, content /*out*/))
+            {
+                sourceSize = content.GetContent().size();
+                r.m_alloc = new TempArenaAllocator();
+                r.m_interner = std::make_unique<StringInterner>();
+                r.m_internedOrdSlots = r.m_alloc->AllocateObject<TempVector<size_t*>>(*r.m_alloc);
+                {
+                    SOMParser parser(*r.m_alloc, r.m_interner.get(), r.m_className, content.GetContent());
+                    parser.m_internedOrdSlots = r.m_internedOrdSlots;
+                    parser.m_throwOnError = true;
+                    try
+                    {
+                        r.m_ast = parser.ParseClass();
+                    }
+                    catch (SOMParseError& e)
+                    {
+                        r.m_parseError = std::move(e.m_message);
+                    }
+                }
+                content.Close();
+                if (r.m_ast == nullptr)
+                {
+                    delete r.m_alloc;
+                    r.m_alloc = nullptr;
+                    r.m_interner.reset();
+                    r.m_internedOrdSlots = nullptr;
+                }
+            }
+
+            guard.lock();
+            numInProgress--;
+            if (r.m_ast != nullptr)
+            {
+                if (!r.m_ast->m_superClassName.empty())
+                {
+                    enqueue(r.m_ast->m_superClassName);
+                }
+                for (std::string_view name : r.m_ast->m_referencedClassNames)
+                {
+                    enqueue(name);
+                }
+            }
+            if (r.m_ast != nullptr || !r.m_parseError.empty())
+            {
+                results.push_back(std::move(r));
+            }
+            numSourceBytesParsed += sourceSize;
+            if (!worklist.empty() && threads.size() + 1 < maxThreads && numSourceBytesParsed >= (threads.size() + 1) * x_minSourceBytesPerParseThread)
+            {
+                threads.push_back(std::thread(workerFn));
+            }
+            if (worklist.empty() && numInProgress == 0)
+            {
+                cv.notify_all();
+            }
+        }
+    };
+
+    // A thread can only be started while there is work left, so no thread is started once the main thread returns from workerFn
+    //
+    workerFn();
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+
+    std::sort(results.begin(), results.end(), [](const ParseResult& lhs, const ParseResult& rhs) { return lhs.m_className < rhs.m_className; });
+    for (ParseResult& r : results)
+    {
+        size_t stringId = interner->InternString(r.m_className);
+        TestAssert(!vm->m_parsedClasses.count(stringId) && !vm->m_preparsedClasses.count(stringId));
+        if (r.m_ast != nullptr)
+        {
+            for (size_t* slot : *r.m_internedOrdSlots)
+            {
+                *slot = interner->InternString(r.m_interner->Get(*slot));
+            }
+        }
+        vm->m_preparsedClasses[stringId] = SOMPreparsedClass {
+            .m_alloc = r.m_alloc,
+            .m_ast = r.m_ast,
+            .m_parseError = std::move(r.m_parseError)
+        };
+    }
+    vm->m_numClassesPreparsed += static_cast<uint32_t>(results.size());
+}
+
+void SOMRunParserBenchmark(const std::vector<std::string>& dirs, size_t numRepeats)
+{
+    std::vector<std::string> fileNames;
+    for (const std::string& dir : dirs)
+    {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(dir))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".som")
+            {
+                fileNames.push_back(entry.path().string());
+            }
+        }
+    }
+    std::sort(fileNames.begin(), fileNames.end());
+
+    std::vector<SOMFileContent> contents(fileNames.size());
+    size_t totalBytes = 0;
+    for (size_t i = 0; i < fileNames.size(); i++)
+    {
+        if (!contents[i].Open(fileNames[i].c_str()))
+        {
+            fprintf(stderr, "Failed to read file %s\n", fileNames[i].c_str());
+            abort();
+        }
+        totalBytes += contents[i].m_size;
+    }
+
+    // The files are mapped and paged in by a first untimed pass, so only lexing and parsing are measured
+    //
+    StringInterner interner;
+    auto parseAll = [&]()
+    {
+        for (size_t i = 0; i < fileNames.size(); i++)
+        {
+            TempArenaAllocator alloc;
+            SOMParser parser(alloc, &interner, fileNames[i], contents[i].GetContent());
+            std::ignore = parser.ParseClass();
+        }
+    };
+    parseAll();
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < numRepeats; k++)
+    {
+        parseAll();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    for (SOMFileContent& content : contents)
+    {
+        content.Close();
+    }
+
+    double totalMB = static_cast<double>(totalBytes) * static_cast<double>(numRepeats) / 1000000.0;
+    printf("Parsed %zu files (%zu bytes) %zu times in %.3f s: %.2f MB/s\n",
+           fileNames.size(), totalBytes, numRepeats, seconds, totalMB / seconds);
+}
+
+SOMInitializationResult SOMBootstrapClassHierarchy(const std::vector<std::string>& appClassNames)
 {
     VM* vm = VM_GetActiveVMForCurrentThread();
 
     TestAssert(!vm->m_metaclassClassLoaded);
 
+    {
+        std::vector<std::string> rootClassNames = {
+            "Object", "Class", "Metaclass", "Array", "String", "Boolean", "Nil", "True", "False", "Integer", "LargeInteger",
+            "Double", "Block", "Block1", "Block2", "Block3", "Method", "Symbol", "Primitive", "System"
+        };
+        rootClassNames.insert(rootClassNames.end(), appClassNames.begin(), appClassNames.end());
+        SOMPreparseClasses(rootClassNames);
+    }
+
     vm->m_objectClass = SOMClass::AllocateUninitializedSystemClass();
     vm->m_classClass = SOMClass::AllocateUninitializedSystemClass();
     vm->m_metaclassClass = SOMClass::AllocateUninitializedSystemClass();
@@ -2827,6 +3353,7 @@ SOMInitializationResult SOMBootstrapClassHierarchy()
     vm->m_trueClass = SOMClass::AllocateUninitializedSystemClass();
     vm->m_falseClass = SOMClass::AllocateUninitializedSystemClass();
     vm->m_integerClass = SOMClass::AllocateUninitializedSystemClass();
+    vm->m_largeIntegerClass = SOMClass::AllocateUninitializedSystemClass();
     vm->m_doubleClass = SOMClass::AllocateUninitializedSystemClass();
     vm->m_blockClass = SOMClass::AllocateUninitializedSystemClass();
     vm->m_block1Class = SOMClass::AllocateUninitializedSystemClass();
@@ -2873,6 +3400,7 @@ SOMInitializationResult SOMBootstrapClassHierarchy()
     std::ignore = SOMCompileFile("True", true);
     std::ignore = SOMCompileFile("False", true);
     std::ignore = SOMCompileFile("Integer", true);
+    std::ignore = SOMCompileFile("LargeInteger", true);
     std::ignore = SOMCompileFile("Double", true);
     std::ignore = SOMCompileFile("Block", true);
     std::ignore = SOMCompileFile("Block1", true);
@@ -7,10 +7,17 @@ class SOMObject;
 class SOMClass;
 class FunctionObject;
 
-extern std::vector<std::string> g_classLoadPaths;
+// The maximum number of threads used by SOMPreparseClasses, 0 means decided by the number of cores, 1 disables it
+//
+extern size_t g_numClassParseThreads;
 
 SOMClass* WARN_UNUSED SOMCompileFile(std::string className, bool isSystemClass = false);
 
+// Make SOMCompileFile load 'className' from 'source' instead of from '<className>.som' in the class path
+// Must be called before the class is loaded
+//
+void SOMAddInMemoryClassSource(const std::string& className, std::string source);
+
 HeapPtr<FunctionObject> SOMGetMethodFromClass(SOMClass* c, std::string_view meth);
 
 struct SOMInitializationResult
@@ -19,4 +26,15 @@ struct SOMInitializationResult
     SOMObject* m_systemInstance;
 };
 
-SOMInitializationResult SOMBootstrapClassHierarchy();
+// Parse the given classes and the classes they depend on in parallel, so later SOMCompileFile calls do not need to parse them
+//
+void SOMPreparseClasses(const std::vector<std::string>& rootClassNames);
+
+// Lex and parse (without compiling) all .som files in the given directories 'numRepeats' times, and print the throughput
+//
+void SOMRunParserBenchmark(const std::vector<std::string>& dirs, size_t numRepeats);
+
+// 'appClassNames' are classes the application likely uses, they are parsed together with the system classes
+// A name that is not a class in the class path is ignored
+//
+SOMInitializationResult SOMBootstrapClassHierarchy(const std::vector<std::string>& appClassNames = {});
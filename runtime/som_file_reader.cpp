@@ -0,0 +1,120 @@
+#include "som_file_reader.h"
+#include "vm.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool WARN_UNUSED SOMFileContent::Open(const char* fileName)
+{
+    TestAssert(m_data == nullptr);
+    int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return false;
+    }
+    Auto(close(fd));
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        return false;
+    }
+
+    if (S_ISREG(st.st_mode))
+    {
+        m_size = static_cast<size_t>(st.st_size);
+        if (m_size == 0)
+        {
+            return true;
+        }
+        void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            // The content is usually scanned front to back exactly once
+            //
+            std::ignore = madvise(addr, m_size, MADV_SEQUENTIAL);
+            m_data = reinterpret_cast<const char*>(addr);
+            m_isMapped = true;
+            return true;
+        }
+        m_size = 0;
+    }
+
+    // Not mappable, read it into a growing buffer
+    //
+    size_t capacity = 65536;
+    char* buf = reinterpret_cast<char*>(malloc(capacity));
+    ReleaseAssert(buf != nullptr);
+    size_t size = 0;
+    while (true)
+    {
+        if (size == capacity)
+        {
+            capacity *= 2;
+            buf = reinterpret_cast<char*>(realloc(buf, capacity));
+            ReleaseAssert(buf != nullptr);
+        }
+        ssize_t n = read(fd, buf + size, capacity - size);
+        if (n == 0)
+        {
+            break;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            free(buf);
+            return false;
+        }
+        size += static_cast<size_t>(n);
+    }
+    m_data = buf;
+    m_size = size;
+    m_isMapped = false;
+    return true;
+}
+
+void SOMFileContent::Close()
+{
+    if (m_data != nullptr)
+    {
+        if (m_isMapped)
+        {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+        else
+        {
+            free(const_cast<char*>(m_data));
+        }
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_isMapped = false;
+}
+
+SOMObject* WARN_UNUSED SOMFileReader::Open(SOMClass* cl, const char* fileName)
+{
+    if (cl->m_numFields != 0)
+    {
+        fprintf(stderr, "FileReader and its subclasses must not declare fields.\n");
+        abort();
+    }
+    SOMFileReader* reader = new SOMFileReader();
+    if (!reader->m_file.Open(fileName))
+    {
+        delete reader;
+        return nullptr;
+    }
+    reader->m_pos = 0;
+
+    SOMObject* o = SOMObject::AllocateUninitialized(8);
+    SOMObject::Populate(o);
+    o->m_hiddenClass = SystemHeapPointer<SOMClass>(cl).m_value;
+    o->m_arrayType = SOM_FileReader;
+    o->m_data[0].m_value = reinterpret_cast<uint64_t>(reader);
+    return o;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "common_utils.h"
+#include "som_class.h"
+
+// Read-only view of the whole content of a file
+//
+// Regular files are memory-mapped, so their content is paged in on demand and is never copied until it is turned into
+// a SOM string. Other files (e.g., pipes) cannot be mapped, so they are read into a malloc'ed buffer instead.
+//
+class SOMFileContent
+{
+public:
+    // Return false if the file cannot be opened or read
+    //
+    bool WARN_UNUSED Open(const char* fileName);
+    void Close();
+
+    std::string_view WARN_UNUSED GetContent() { return std::string_view(m_data, m_size); }
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_isMapped = false;
+};
+
+// The native state of a 'FileReader' object (Smalltalk/FileReader.som), which streams a file as lines or chunks
+//
+// A FileReader instance is a SOMObject with m_arrayType == SOM_FileReader, and m_data[0] holds a raw pointer to its SOMFileReader.
+// Only the lines or chunks that are read are copied into SOM strings, so reading a large file does not need a
+// SOM string of the whole file.
+//
+class SOMFileReader
+{
+public:
+    // Return nullptr if the file cannot be opened
+    //
+    static SOMObject* WARN_UNUSED Open(SOMClass* cl, const char* fileName);
+
+    static SOMFileReader* WARN_UNUSED ALWAYS_INLINE Get(TValue reader)
+    {
+        TestAssert(reader.Is<tObject>() && reader.As<tObject>()->m_arrayType == SOM_FileReader);
+        return reinterpret_cast<SOMFileReader*>(reader.As<tObject>()->m_data[0].m_value);
+    }
+
+    bool WARN_UNUSED IsAtEnd() { return m_pos >= m_file.m_size; }
+
+    // Return the next line without its line terminator ("\n" or "\r\n"), and advance past the terminator
+    // Must not be at end
+    //
+    std::string_view WARN_UNUSED NextLine()
+    {
+        TestAssert(!IsAtEnd());
+        const char* start = m_file.m_data + m_pos;
+        size_t remaining = m_file.m_size - m_pos;
+        const char* nl = reinterpret_cast<const char*>(memchr(start, '\n', remaining));
+        size_t len;
+        if (nl == nullptr)
+        {
+            len = remaining;
+            m_pos = m_file.m_size;
+        }
+        else
+        {
+            len = static_cast<size_t>(nl - start);
+            m_pos += len + 1;
+            if (len > 0 && start[len - 1] == '\r')
+            {
+                len--;
+            }
+        }
+        return std::string_view(start, len);
+    }
+
+    // Return the next at most 'maxLen' bytes
+    //
+    std::string_view WARN_UNUSED NextChunk(size_t maxLen)
+    {
+        size_t len = std::min(maxLen, m_file.m_size - m_pos);
+        std::string_view res(m_file.m_data + m_pos, len);
+        m_pos += len;
+        return res;
+    }
+
+    // Release the file content. The reader is at end afterwards.
+    //
+    void Close()
+    {
+        m_file.Close();
+        m_pos = 0;
+    }
+
+    SOMFileContent m_file;
+    size_t m_pos;
+};
@@ -0,0 +1,94 @@
+#include "som_hash_table.h"
+
+SOMHashTable* WARN_UNUSED SOMHashTable::Allocate(uint32_t capacity, bool isIdentity)
+{
+    TestAssert(is_power_of_2(capacity));
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    uint32_t indexSize = capacity * 2;
+    size_t allocSize = sizeof(SOMHashTable) + sizeof(Entry) * capacity + sizeof(uint32_t) * indexSize;
+    allocSize = RoundUpToMultipleOf<8>(allocSize);
+    ReleaseAssert(allocSize < std::numeric_limits<uint32_t>::max());
+    SOMHashTable* ht = TranslateToRawPointer(vm, vm->AllocFromUserHeap(static_cast<uint32_t>(allocSize)).AsNoAssert<SOMHashTable>());
+    ht->m_count = 0;
+    ht->m_numUsed = 0;
+    ht->m_capacity = capacity;
+    ht->m_indexMask = indexSize - 1;
+    ht->m_epoch = 0;
+    ht->m_isIdentity = isIdentity;
+    memset(ht->GetIndex(), 0, sizeof(uint32_t) * indexSize);
+    return ht;
+}
+
+SOMObject* WARN_UNUSED SOMHashTable::AllocateHashMapObject(SOMClass* cl, bool isIdentity)
+{
+    if (cl->m_numFields != 0)
+    {
+        fprintf(stderr, "HashMap and its subclasses must not declare fields.\n");
+        abort();
+    }
+    SOMObject* o = SOMObject::AllocateUninitialized(8);
+    SOMObject::Populate(o);
+    o->m_hiddenClass = SystemHeapPointer<SOMClass>(cl).m_value;
+    o->m_arrayType = SOM_HashTable;
+    o->m_data[0].m_value = reinterpret_cast<uint64_t>(Allocate(x_initialCapacity, isIdentity));
+    return o;
+}
+
+SOMHashTable* WARN_UNUSED SOMHashTable::Rehash(HeapPtr<SOMObject> hashMap, uint32_t capacity)
+{
+    SOMHashTable* old = Get(TValue::Create<tObject>(hashMap));
+    TestAssert(old->m_count <= capacity);
+    SOMHashTable* ht = Allocate(capacity, old->m_isIdentity);
+    for (uint32_t i = 0; i < old->m_numUsed; i++)
+    {
+        const Entry& entry = old->m_entries[i];
+        if (entry.m_kind == KeyKind::Deleted)
+        {
+            continue;
+        }
+        uint32_t ord = ht->m_numUsed;
+        ht->m_entries[ord] = entry;
+        ht->m_numUsed++;
+        ht->InsertIntoIndex(ord);
+    }
+    ht->m_count = ht->m_numUsed;
+    ht->m_epoch = old->m_epoch + 1;
+    TestAssert(ht->m_count == old->m_count);
+    hashMap->m_data[0].m_value = reinterpret_cast<uint64_t>(ht);
+    return ht;
+}
+
+void SOMHashTable::Insert(HeapPtr<SOMObject> hashMap, TValue key, KeyInfo ki, TValue value)
+{
+    TestAssert(ki.m_kind != KeyKind::Deleted);
+    SOMHashTable* ht = Get(TValue::Create<tObject>(hashMap));
+    if (ht->m_numUsed == ht->m_capacity)
+    {
+        // If at least half of the entries are holes, compacting them away is enough, otherwise grow the table
+        //
+        uint32_t newCapacity = ht->m_capacity;
+        if (ht->m_count * 2 >= ht->m_capacity)
+        {
+            ReleaseAssert(newCapacity < (1U << 26));
+            newCapacity *= 2;
+        }
+        ht = Rehash(hashMap, newCapacity);
+    }
+    uint32_t ord = ht->m_numUsed;
+    Entry& entry = ht->m_entries[ord];
+    entry.m_key = key;
+    entry.m_value = value;
+    entry.m_hash = ki.m_hash;
+    entry.m_kind = ki.m_kind;
+    ht->m_numUsed++;
+    ht->m_count++;
+    ht->InsertIntoIndex(ord);
+}
+
+void SOMHashTable::Clear(HeapPtr<SOMObject> hashMap)
+{
+    SOMHashTable* old = Get(TValue::Create<tObject>(hashMap));
+    SOMHashTable* ht = Allocate(x_initialCapacity, old->m_isIdentity);
+    ht->m_epoch = old->m_epoch + 1;
+    hashMap->m_data[0].m_value = reinterpret_cast<uint64_t>(ht);
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include "common_utils.h"
+#include "som_class.h"
+#include "som_utils.h"
+
+// The native hash table backing the 'HashMap' class (Smalltalk/HashMap.som)
+//
+// A HashMap instance is a SOMObject with m_arrayType == SOM_HashTable, and m_data[0] holds a raw pointer to its SOMHashTable.
+// The SOMHashTable is reallocated when it grows, so the identity of the HashMap object never changes.
+//
+// Entries are stored in insertion order in a dense array, so iteration order is insertion order.
+// An open-addressing index (power-of-two size, linear probing) maps hash codes to entry ordinals.
+// Removed entries are left in the entry array as holes, which are dropped on the next rehash.
+// Since a rehash moves the entries, the HashMap iteration primitives iterate over a snapshot of the entries instead.
+//
+// Key comparison:
+//     Identity tables ('HashMap newIdentity') compare all keys with '=='.
+//     Equality tables ('HashMap new') compare keys with '=', with the key already in the table as the receiver,
+//     same as the SOM collections this replaces. Integers, doubles, strings, symbols, and objects whose class does not
+//     override '=' are hashed and compared natively. Keys whose class overrides '=' ("custom keys") are hashed by sending
+//     'hashcode' in SOM (Object.som requires a class that overrides '=' to override 'hashcode' consistently), and the
+//     HashMap primitives call '=' in SOM on each custom entry in the probe sequence that has the same hash.
+//     Custom keys are only compared with custom keys: a number, string, or object that does not override '=' is never
+//     equal to a custom key, and a custom key must not claim to be equal to one of them either.
+//
+// Every rehash (and removeAll) installs a new SOMHashTable with a larger epoch, so a primitive that called into SOM
+// in the middle of a lookup can tell whether the index it was probing is still valid.
+//
+class SOMHashTable
+{
+public:
+    enum class KeyKind : uint8_t
+    {
+        // Compared by '=='
+        //
+        Identity,
+        // Integer (including LargeInteger) or Double, compared numerically
+        //
+        Number,
+        // String or Symbol, compared by content
+        //
+        String,
+        // An object whose class overrides '=', hashed by its 'hashcode'
+        //
+        Custom,
+        // A removed entry
+        //
+        Deleted
+    };
+
+    struct KeyInfo
+    {
+        KeyKind m_kind;
+        uint32_t m_hash;
+    };
+
+    struct Entry
+    {
+        TValue m_key;
+        TValue m_value;
+        uint32_t m_hash;
+        KeyKind m_kind;
+    };
+    static_assert(sizeof(Entry) == 24);
+
+    static constexpr uint32_t x_initialCapacity = 8;
+
+    static SOMHashTable* WARN_UNUSED Allocate(uint32_t capacity, bool isIdentity);
+
+    // Allocate an empty HashMap object of class 'cl'
+    //
+    static SOMObject* WARN_UNUSED AllocateHashMapObject(SOMClass* cl, bool isIdentity);
+
+    static SOMHashTable* WARN_UNUSED ALWAYS_INLINE Get(TValue hashMap)
+    {
+        TestAssert(hashMap.Is<tObject>() && hashMap.As<tObject>()->m_arrayType == SOM_HashTable);
+        return reinterpret_cast<SOMHashTable*>(hashMap.As<tObject>()->m_data[0].m_value);
+    }
+
+    static uint32_t WARN_UNUSED ALWAYS_INLINE HashNumber(TValue key)
+    {
+        // Integral doubles must hash the same as the equal integer
+        //
+        int64_t i;
+        if (TryGetSOMIntegerValue(key, &i /*out*/))
+        {
+            return static_cast<uint32_t>(HashPrimitiveTypes(i));
+        }
+        TestAssert(key.Is<tDouble>());
+        double d = key.As<tDouble>();
+        if (UnsafeFloatEqual(d, std::trunc(d)) && std::abs(d) < 9.2e18)
+        {
+            return static_cast<uint32_t>(HashPrimitiveTypes(static_cast<int64_t>(d)));
+        }
+        return static_cast<uint32_t>(HashPrimitiveTypes(d));
+    }
+
+    KeyInfo WARN_UNUSED ALWAYS_INLINE ClassifyKey(VM* vm, TValue key)
+    {
+        if (m_isIdentity)
+        {
+            return { .m_kind = KeyKind::Identity, .m_hash = static_cast<uint32_t>(HashPrimitiveTypes(GetSOMIdentityHashBits(key))) };
+        }
+        switch (GetSOMEqualityKind(vm, key))
+        {
+        case SOMEqualityKind::Identity:
+        {
+            return { .m_kind = KeyKind::Identity, .m_hash = static_cast<uint32_t>(HashPrimitiveTypes(GetSOMIdentityHashBits(key))) };
+        }
+        case SOMEqualityKind::Number:
+        {
+            return { .m_kind = KeyKind::Number, .m_hash = HashNumber(key) };
+        }
+        case SOMEqualityKind::String:
+        {
+            return { .m_kind = KeyKind::String, .m_hash = GetHashCodeFromSOMString(key) };
+        }
+        case SOMEqualityKind::Custom:
+        {
+            // The hash is only known after calling 'hashcode' in SOM, see HashCustomKey
+            //
+            return { .m_kind = KeyKind::Custom, .m_hash = 0 };
+        }
+        }   /*switch*/
+        __builtin_unreachable();
+    }
+
+    // Return true if 'entry' is equal to 'key', where 'key' is not a custom key
+    //
+    static bool WARN_UNUSED ALWAYS_INLINE IsEntryEqualToKey(const Entry& entry, TValue key, KeyInfo ki)
+    {
+        TestAssert(ki.m_kind != KeyKind::Custom && ki.m_kind != KeyKind::Deleted);
+        if (entry.m_kind != ki.m_kind || entry.m_hash != ki.m_hash)
+        {
+            return false;
+        }
+        static_assert(static_cast<uint8_t>(KeyKind::Identity) == static_cast<uint8_t>(SOMEqualityKind::Identity));
+        static_assert(static_cast<uint8_t>(KeyKind::Number) == static_cast<uint8_t>(SOMEqualityKind::Number));
+        static_assert(static_cast<uint8_t>(KeyKind::String) == static_cast<uint8_t>(SOMEqualityKind::String));
+        return SOMValuesEqualNative(entry.m_key, static_cast<SOMEqualityKind>(entry.m_kind), key);
+    }
+
+    // Compute the hash of a custom key from the result of its 'hashcode'
+    //
+    static uint32_t WARN_UNUSED ALWAYS_INLINE HashCustomKey(int64_t hashcode)
+    {
+        return static_cast<uint32_t>(HashPrimitiveTypes(hashcode));
+    }
+
+    uint32_t* WARN_UNUSED ALWAYS_INLINE GetIndex()
+    {
+        return reinterpret_cast<uint32_t*>(m_entries + m_capacity);
+    }
+
+    // Return the ordinal of the entry equal to 'key', or -1 if not found
+    // Only valid if 'key' is not a custom key
+    //
+    int64_t WARN_UNUSED ALWAYS_INLINE FindNative(TValue key, KeyInfo ki)
+    {
+        TestAssert(ki.m_kind != KeyKind::Custom && ki.m_kind != KeyKind::Deleted);
+        uint32_t* index = GetIndex();
+        uint32_t slot = ki.m_hash & m_indexMask;
+        while (true)
+        {
+            uint32_t ord = index[slot];
+            if (ord == 0)
+            {
+                return -1;
+            }
+            if (IsEntryEqualToKey(m_entries[ord - 1], key, ki))
+            {
+                return static_cast<int64_t>(ord - 1);
+            }
+            slot = (slot + 1) & m_indexMask;
+        }
+    }
+
+    // Probe the index for a custom key with hash 'hash', starting at index slot '*slot'.
+    // Return the ordinal of the next custom entry with the same hash, and set '*slot' to the index slot holding it,
+    // or return -1 if the probe sequence ends without one. The caller must call '=' in SOM to find out if the entry is equal.
+    //
+    int64_t WARN_UNUSED FindCustomCandidate(uint32_t hash, uint32_t* slot /*inout*/)
+    {
+        uint32_t* index = GetIndex();
+        uint32_t cur = *slot & m_indexMask;
+        while (true)
+        {
+            uint32_t ord = index[cur];
+            if (ord == 0)
+            {
+                return -1;
+            }
+            const Entry& entry = m_entries[ord - 1];
+            if (entry.m_kind == KeyKind::Custom && entry.m_hash == hash)
+            {
+                *slot = cur;
+                return static_cast<int64_t>(ord - 1);
+            }
+            cur = (cur + 1) & m_indexMask;
+        }
+    }
+
+    // Append a new entry, which must not be equal to any existing key
+    // This may reallocate the table of 'hashMap'
+    //
+    static void Insert(HeapPtr<SOMObject> hashMap, TValue key, KeyInfo ki, TValue value);
+
+    void RemoveEntry(uint32_t ord)
+    {
+        TestAssert(ord < m_numUsed);
+        Entry& entry = m_entries[ord];
+        TestAssert(entry.m_kind != KeyKind::Deleted);
+        // The entry stays in the index (so probing continues past it), but can never match since no key has kind 'Deleted'
+        //
+        entry.m_kind = KeyKind::Deleted;
+        entry.m_key = TValue::Create<tNil>();
+        entry.m_value = TValue::Create<tNil>();
+        TestAssert(m_count > 0);
+        m_count--;
+    }
+
+    // Remove all entries of 'hashMap'
+    //
+    static void Clear(HeapPtr<SOMObject> hashMap);
+
+    // Number of live entries
+    //
+    uint32_t m_count;
+    // Number of used entries in m_entries, including the holes left by removed entries
+    //
+    uint32_t m_numUsed;
+    // Size of m_entries. The index has 2 * m_capacity slots, so it is always at most half full.
+    //
+    uint32_t m_capacity;
+    uint32_t m_indexMask;
+    // Incremented each time the table is replaced by Rehash or Clear
+    //
+    uint32_t m_epoch;
+    bool m_isIdentity;
+
+    // Followed by the index, which has m_indexMask + 1 slots, each holding (entry ordinal + 1), or 0 if the slot is empty
+    //
+    Entry m_entries[0];
+
+private:
+    // Move all live entries of 'hashMap' into a new table of 'capacity' entries
+    //
+    static SOMHashTable* WARN_UNUSED Rehash(HeapPtr<SOMObject> hashMap, uint32_t capacity);
+
+    void InsertIntoIndex(uint32_t ord)
+    {
+        uint32_t* index = GetIndex();
+        uint32_t slot = m_entries[ord].m_hash & m_indexMask;
+        while (index[slot] != 0)
+        {
+            slot = (slot + 1) & m_indexMask;
+        }
+        index[slot] = ord + 1;
+    }
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "common_utils.h"
+#include "som_class.h"
+#include "vm.h"
+
+// SOM integers are 64-bit
+//
+// Values that fit in int32 are represented as an unboxed tInt32, which is what all the bytecode fast paths work on.
+// Values outside the int32 range are boxed as an instance of the 'LargeInteger' class (a subclass of 'Integer'), which is
+// a SOMObject with m_arrayType == SOM_LargeInteger holding the int64 value in m_data[0].
+//
+// The representation is canonical: a value that fits in int32 is never boxed. So two integers are equal iff they are
+// both tInt32 and bitwise equal, or both LargeInteger holding the same value.
+//
+// The arithmetic bytecodes check for int32 overflow and fall back to the Integer primitives, which compute in int64.
+// Overflowing int64 is a fatal error, since there is no arbitrary-precision integer.
+//
+
+inline bool WARN_UNUSED ALWAYS_INLINE IsSOMLargeInteger(TValue tv)
+{
+    return tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_LargeInteger;
+}
+
+inline bool WARN_UNUSED ALWAYS_INLINE IsSOMInteger(TValue tv)
+{
+    return tv.Is<tInt32>() || IsSOMLargeInteger(tv);
+}
+
+inline int64_t WARN_UNUSED ALWAYS_INLINE GetSOMLargeIntegerValue(TValue tv)
+{
+    TestAssert(IsSOMLargeInteger(tv));
+    int64_t v = static_cast<int64_t>(tv.As<tObject>()->m_data[0].m_value);
+    TestAssert(v != static_cast<int32_t>(v));
+    return v;
+}
+
+// Return true and set 'out' if 'tv' is an integer
+//
+inline bool WARN_UNUSED ALWAYS_INLINE TryGetSOMIntegerValue(TValue tv, int64_t* out /*out*/)
+{
+    if (likely(tv.Is<tInt32>()))
+    {
+        *out = tv.As<tInt32>();
+        return true;
+    }
+    if (IsSOMLargeInteger(tv))
+    {
+        *out = GetSOMLargeIntegerValue(tv);
+        return true;
+    }
+    return false;
+}
+
+inline int64_t WARN_UNUSED ALWAYS_INLINE GetSOMIntegerValue(TValue tv)
+{
+    if (likely(tv.Is<tInt32>()))
+    {
+        return tv.As<tInt32>();
+    }
+    return GetSOMLargeIntegerValue(tv);
+}
+
+// Evaluate 'lhs == rhs': integers are values, so two LargeInteger objects holding the same value are identical
+//
+inline bool WARN_UNUSED ALWAYS_INLINE SOMValuesIdentical(TValue lhs, TValue rhs)
+{
+    if (lhs.m_value == rhs.m_value)
+    {
+        return true;
+    }
+    return IsSOMLargeInteger(lhs) && IsSOMLargeInteger(rhs) && GetSOMLargeIntegerValue(lhs) == GetSOMLargeIntegerValue(rhs);
+}
+
+// The bits to hash for an identity-compared value, consistent with SOMValuesIdentical
+//
+inline uint64_t WARN_UNUSED ALWAYS_INLINE GetSOMIdentityHashBits(TValue tv)
+{
+    if (unlikely(IsSOMLargeInteger(tv)))
+    {
+        return static_cast<uint64_t>(GetSOMLargeIntegerValue(tv));
+    }
+    return tv.m_value;
+}
+
+inline TValue WARN_UNUSED NO_INLINE AllocateSOMLargeInteger(int64_t value)
+{
+    TestAssert(value != static_cast<int32_t>(value));
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    SOMObject* o = SOMObject::AllocateUninitialized(8);
+    SOMObject::Populate(o);
+    o->m_hiddenClass = SystemHeapPointer<SOMClass>(vm->m_largeIntegerClass).m_value;
+    o->m_arrayType = SOM_LargeInteger;
+    o->m_data[0].m_value = static_cast<uint64_t>(value);
+    return TValue::Create<tObject>(TranslateToHeapPtr(o));
+}
+
+inline TValue WARN_UNUSED ALWAYS_INLINE MakeSOMInteger(int64_t value)
+{
+    if (likely(value == static_cast<int32_t>(value)))
+    {
+        return TValue::Create<tInt32>(static_cast<int32_t>(value));
+    }
+    return AllocateSOMLargeInteger(value);
+}
+
+inline void NO_RETURN NO_INLINE ReportSOMIntegerOverflow(const char* op, int64_t lhs, int64_t rhs)
+{
+    fprintf(stderr, "Integer overflow: %lld %s %lld does not fit in 64 bits.\n",
+            static_cast<long long>(lhs), op, static_cast<long long>(rhs));
+    abort();
+}
+
+inline int64_t WARN_UNUSED ALWAYS_INLINE SOMIntegerAdd(int64_t lhs, int64_t rhs)
+{
+    int64_t res;
+    if (unlikely(__builtin_add_overflow(lhs, rhs, &res)))
+    {
+        ReportSOMIntegerOverflow("+", lhs, rhs);
+    }
+    return res;
+}
+
+inline int64_t WARN_UNUSED ALWAYS_INLINE SOMIntegerSub(int64_t lhs, int64_t rhs)
+{
+    int64_t res;
+    if (unlikely(__builtin_sub_overflow(lhs, rhs, &res)))
+    {
+        ReportSOMIntegerOverflow("-", lhs, rhs);
+    }
+    return res;
+}
+
+inline int64_t WARN_UNUSED ALWAYS_INLINE SOMIntegerMul(int64_t lhs, int64_t rhs)
+{
+    int64_t res;
+    if (unlikely(__builtin_mul_overflow(lhs, rhs, &res)))
+    {
+        ReportSOMIntegerOverflow("*", lhs, rhs);
+    }
+    return res;
+}
+
+// Truncating division, same as C
+//
+inline int64_t WARN_UNUSED ALWAYS_INLINE SOMIntegerDiv(int64_t lhs, int64_t rhs)
+{
+    if (unlikely(rhs == -1 && lhs == std::numeric_limits<int64_t>::min()))
+    {
+        ReportSOMIntegerOverflow("/", lhs, rhs);
+    }
+    return lhs / rhs;
+}
+
+// Remainder with the sign of the dividend
+//
+inline int64_t WARN_UNUSED ALWAYS_INLINE SOMIntegerRem(int64_t lhs, int64_t rhs)
+{
+    if (unlikely(rhs == -1))
+    {
+        return 0;
+    }
+    return lhs % rhs;
+}
+
+// Modulo with the sign of the divisor
+//
+inline int64_t WARN_UNUSED ALWAYS_INLINE SOMIntegerMod(int64_t lhs, int64_t rhs)
+{
+    int64_t result = SOMIntegerRem(lhs, rhs);
+    if ((result != 0) && ((result < 0) != (rhs < 0))) { result += rhs; }
+    return result;
+}
+
+// A negative shift amount shifts to the right
+//
+inline int64_t WARN_UNUSED ALWAYS_INLINE SOMIntegerLeftShift(int64_t lhs, int64_t rhs)
+{
+    if (rhs < 0)
+    {
+        return lhs >> std::min<int64_t>(-rhs, 63);
+    }
+    if (lhs == 0)
+    {
+        return 0;
+    }
+    if (unlikely(rhs >= 63))
+    {
+        ReportSOMIntegerOverflow("<<", lhs, rhs);
+    }
+    int64_t res = static_cast<int64_t>(static_cast<uint64_t>(lhs) << rhs);
+    if (unlikely((res >> rhs) != lhs))
+    {
+        ReportSOMIntegerOverflow("<<", lhs, rhs);
+    }
+    return res;
+}
+
+// Same as SOM++, this is an arithmetic shift despite the name
+//
+inline int64_t WARN_UNUSED ALWAYS_INLINE SOMIntegerRightShift(int64_t lhs, int64_t rhs)
+{
+    if (rhs < 0)
+    {
+        return SOMIntegerLeftShift(lhs, -rhs);
+    }
+    return lhs >> std::min<int64_t>(rhs, 63);
+}
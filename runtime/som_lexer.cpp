@@ -30,164 +30,171 @@
 #include <cctype>
 #include <cstdint>
 #include <cstring>
-#include <istream>
 #include <string>
 
-Lexer::Lexer(std::istream& file) : infile(file), peekDone(false) {}
+Lexer::Lexer(std::string_view content, TempArenaAllocator& alloc_) : buf(content), alloc(alloc_), peekDone(false) {}
 
-#define _BC (buf[state.bufp])
+// The content is not NUL-terminated, reading past the end yields '\0' (which is what the line-based lexer of SOM++ sees at end of line)
+//
+#define _CHAR_AT(pos) ((pos) < buf.length() ? buf[(pos)] : '\0')
+#define _BC _CHAR_AT(state.bufp)
 #define EOB (state.bufp >= buf.length())
 
-int64_t Lexer::fillBuffer() {
-    if (!infile.good()) {  // file stream
-        return -1;
-    }
-
-    std::getline(infile, buf);
-    state.lineNumber += 1;
-    state.bufp = 0;
-    return static_cast<int64_t>(buf.length());
-}
-
 //
 // basic lexing
 //
 
-void Lexer::skipWhiteSpace() {
-    while (isspace(_BC) != 0) {
-        state.incPtr();
-        while (EOB) {
-            if (fillBuffer() == -1) {
-                return;
-            }
+// Return the position of the first non-whitespace character at or after 'pos', or the length of the buffer if there is none
+//
+static size_t findNonWhiteSpace(std::string_view buf, size_t pos) {
+    // Whitespace runs are mostly indentation, so check 16 bytes at a time with pcmpistri.
+    // The set is the same as what isspace() accepts in the C locale.
+    // The load must not cross the end of the buffer (which may be the end of the mapping), so the tail is handled byte by byte.
+    //
+    const __m128i whiteSpaces = _mm_setr_epi8(' ', '\t', '\n', '\r', '\f', '\v', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    while (pos + 16 <= buf.length()) {
+        __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf.data() + pos));
+        int idx = _mm_cmpistri(whiteSpaces, data, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT);
+        if (idx < 16) {
+            return pos + static_cast<size_t>(idx);
         }
+        pos += 16;
+    }
+    while (pos < buf.length() && isspace(static_cast<unsigned char>(buf[pos])) != 0) {
+        pos++;
     }
+    return pos;
 }
 
-void Lexer::skipComment() {
-    if (_BC == '"') {
-        do {
-            state.incPtr();
-            while (EOB) {
-                if (fillBuffer() == -1) {
-                    return;
-                }
-            }
-        } while (_BC != '"');
-        state.incPtr();
+void Lexer::skipWhiteSpaceAndComments() {
+    while (true) {
+        state.bufp = findNonWhiteSpace(buf, state.bufp);
+        if (_BC != '"') {
+            break;
+        }
+        // Comments can be long, memchr scans them with the widest vector instructions available (AVX2 on most machines)
+        // An unterminated comment extends to the end of the file
+        //
+        const char* end = reinterpret_cast<const char*>(memchr(buf.data() + state.bufp + 1, '"', buf.length() - state.bufp - 1));
+        if (end == nullptr) {
+            state.bufp = buf.length();
+            break;
+        }
+        state.bufp = static_cast<size_t>(end - buf.data()) + 1;
     }
+    state.startBufp = state.bufp;
 }
 
 #define _ISOP(C)                                                            \
     ((C) == '~' || (C) == '&' || (C) == '|' || (C) == '*' || (C) == '/' ||  \
      (C) == '\\' || (C) == '+' || (C) == '=' || (C) == '>' || (C) == '<' || \
      (C) == ',' || (C) == '@' || (C) == '%' || (C) == '-')
-#define _MATCH(C, S)      \
-    if (_BC == (C)) {     \
-        state.sym = (S);  \
-        state.symc = _BC; \
-        state.text = _BC; \
-        state.incPtr();   \
+#define _MATCH(C, S)                             \
+    if (_BC == (C)) {                            \
+        state.sym = (S);                         \
+        state.symc = _BC;                        \
+        state.text = buf.substr(state.bufp, 1);  \
+        state.incPtr();                          \
 }
-#define SEPARATOR std::string("----")  // FIXME
-#define PRIMITIVE std::string("primitive")
+#define SEPARATOR std::string_view("----")  // FIXME
+#define PRIMITIVE std::string_view("primitive")
 
 void Lexer::lexNumber() {
     state.sym = Integer;
     state.symc = 0;
-    state.text.clear();
+    const size_t start = state.bufp;
 
     bool sawDecimalMark = false;
 
     do {
-        state.text += _BC;
         state.incPtr();
 
         if (!sawDecimalMark and '.' == _BC and state.bufp + 1 < buf.length() and
             isdigit(buf[state.bufp + 1]) != 0) {
             state.sym = Double;
             sawDecimalMark = true;
-            state.text += buf[state.bufp];
             state.incPtr();
         }
 
     } while (isdigit(_BC) != 0);
-}
-
-void Lexer::lexEscapeChar() {
-    assert(!EOB);
-    const char current = _BC;
-    switch (current) {
-    case 't':
-        state.text += '\t';
-        break;
-    case 'b':
-        state.text += '\b';
-        break;
-    case 'n':
-        state.text += '\n';
-        break;
-    case 'r':
-        state.text += '\r';
-        break;
-    case 'f':
-        state.text += '\f';
-        break;
-    case '0':
-        state.text += '\0';
-        break;
-    case '\'':
-        state.text += '\'';
-        break;
-    case '\\':
-        state.text += '\\';
-        break;
-    default:
-        assert(false);
-        break;
-    }
-    state.incPtr();
-}
 
-void Lexer::lexStringChar() {
-    if (_BC == '\\') {
-        state.incPtr();
-        lexEscapeChar();
-    } else {
-        state.text += buf[state.bufp];
-        state.incPtr();
-    }
+    state.text = buf.substr(start, state.bufp - start);
 }
 
 void Lexer::lexString() {
     state.sym = STString;
     state.symc = 0;
-    state.text.clear();
     state.incPtr();
+    const size_t start = state.bufp;
 
-    while (_BC != '\'') {
-        while (EOB) {
-            if (fillBuffer() == -1) {
-                return;
-            }
-            state.text += '\n';
+    // Most strings have no escape sequence, so their text is a view of the buffer
+    //
+    size_t pos = start;
+    while (pos < buf.length() && buf[pos] != '\'' && buf[pos] != '\\') {
+        pos++;
+    }
+    if (pos >= buf.length()) {
+        // Unterminated string
+        //
+        state.text = buf.substr(start);
+        state.bufp = buf.length();
+        state.startBufp = state.bufp;
+        return;
+    }
+    if (buf[pos] == '\'') {
+        state.text = buf.substr(start, pos - start);
+        state.incPtr(pos + 1 - state.bufp);
+        return;
+    }
+
+    // The string has escape sequences, the unescaped string is never longer than the source text
+    //
+    char* out = alloc.AllocateArray<char>(buf.length() - start);
+    size_t len = pos - start;
+    memcpy(out, buf.data() + start, len);
+    while (pos < buf.length() && buf[pos] != '\'') {
+        if (buf[pos] != '\\') {
+            out[len++] = buf[pos++];
+            continue;
         }
-        if (_BC != '\'') {
-            lexStringChar();
+        pos++;
+        assert(pos < buf.length());
+        if (pos >= buf.length()) {
+            break;
         }
+        switch (buf[pos]) {
+        case 't': out[len++] = '\t'; break;
+        case 'b': out[len++] = '\b'; break;
+        case 'n': out[len++] = '\n'; break;
+        case 'r': out[len++] = '\r'; break;
+        case 'f': out[len++] = '\f'; break;
+        case '0': out[len++] = '\0'; break;
+        case '\'': out[len++] = '\''; break;
+        case '\\': out[len++] = '\\'; break;
+        default: assert(false); break;
+        }
+        pos++;
     }
-    state.incPtr();
+    state.text = std::string_view(out, len);
+    if (pos >= buf.length()) {
+        // Unterminated string
+        //
+        state.bufp = buf.length();
+        state.startBufp = state.bufp;
+        return;
+    }
+    state.incPtr(pos + 1 - state.bufp);
 }
 
 void Lexer::lexOperator() {
-    if (_ISOP(buf[state.bufp + 1])) {
+    if (_ISOP(_CHAR_AT(state.bufp + 1))) {
         state.sym = OperatorSequence;
         state.symc = 0;
-        state.text.clear();
+        const size_t start = state.bufp;
         while (_ISOP(_BC)) {
-            state.text += buf[state.bufp];
             state.incPtr();
         }
+        state.text = buf.substr(start, state.bufp - start);
     }
     // clang-format off
     else _MATCH('~', Not)  else _MATCH('&', And)   else _MATCH('|', Or)
@@ -205,18 +212,14 @@ Symbol Lexer::GetSym() {
         return state.sym;
     }
 
-    do {
-        if (!hasMoreInput()) {
-            state.sym = NONE;
-            state.symc = 0;
-            state.text = "";
-            return state.sym;
-        }
-        skipWhiteSpace();
-        skipComment();
-    } while ((EOB || isspace(_BC) != 0 || _BC == '"'));
+    skipWhiteSpaceAndComments();
 
-    state.startBufp = state.bufp;
+    if (EOB) {
+        state.sym = NONE;
+        state.symc = 0;
+        state.text = std::string_view();
+        return state.sym;
+    }
 
     if (_BC == '\'') {
         lexString();
@@ -226,16 +229,16 @@ Symbol Lexer::GetSym() {
     else _MATCH(']', EndBlock)
     // clang-format on
     else if (_BC == ':') {
-        if (buf[state.bufp + 1] == '=') {
+        if (_CHAR_AT(state.bufp + 1) == '=') {
+            state.text = buf.substr(state.bufp, 2);
             state.incPtr(2);
             state.sym = Assign;
             state.symc = 0;
-            state.text = ":=";
         } else {
+            state.text = buf.substr(state.bufp, 1);
             state.incPtr();
             state.sym = Colon;
             state.symc = ':';
-            state.text = ":";
         }
     }
     // clang-format off
@@ -245,11 +248,11 @@ Symbol Lexer::GetSym() {
     // clang-format on
     else if (_BC == '-') {
         if (buf.substr(state.bufp, SEPARATOR.length()) == SEPARATOR) {
-            state.text.clear();
+            const size_t start = state.bufp;
             while (_BC == '-') {
-                state.text += buf[state.bufp];
                 state.incPtr();
             }
+            state.text = buf.substr(start, state.bufp - start);
             state.sym = Separator;
         } else {
             lexOperator();
@@ -259,31 +262,29 @@ Symbol Lexer::GetSym() {
         lexOperator();
     }
     else if (nextWordInBufferIsPrimitive()) {
+        state.text = buf.substr(state.bufp, PRIMITIVE.length());
         state.incPtr(PRIMITIVE.length());
         state.sym = Primitive;
         state.symc = 0;
-        state.text = "primitive";
     }
     else if (isalpha(_BC) != 0) {
-        state.text.clear();
+        const size_t start = state.bufp;
         state.symc = 0;
         while (isalpha(_BC) != 0 || isdigit(_BC) != 0 || _BC == '_') {
-            state.text += buf[state.bufp];
             state.incPtr();
         }
         state.sym = Identifier;
-        if (buf[state.bufp] == ':') {
+        if (_BC == ':') {
             state.sym = Keyword;
             state.incPtr();
-            state.text += ':';
             if (isalpha(_BC) != 0) {
                 state.sym = KeywordSequence;
                 while (isalpha(_BC) != 0 || _BC == ':') {
-                    state.text += buf[state.bufp];
                     state.incPtr();
                 }
             }
         }
+        state.text = buf.substr(start, state.bufp - start);
     }
     else if (isdigit(_BC) != 0) {
         lexNumber();
@@ -291,21 +292,12 @@ Symbol Lexer::GetSym() {
     else {
         state.sym = NONE;
         state.symc = _BC;
-        state.text = _BC;
+        state.text = buf.substr(state.bufp, 1);
     }
 
     return state.sym;
 }
 
-bool Lexer::hasMoreInput() {
-    while (EOB) {
-        if (fillBuffer() == -1) {
-            return false;
-        }
-    }
-    return true;
-}
-
 bool Lexer::nextWordInBufferIsPrimitive() {
     if (PRIMITIVE != buf.substr(state.bufp, PRIMITIVE.length())) {
         return false;
@@ -316,6 +308,23 @@ bool Lexer::nextWordInBufferIsPrimitive() {
     return isalnum(buf[state.bufp + PRIMITIVE.length()]) == 0;
 }
 
+size_t Lexer::GetCurrentLineNumber() const {
+    size_t end = std::min(state.bufp, buf.length());
+    return 1 + static_cast<size_t>(std::count(buf.data(), buf.data() + end, '\n'));
+}
+
+size_t Lexer::GetCurrentColumn() const {
+    size_t end = std::min(state.startBufp, buf.length());
+    size_t lineStart = 0;
+    if (end > 0) {
+        size_t nl = buf.rfind('\n', end - 1);
+        if (nl != std::string_view::npos) {
+            lineStart = nl + 1;
+        }
+    }
+    return end - lineStart + 1 - state.text.length();
+}
+
 Symbol Lexer::Peek() {
     const LexerState old = state;
 
@@ -26,9 +26,10 @@
  THE SOFTWARE.
 */
 
-#include <istream>
 #include <string>
+#include <string_view>
 #include "common.h"
+#include "temp_arena_allocator.h"
 
 class SourceCoordinate {
 public:
@@ -107,44 +108,43 @@ public:
         return cur;
     }
 
-    size_t lineNumber{0};
     size_t bufp{0};
 
     Symbol sym{Symbol::NONE};
     char symc{0};
-    std::string text;
+    // Points into the source buffer, or into the arena if the token is a string literal with escape sequences
+    //
+    std::string_view text;
 
     size_t startBufp{0};
 };
 
+// The lexer works on the whole content of a source file (usually memory-mapped, see SOMFileContent),
+// and the token texts are views into it, so the content must outlive the lexer and all token texts.
+//
 class Lexer {
 public:
-    explicit Lexer(std::istream& file);
-    explicit Lexer(const std::string& stream);
+    Lexer(std::string_view content, TempArenaAllocator& alloc);
 
     Symbol GetSym();
     Symbol Peek();
 
-    [[nodiscard]] std::string GetText() const { return state.text; }
+    [[nodiscard]] std::string_view GetText() const { return state.text; }
 
-    [[nodiscard]] std::string GetNextText() const {
+    [[nodiscard]] std::string_view GetNextText() const {
         return stateAfterPeek.text;
     }
 
-    [[nodiscard]] std::string GetRawBuffer() const {
+    [[nodiscard]] std::string_view GetRawBuffer() const {
         // for debug
-        return {buf};
+        return buf;
     }
 
-    std::string GetCurrentLine();
+    // The line number and column are only needed for error messages, so they are computed on demand
+    //
+    [[nodiscard]] size_t GetCurrentColumn() const;
 
-    [[nodiscard]] size_t GetCurrentColumn() const {
-        return state.startBufp + 1 - state.text.length();
-    }
-
-    [[nodiscard]] size_t GetCurrentLineNumber() const {
-        return state.lineNumber;
-    }
+    [[nodiscard]] size_t GetCurrentLineNumber() const;
 
     [[nodiscard]] bool GetPeekDone() const { return peekDone; }
 
@@ -153,26 +153,19 @@ public:
     }
 
 private:
-    int64_t fillBuffer();
-    void skipWhiteSpace();
-    void skipComment();
-
-    bool hasMoreInput();
+    void skipWhiteSpaceAndComments();
 
     void lexNumber();
     void lexOperator();
-    void lexEscapeChar();
-    void lexStringChar();
     void lexString();
 
     bool nextWordInBufferIsPrimitive();
 
-    std::istream& infile;
+    std::string_view buf;
+    TempArenaAllocator& alloc;
 
     bool peekDone;
 
     LexerState state;
     LexerState stateAfterPeek;
-
-    std::string buf;
 };
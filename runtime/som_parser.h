@@ -7,18 +7,27 @@
 #include "som_lexer.h"
 #include "som_ast.h"
 #include "string_interner.h"
-#include "som_compile_file.h"
+
+// Thrown instead of terminating the process if SOMParser::m_throwOnError is set
+//
+struct SOMParseError
+{
+    std::string m_message;
+};
 
 struct SOMParser
 {
     SOMParser(TempArenaAllocator& alloc,
               StringInterner* interner,
               const std::string& fileName,
-              std::istream& fileStream)
+              std::string_view content)
         : m_alloc(alloc)
         , m_symbolInterner(interner)
         , m_fileName(fileName)
-        , m_lexer(fileStream)
+        , m_lexer(content, alloc)
+        , m_referencedClassNames(nullptr)
+        , m_internedOrdSlots(nullptr)
+        , m_throwOnError(false)
     {
         Eat();
     }
@@ -41,7 +50,7 @@ struct SOMParser
 
         std::string found;
         if (m_curSym == Integer || m_curSym >= STString) {
-            found = symnames[m_curSym] + std::string(" (") + m_curText + ")";
+            found = symnames[m_curSym] + std::string(" (") + std::string(m_curText) + ")";
         } else {
             found = symnames[m_curSym];
         }
@@ -63,6 +72,10 @@ struct SOMParser
         ReplacePattern(msgWithMeta, "%(expected)s", expected);
         ReplacePattern(msgWithMeta, "%(found)s", found);
 
+        if (m_throwOnError)
+        {
+            throw SOMParseError { .m_message = msgWithMeta };
+        }
         fprintf(stderr, "%s\n", msgWithMeta.c_str());
         abort();
     }
@@ -73,6 +86,18 @@ struct SOMParser
         ParseError(msg, expectedStr);
     }
 
+    // Intern 'str' and store the ordinal to 'ord'
+    // The address of 'ord' is recorded if m_internedOrdSlots is set, see SOMPreparseClasses
+    //
+    void InternStringInto(size_t& ord /*out*/, std::string_view str)
+    {
+        ord = m_symbolInterner->InternString(str);
+        if (m_internedOrdSlots != nullptr)
+        {
+            m_internedOrdSlots->push_back(&ord);
+        }
+    }
+
     // Proceed to next symbol
     //
     void Eat()
@@ -174,27 +199,24 @@ struct SOMParser
             i = -i;
         }
 
-        if (!(std::numeric_limits<int32_t>::min() <= i && i <= std::numeric_limits<int32_t>::max()))
-        {
-            fprintf(stderr, "WARNING: integer literal in source code that does not fit int32_t, truncated from %lld to %d.\n",
-                    static_cast<long long>(i), static_cast<int>(static_cast<int32_t>(i)));
-        }
-
-        return m_alloc.AllocateObject<AstInteger>(static_cast<int32_t>(i));
+        return m_alloc.AllocateObject<AstInteger>(i);
     }
 
     AstInteger* WARN_UNUSED ParseInteger(bool shouldNegate)
     {
-        AstInteger* res = ParseInteger(m_curText, 10 /*base*/, shouldNegate);
+        AstInteger* res = ParseInteger(std::string(m_curText), 10 /*base*/, shouldNegate);
         Expect(Integer);
         return res;
     }
 
     AstDouble* WARN_UNUSED ParseDouble(bool shouldNegate)
     {
+        // The token text is a view of the source, which is not NUL-terminated after the token
+        //
+        std::string str(m_curText);
         char* pEnd = nullptr;
-        double d = std::strtod(m_curText.c_str(), &pEnd);
-        ReleaseAssert(pEnd == m_curText.data() + m_curText.length());
+        double d = std::strtod(str.c_str(), &pEnd);
+        ReleaseAssert(pEnd == str.data() + str.length());
         if (shouldNegate) { d = 0 - d; }
         Expect(Double);
         return m_alloc.AllocateObject<AstDouble>(d);
@@ -228,7 +250,7 @@ struct SOMParser
     AstString* WARN_UNUSED ParseString()
     {
         AstString* res = m_alloc.AllocateObject<AstString>();
-        res->m_globalOrd = m_symbolInterner->InternString(m_curText);
+        InternStringInto(res->m_globalOrd, m_curText);
         Expect(STString);
         return res;
     }
@@ -236,7 +258,7 @@ struct SOMParser
     AstSymbol* WARN_UNUSED ParseUnarySelector()
     {
         AstSymbol* res = m_alloc.AllocateObject<AstSymbol>();
-        res->m_globalOrd = m_symbolInterner->InternString(m_curText);
+        InternStringInto(res->m_globalOrd, m_curText);
         ExpectOneOf(identOrPrimitiveSyms);
         return res;
     }
@@ -244,7 +266,7 @@ struct SOMParser
     AstSymbol* WARN_UNUSED ParseBinarySelector()
     {
         AstSymbol* res = m_alloc.AllocateObject<AstSymbol>();
-        res->m_globalOrd = m_symbolInterner->InternString(m_curText);
+        InternStringInto(res->m_globalOrd, m_curText);
         if (AcceptOneOf(singleOpSyms) || Accept(OperatorSequence)) {
         } else {
             Expect(NONE);
@@ -255,7 +277,7 @@ struct SOMParser
     AstSymbol* WARN_UNUSED ParseKeywordSelector()
     {
         AstSymbol* res = m_alloc.AllocateObject<AstSymbol>();
-        res->m_globalOrd = m_symbolInterner->InternString(m_curText);
+        InternStringInto(res->m_globalOrd, m_curText);
         ExpectOneOf(keywordSelectorSyms);
         return res;
     }
@@ -279,7 +301,7 @@ struct SOMParser
         if (m_curSym == STString)
         {
             AstSymbol* res = m_alloc.AllocateObject<AstSymbol>();
-            res->m_globalOrd = m_symbolInterner->InternString(m_curText);
+            InternStringInto(res->m_globalOrd, m_curText);
             Expect(STString);
             return res;
         }
@@ -319,12 +341,17 @@ struct SOMParser
         return ParseNumber();
     }
 
-    std::string_view WARN_UNUSED ParseVariable()
+    std::string_view WARN_UNUSED CopyCurTextToArena()
     {
         char* s = m_alloc.AllocateArray<char>(m_curText.size() + 1);
         memcpy(s, m_curText.data(), m_curText.size());
         s[m_curText.size()] = '\0';
-        std::string_view res(s, m_curText.size());
+        return std::string_view(s, m_curText.size());
+    }
+
+    std::string_view WARN_UNUSED ParseVariable()
+    {
+        std::string_view res = CopyCurTextToArena();
         ExpectOneOf(identOrPrimitiveSyms);
         return res;
     }
@@ -335,6 +362,10 @@ struct SOMParser
         {
             AstVariableUse* res = m_alloc.AllocateObject<AstVariableUse>();
             res->m_varInfo.m_name = ParseVariable();
+            if (m_referencedClassNames != nullptr && res->m_varInfo.m_name.length() > 0 && isupper(static_cast<unsigned char>(res->m_varInfo.m_name[0])))
+            {
+                m_referencedClassNames->push_back(res->m_varInfo.m_name);
+            }
             return res;
         }
         if (m_curSym == NewTerm)
@@ -515,7 +546,7 @@ struct SOMParser
 
     std::string WARN_UNUSED ParseKeyword()
     {
-        std::string s = m_curText;
+        std::string s(m_curText);
         Expect(Keyword);
         return s;
     }
@@ -542,7 +573,7 @@ struct SOMParser
             res->m_arguments.push_back(ParseKeywordMessageOperand());
         }
         AstSymbol* selector = m_alloc.AllocateObject<AstSymbol>();
-        selector->m_globalOrd = m_symbolInterner->InternString(kw);
+        InternStringInto(selector->m_globalOrd, kw);
         res->m_selector = selector;
         return res;
     }
@@ -586,7 +617,7 @@ struct SOMParser
             meth->m_params.push_back(ParseVariable());
         } while (m_curSym == Keyword);
         AstSymbol* selector = m_alloc.AllocateObject<AstSymbol>();
-        selector->m_globalOrd = m_symbolInterner->InternString(kw);
+        InternStringInto(selector->m_globalOrd, kw);
         meth->m_selectorName = selector;
         meth->m_kind = AstMethodKind::Keyword;
     }
@@ -639,9 +670,10 @@ struct SOMParser
     AstClass* WARN_UNUSED ParseClass()
     {
         AstClass* res = m_alloc.AllocateObject<AstClass>(m_alloc);
+        m_referencedClassNames = &res->m_referencedClassNames;
         {
             AstSymbol* className = m_alloc.AllocateObject<AstSymbol>();
-            className->m_globalOrd = m_symbolInterner->InternString(m_curText);
+            InternStringInto(className->m_globalOrd, m_curText);
             res->m_name = className;
         }
         Expect(Identifier);
@@ -650,18 +682,13 @@ struct SOMParser
         {
             if (m_curText != "nil")
             {
-                res->m_superClass = SOMCompileFile(m_curText);
-            }
-            else
-            {
-                TestAssert(res->m_name->Get(m_symbolInterner) == "Object");
-                res->m_superClass = nullptr;
+                res->m_superClassName = CopyCurTextToArena();
             }
             Expect(Identifier);
         }
         else
         {
-            res->m_superClass = SOMCompileFile("Object");
+            res->m_superClassName = "Object";
         }
         Expect(NewTerm);
 
@@ -676,6 +703,7 @@ struct SOMParser
 
         Expect(EndTerm);
 
+        m_referencedClassNames = nullptr;
         return res;
     }
 
@@ -684,7 +712,16 @@ struct SOMParser
     std::string m_fileName;
     Lexer m_lexer;
     Symbol m_curSym;
-    std::string m_curText;
+    // Views into the source, see Lexer
+    //
+    std::string_view m_curText;
     Symbol m_nextSym;
     AstBlock* m_currentBlock;
+    TempVector<std::string_view>* m_referencedClassNames;
+    // If not nullptr, the address of every interned string ordinal stored in the AST is appended here
+    //
+    TempVector<size_t*>* m_internedOrdSlots;
+    // If true, a syntax error throws SOMParseError instead of terminating the process
+    //
+    bool m_throwOnError;
 };
@@ -5,6 +5,7 @@
 #include "som_class.h"
 
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(unimplemented_primitive);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(lazy_method_trampoline);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(integer_add);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(integer_minus);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(integer_star);
@@ -94,12 +95,19 @@ DEEGEN_FORWARD_DECLARE_LIB_FUNC(system_errorprintln);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(system_elapsed_milliseconds);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(system_elapsed_microseconds);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(system_fullgc);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(system_randomseed);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(system_loadfile);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_at);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_at_put);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_length);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_new);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_copy);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_copyfrom_to);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_replacefrom_to_with_startingat);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_atallput);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_fillrandom);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_indexof);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(array_contains);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_concatenate);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_assymbol);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_hashcode);
@@ -110,7 +118,45 @@ DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_charat);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_iswhitespace);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_isletters);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_isdigits);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_indexof_startingat);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_beginswith);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(string_endswith);
 DEEGEN_FORWARD_DECLARE_LIB_FUNC(symbol_asstring);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_new);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_newidentity);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_at);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_at_put);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_containskey);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_removekey);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_size);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_removeall);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_keys);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_values);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_keysdo);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_valuesdo);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(hashmap_keysandvaluesdo);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_new);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_at);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_at_put);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_append);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_removefirst);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_removelast);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_remove);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_removeall);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_first);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_last);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_size);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_isempty);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_capacity);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_asarray);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(vector_do);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(filereader_open);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(filereader_nextline);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(filereader_next);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(filereader_atend);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(filereader_position);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(filereader_size);
+DEEGEN_FORWARD_DECLARE_LIB_FUNC(filereader_close);
 
 SOMPrimitivesContainer::SOMPrimitivesContainer()
 {
@@ -220,6 +266,7 @@ SOMPrimitivesContainer::SOMPrimitivesContainer()
     Add("System", "time", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(system_elapsed_milliseconds));
     Add("System", "ticks", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(system_elapsed_microseconds));
     Add("System", "fullGC", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(system_fullgc));
+    Add("System", "randomSeed:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(system_randomseed));
     Add("System", "loadFile:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(system_loadfile));
 
     Add("Array", "new:", true, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_new));
@@ -227,6 +274,12 @@ SOMPrimitivesContainer::SOMPrimitivesContainer()
     Add("Array", "at:put:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_at_put));
     Add("Array", "length", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_length));
     Add("Array", "copy", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_copy));
+    Add("Array", "copyFrom:to:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_copyfrom_to));
+    Add("Array", "replaceFrom:to:with:startingAt:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_replacefrom_to_with_startingat));
+    Add("Array", "atAllPut:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_atallput));
+    Add("Array", "fillRandom:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_fillrandom));
+    Add("Array", "indexOf:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_indexof));
+    Add("Array", "contains:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(array_contains));
 
     Add("String", "concatenate:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(string_concatenate));
     Add("String", "asSymbol", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(string_assymbol));
@@ -238,8 +291,53 @@ SOMPrimitivesContainer::SOMPrimitivesContainer()
     Add("String", "isLetters", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(string_isletters));
     Add("String", "isDigits", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(string_isdigits));
     Add("String", "charAt:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(string_charat));
+    Add("String", "indexOf:startingAt:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(string_indexof_startingat));
+    Add("String", "beginsWith:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(string_beginswith));
+    Add("String", "endsWith:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(string_endswith));
 
     Add("Symbol", "asString", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(symbol_asstring));
+
+    Add("HashMap", "new", true, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_new));
+    Add("HashMap", "newIdentity", true, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_newidentity));
+    Add("HashMap", "at:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_at));
+    Add("HashMap", "at:put:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_at_put));
+    Add("HashMap", "containsKey:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_containskey));
+    Add("HashMap", "removeKey:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_removekey));
+    Add("HashMap", "size", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_size));
+    Add("HashMap", "removeAll", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_removeall));
+    Add("HashMap", "keys", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_keys));
+    Add("HashMap", "values", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_values));
+    Add("HashMap", "keysDo:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_keysdo));
+    Add("HashMap", "valuesDo:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_valuesdo));
+    Add("HashMap", "keysAndValuesDo:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(hashmap_keysandvaluesdo));
+
+    // Only the prim* selectors of the element access and removal methods are primitives,
+    // so Smalltalk/Vector.som keeps its bounds-checked, error-reporting versions of at:, at:put:, remove and removeFirst
+    //
+    Add("Vector", "new:", true, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_new));
+    Add("Vector", "primAt:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_at));
+    Add("Vector", "primAt:put:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_at_put));
+    Add("Vector", "append:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_append));
+    Add("Vector", "primRemoveFirst", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_removefirst));
+    Add("Vector", "primRemoveLast", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_removelast));
+    Add("Vector", "remove:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_remove));
+    Add("Vector", "removeAll", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_removeall));
+    Add("Vector", "first", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_first));
+    Add("Vector", "last", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_last));
+    Add("Vector", "size", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_size));
+    Add("Vector", "isEmpty", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_isempty));
+    Add("Vector", "capacity", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_capacity));
+    Add("Vector", "asArray", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_asarray));
+    Add("Vector", "do:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_do));
+    Add("Vector", "forEach:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(vector_do));
+
+    Add("FileReader", "open:", true, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(filereader_open));
+    Add("FileReader", "nextLine", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(filereader_nextline));
+    Add("FileReader", "next:", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(filereader_next));
+    Add("FileReader", "atEnd", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(filereader_atend));
+    Add("FileReader", "position", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(filereader_position));
+    Add("FileReader", "size", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(filereader_size));
+    Add("FileReader", "close", false, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(filereader_close));
 }
 
 void SOMPrimitivesContainer::Add(std::string_view className, std::string_view methName, bool isClassSide, void* func)
@@ -261,6 +359,19 @@ HeapPtr<FunctionObject> WARN_UNUSED GetUnimplementedPrimitive(std::string_view c
     return fn;
 }
 
+HeapPtr<FunctionObject> WARN_UNUSED SOMPrimitivesContainer::CreateLazyMethodStub(void* lazyMethodInfo)
+{
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    if (m_lazyMethodTrampoline.m_value == 0)
+    {
+        m_lazyMethodTrampoline = ExecutableCode::CreateCFunction(vm, DEEGEN_CODE_POINTER_FOR_LIB_FUNC(lazy_method_trampoline));
+    }
+    HeapPtr<FunctionObject> fn = FunctionObject::CreateCFunc(vm, m_lazyMethodTrampoline, 1 /*numUpvalues*/).As();
+    fn->m_invalidArrayType = static_cast<uint8_t>(static_cast<uint8_t>(SOM_Method) + static_cast<uint8_t>(SOM_LazyMethod) * 16);
+    fn->m_upvalues[0].m_value = reinterpret_cast<uint64_t>(lazyMethodInfo);
+    return fn;
+}
+
 void SOMPrimitivesContainer::Element::InitFnObj()
 {
     TestAssert(m_implPtr != nullptr && m_fnObj == nullptr);
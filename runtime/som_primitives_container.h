@@ -5,6 +5,7 @@
 #include "memory_ptr.h"
 
 class FunctionObject;
+class ExecutableCode;
 
 struct SOMPrimitivesContainer
 {
@@ -14,6 +15,11 @@ struct SOMPrimitivesContainer
 
     void Add(std::string_view className, std::string_view methName, bool isClassSide, void* func);
 
+    // Create the stub FunctionObject of a method that is compiled lazily (see SOMCompileLazyMethod)
+    // The stub has one upvalue holding 'lazyMethodInfo', and calling the stub compiles the method and calls it
+    //
+    HeapPtr<FunctionObject> WARN_UNUSED CreateLazyMethodStub(void* lazyMethodInfo);
+
     struct Element
     {
         Element() : m_implPtr(nullptr), m_fnObj(nullptr) { }
@@ -64,4 +70,8 @@ struct SOMPrimitivesContainer
     }
 
     std::unordered_map<std::string_view, std::unordered_map<std::string_view, Element>> m_map[2];
+
+    // Shared by all lazy method stubs
+    //
+    SystemHeapPointer<ExecutableCode> m_lazyMethodTrampoline;
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "common_utils.h"
+#include <bit>
+
+// The per-VM pseudo-random number generator backing 'Integer>>atRandom', 'Array>>fillRandom:' and 'System>>randomSeed:'
+//
+// This is xoshiro256** (Blackman and Vigna), seeded by expanding a 64-bit seed with splitmix64.
+// The VM is seeded with a fixed default seed on startup, so runs are reproducible unless the program reseeds it.
+//
+struct SOMRandomGenerator
+{
+    static constexpr uint64_t x_defaultSeed = 0x5eed5eed5eed5eedULL;
+
+    void Seed(uint64_t seed)
+    {
+        for (size_t i = 0; i < 4; i++)
+        {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            m_state[i] = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t WARN_UNUSED ALWAYS_INLINE Next()
+    {
+        uint64_t result = std::rotl(m_state[1] * 5, 7) * 9;
+        uint64_t t = m_state[1] << 17;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = std::rotl(m_state[3], 45);
+        return result;
+    }
+
+    // Return a uniformly distributed value in [0, n), n must be non-zero
+    //
+    // Uses Lemire's multiply-shift method: the high half of 'Next() * n' is almost uniform,
+    // and rejecting the few low halves below (2^64 mod n) removes the bias.
+    //
+    uint64_t WARN_UNUSED ALWAYS_INLINE NextBelow(uint64_t n)
+    {
+        TestAssert(n > 0);
+        __uint128_t m = static_cast<__uint128_t>(Next()) * n;
+        uint64_t low = static_cast<uint64_t>(m);
+        if (unlikely(low < n))
+        {
+            uint64_t threshold = (0 - n) % n;
+            while (low < threshold)
+            {
+                m = static_cast<__uint128_t>(Next()) * n;
+                low = static_cast<uint64_t>(m);
+            }
+        }
+        return static_cast<uint64_t>(m >> 64);
+    }
+
+    uint64_t m_state[4];
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "common_utils.h"
+#include "heap_ptr_utils.h"
+
+// SSE4 kernels for the SOM string primitives
+//
+// All functions only read bytes inside [ptr, ptr + len), so they are safe to use on any buffer.
+// Inputs shorter than 16 bytes are handled with overlapping scalar loads instead of byte loops.
+//
+
+// SOM++'s string hash (djb2), truncated to 32 bits
+//
+inline uint32_t WARN_UNUSED ComputeSOMStringHashCode(const char* ptr, size_t len)
+{
+    uint32_t hash = 5381U;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = ((hash << 5U) + hash) + static_cast<uint32_t>(static_cast<int32_t>(ptr[i]));
+    }
+    return hash;
+}
+
+inline bool WARN_UNUSED SOMStringContentEqual(const char* lhs, const char* rhs, size_t len)
+{
+    if (len >= 16)
+    {
+        size_t i = 0;
+        while (i + 16 <= len)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xffff)
+            {
+                return false;
+            }
+            i += 16;
+        }
+        if (i < len)
+        {
+            // Check the remaining tail with one overlapping load
+            //
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + len - 16));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + len - 16));
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xffff;
+        }
+        return true;
+    }
+    if (len >= 8)
+    {
+        return UnalignedLoad<uint64_t>(lhs) == UnalignedLoad<uint64_t>(rhs) &&
+            UnalignedLoad<uint64_t>(lhs + len - 8) == UnalignedLoad<uint64_t>(rhs + len - 8);
+    }
+    if (len >= 4)
+    {
+        return UnalignedLoad<uint32_t>(lhs) == UnalignedLoad<uint32_t>(rhs) &&
+            UnalignedLoad<uint32_t>(lhs + len - 4) == UnalignedLoad<uint32_t>(rhs + len - 4);
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        if (lhs[i] != rhs[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace internal
+{
+
+// Return a 16-bit mask where bit i is set iff byte i of 'v' is in range [lo, hi] (unsigned comparison)
+//
+inline uint32_t ALWAYS_INLINE GetSSEByteInRangeMask(__m128i v, uint8_t lo, uint8_t hi)
+{
+    __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8(static_cast<char>(lo)));
+    __m128i bound = _mm_set1_epi8(static_cast<char>(hi - lo));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(shifted, bound), shifted)));
+}
+
+// Return true if every byte in [ptr, ptr + len) satisfies 'vecPred' (which takes a __m128i and returns the 16-bit match mask)
+// 'scalarPred' is used for inputs shorter than 16 bytes
+//
+template<typename VecPred, typename ScalarPred>
+bool WARN_UNUSED ALWAYS_INLINE SOMStringAllBytesSatisfy(const char* ptr, size_t len, const VecPred& vecPred, const ScalarPred& scalarPred)
+{
+    if (len < 16)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            if (!scalarPred(static_cast<uint8_t>(ptr[i])))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    size_t i = 0;
+    while (i + 16 <= len)
+    {
+        if (vecPred(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i))) != 0xffff)
+        {
+            return false;
+        }
+        i += 16;
+    }
+    if (i < len)
+    {
+        return vecPred(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + len - 16))) == 0xffff;
+    }
+    return true;
+}
+
+}   // namespace internal
+
+// Same as checking isspace() in the C locale for every byte: ' ', '\t', '\n', '\v', '\f', '\r'
+//
+inline bool WARN_UNUSED SOMStringIsAllWhitespace(const char* ptr, size_t len)
+{
+    return internal::SOMStringAllBytesSatisfy(
+        ptr, len,
+        [](__m128i v) ALWAYS_INLINE -> uint32_t
+        {
+            uint32_t isSpace = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' '))));
+            return isSpace | internal::GetSSEByteInRangeMask(v, '\t', '\r');
+        },
+        [](uint8_t c) ALWAYS_INLINE -> bool
+        {
+            return c == ' ' || (c >= '\t' && c <= '\r');
+        });
+}
+
+// Same as checking isalpha() in the C locale for every byte
+//
+inline bool WARN_UNUSED SOMStringIsAllLetters(const char* ptr, size_t len)
+{
+    return internal::SOMStringAllBytesSatisfy(
+        ptr, len,
+        [](__m128i v) ALWAYS_INLINE -> uint32_t
+        {
+            // Setting bit 5 maps 'A'-'Z' to 'a'-'z', and does not map any non-letter into 'a'-'z'
+            //
+            return internal::GetSSEByteInRangeMask(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+        },
+        [](uint8_t c) ALWAYS_INLINE -> bool
+        {
+            c |= 0x20;
+            return c >= 'a' && c <= 'z';
+        });
+}
+
+// Same as checking isdigit() for every byte
+//
+inline bool WARN_UNUSED SOMStringIsAllDigits(const char* ptr, size_t len)
+{
+    return internal::SOMStringAllBytesSatisfy(
+        ptr, len,
+        [](__m128i v) ALWAYS_INLINE -> uint32_t
+        {
+            return internal::GetSSEByteInRangeMask(v, '0', '9');
+        },
+        [](uint8_t c) ALWAYS_INLINE -> bool
+        {
+            return c >= '0' && c <= '9';
+        });
+}
+
+// Return the smallest offset i >= 'start' such that [i, i + needleLen) of haystack equals the needle, or -1 if not found
+//
+// Uses the "first and last byte" filter: compare 16 candidate positions at a time against the first and last byte of
+// the needle, and only run the full comparison for positions where both match.
+//
+inline ssize_t WARN_UNUSED SOMStringFindSubstring(const char* haystack, size_t haystackLen, const char* needle, size_t needleLen, size_t start)
+{
+    if (start > haystackLen || needleLen > haystackLen - start)
+    {
+        return -1;
+    }
+    if (needleLen == 0)
+    {
+        return static_cast<ssize_t>(start);
+    }
+
+    // The last valid candidate position
+    //
+    size_t lastPos = haystackLen - needleLen;
+    size_t i = start;
+    if (lastPos - start + 1 >= 16)
+    {
+        __m128i firstByte = _mm_set1_epi8(needle[0]);
+        __m128i lastByte = _mm_set1_epi8(needle[needleLen - 1]);
+        while (i + 15 <= lastPos)
+        {
+            __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i));
+            __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i + needleLen - 1));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, firstByte), _mm_cmpeq_epi8(blockLast, lastByte))));
+            while (mask != 0)
+            {
+                size_t pos = i + static_cast<size_t>(__builtin_ctz(mask));
+                if (SOMStringContentEqual(haystack + pos, needle, needleLen))
+                {
+                    return static_cast<ssize_t>(pos);
+                }
+                mask &= mask - 1;
+            }
+            i += 16;
+        }
+    }
+    while (i <= lastPos)
+    {
+        if (haystack[i] == needle[0] && SOMStringContentEqual(haystack + i, needle, needleLen))
+        {
+            return static_cast<ssize_t>(i);
+        }
+        i++;
+    }
+    return -1;
+}
@@ -4,6 +4,8 @@
 #include "som_class.h"
 #include "vm.h"
 #include "runtime_utils.h"
+#include "som_string_utils.h"
+#include "som_large_integer.h"
 
 // Slow path that returns the SOM class for any value, including unboxed values and non-SOMObject values
 //
@@ -72,6 +74,126 @@ inline HeapPtr<SOMClass> WARN_UNUSED GetSOMClassOfAny(TValue tv)
     __builtin_unreachable();
 }
 
+// Return the hash code of a SOM string. The hash code is computed on first use and cached in the string object.
+//
+inline uint32_t ALWAYS_INLINE GetHashCodeFromSOMString(TValue tv)
+{
+    TestAssert(tv.Is<tObject>() && tv.As<tObject>()->m_arrayType == SOM_String);
+    SOMObject* o = TranslateToRawPointer(tv.As<tObject>());
+    size_t len = o->m_data[0].m_value;
+    char* buf = reinterpret_cast<char*>(&o->m_data[1]);
+    uint32_t* slot = reinterpret_cast<uint32_t*>(buf + SOMObject::GetStringHashCodeSlotOffset(len));
+    if (likely((o->m_opaque & SOMObject::x_stringHashCodeCachedBit) != 0))
+    {
+        TestAssert(*slot == ComputeSOMStringHashCode(buf, len));
+        return *slot;
+    }
+    uint32_t hash = ComputeSOMStringHashCode(buf, len);
+    *slot = hash;
+    o->m_opaque |= SOMObject::x_stringHashCodeCachedBit;
+    return hash;
+}
+
+// How 'lhs = rhs' behaves for a receiver 'lhs'
+//
+enum class SOMEqualityKind : uint8_t
+{
+    // The class of 'lhs' does not override '=', so it is the same as '=='
+    //
+    Identity,
+    // Integer (including LargeInteger) or Double, compared numerically
+    //
+    Number,
+    // String or Symbol, compared by content
+    //
+    String,
+    // The class of 'lhs' overrides '=', so the result is only known by calling it
+    //
+    Custom
+};
+
+inline SOMEqualityKind WARN_UNUSED GetSOMEqualityKind(VM* vm, TValue lhs)
+{
+    if (lhs.Is<tNil>() || lhs.Is<tBool>())
+    {
+        return SOMEqualityKind::Identity;
+    }
+    if (lhs.Is<tInt32>() || lhs.Is<tDouble>())
+    {
+        return SOMEqualityKind::Number;
+    }
+    if (lhs.Is<tObject>() && lhs.As<tObject>()->m_arrayType == SOM_String)
+    {
+        return SOMEqualityKind::String;
+    }
+    if (IsSOMLargeInteger(lhs))
+    {
+        return SOMEqualityKind::Number;
+    }
+    HeapPtr<SOMClass> cl = GetSOMClassOfAny(lhs);
+    GeneralHeapPointer<FunctionObject> eqFn = SOMClass::GetMethod(cl, vm->m_strOperatorEqual);
+    if (eqFn.m_value == SOMClass::GetMethod(vm->m_objectClass, vm->m_strOperatorEqual).m_value)
+    {
+        return SOMEqualityKind::Identity;
+    }
+    return SOMEqualityKind::Custom;
+}
+
+// Evaluate 'lhs = rhs' natively, where 'lhsKind' is the equality kind of 'lhs' and is not Custom
+//
+inline bool WARN_UNUSED SOMValuesEqualNative(TValue lhs, SOMEqualityKind lhsKind, TValue rhs)
+{
+    TestAssert(lhsKind != SOMEqualityKind::Custom);
+    if (SOMValuesIdentical(lhs, rhs))
+    {
+        return true;
+    }
+    switch (lhsKind)
+    {
+    case SOMEqualityKind::Number:
+    {
+        int64_t li, ri;
+        bool lhsIsInt = TryGetSOMIntegerValue(lhs, &li /*out*/);
+        bool rhsIsInt = TryGetSOMIntegerValue(rhs, &ri /*out*/);
+        if (lhsIsInt && rhsIsInt)
+        {
+            return li == ri;
+        }
+        if (!rhsIsInt && !rhs.Is<tDouble>())
+        {
+            return false;
+        }
+        double l = lhsIsInt ? static_cast<double>(li) : lhs.As<tDouble>();
+        double r = rhsIsInt ? static_cast<double>(ri) : rhs.As<tDouble>();
+        return UnsafeFloatEqual(l, r);
+    }
+    case SOMEqualityKind::String:
+    {
+        if (!rhs.Is<tObject>() || rhs.As<tObject>()->m_arrayType != SOM_String)
+        {
+            return false;
+        }
+        VM* vm = VM_GetActiveVMForCurrentThread();
+        HeapPtr<SOMObject> l = lhs.As<tObject>();
+        HeapPtr<SOMObject> r = rhs.As<tObject>();
+        size_t len = l->m_data[0].m_value;
+        if (len != r->m_data[0].m_value)
+        {
+            return false;
+        }
+        return SOMStringContentEqual(TranslateToRawPointer(vm, reinterpret_cast<HeapPtr<char>>(&l->m_data[1])),
+                                     TranslateToRawPointer(vm, reinterpret_cast<HeapPtr<char>>(&r->m_data[1])),
+                                     len);
+    }
+    default:
+    {
+        // Identity-compared values are only equal if they are identical, which is checked above
+        //
+        return false;
+    }
+    }   /*switch*/
+}
+
 inline TValue NO_INLINE DeepCloneConstantArray(TValue tv)
 {
     TestAssert(tv.Is<tObject>());
@@ -0,0 +1,101 @@
+#include "som_vector.h"
+
+TValue* WARN_UNUSED SOMVector::AllocateBuffer(size_t capacity)
+{
+    VM* vm = VM_GetActiveVMForCurrentThread();
+    ReleaseAssert(capacity < (1ULL << 28));
+    uint32_t allocSize = static_cast<uint32_t>(capacity * sizeof(TValue));
+    return TranslateToRawPointer(vm, vm->AllocFromUserHeap(allocSize).AsNoAssert<TValue>());
+}
+
+SOMObject* WARN_UNUSED SOMVector::Allocate(SOMClass* cl, size_t capacity)
+{
+    if (cl->m_numFields != 0)
+    {
+        fprintf(stderr, "Vector and its subclasses must not declare fields.\n");
+        abort();
+    }
+    capacity = std::max(capacity, static_cast<size_t>(1));
+    TValue* buf = AllocateBuffer(capacity);
+    SOMObject* o = SOMObject::AllocateUninitialized(8 * x_numHeaderSlots);
+    SOMObject::Populate(o);
+    o->m_hiddenClass = SystemHeapPointer<SOMClass>(cl).m_value;
+    o->m_arrayType = SOM_Vector;
+    o->m_data[0].m_value = reinterpret_cast<uint64_t>(buf);
+    o->m_data[1].m_value = 0;
+    o->m_data[2].m_value = capacity;
+    o->m_data[3].m_value = reinterpret_cast<uint64_t>(buf);
+    o->m_data[4].m_value = 0;
+    return o;
+}
+
+void SOMVector::Reserve(HeapPtr<SOMObject> o, size_t minSize)
+{
+    if (minSize <= o->m_data[2].m_value)
+    {
+        return;
+    }
+    TValue* begin = GetBegin(o);
+    TValue* bufStart = reinterpret_cast<TValue*>(o->m_data[3].m_value);
+    size_t size = GetSize(o);
+    size_t capacity = GetCapacity(o);
+
+    // If at least half of the buffer is free, moving the elements to the start of the buffer is enough
+    //
+    if (minSize <= capacity && size * 2 <= capacity)
+    {
+        memmove(bufStart, begin, size * sizeof(TValue));
+        o->m_data[0].m_value = reinterpret_cast<uint64_t>(bufStart);
+        o->m_data[2].m_value = capacity;
+        return;
+    }
+
+    size_t newCapacity = std::max(std::max(capacity * 2, minSize), x_minCapacity);
+    TValue* newBuf = AllocateBuffer(newCapacity);
+    memcpy(newBuf, begin, size * sizeof(TValue));
+    o->m_data[0].m_value = reinterpret_cast<uint64_t>(newBuf);
+    o->m_data[2].m_value = newCapacity;
+    o->m_data[3].m_value = reinterpret_cast<uint64_t>(newBuf);
+}
+
+void SOMVector::SetAndGrow(HeapPtr<SOMObject> o, size_t idx, TValue value)
+{
+    TestAssert(idx >= 1);
+    size_t size = GetSize(o);
+    if (idx > size)
+    {
+        Reserve(o, idx);
+        TValue* begin = GetBegin(o);
+        for (size_t i = size; i < idx - 1; i++)
+        {
+            begin[i] = TValue::Create<tNil>();
+        }
+        o->m_data[1].m_value = idx;
+    }
+    GetBegin(o)[idx - 1] = value;
+}
+
+bool WARN_UNUSED SOMVector::RemoveIdentical(HeapPtr<SOMObject> o, TValue value)
+{
+    TValue* begin = GetBegin(o);
+    size_t size = GetSize(o);
+    size_t newSize = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (!SOMValuesIdentical(begin[i], value))
+        {
+            begin[newSize] = begin[i];
+            newSize++;
+        }
+    }
+    o->m_data[1].m_value = newSize;
+    return newSize != size;
+}
+
+SOMObject* WARN_UNUSED SOMVector::ToArray(HeapPtr<SOMObject> o)
+{
+    size_t size = GetSize(o);
+    SOMObject* arr = SOMObject::AllocateArray(size);
+    memcpy(&arr->m_data[1], GetBegin(o), size * sizeof(TValue));
+    return arr;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "common_utils.h"
+#include "som_class.h"
+#include "som_utils.h"
+
+// The native representation of 'Vector' instances (Smalltalk/Vector.som and AreWeFastYet/Core/Vector.som)
+//
+// A Vector is a SOMObject with m_arrayType == SOM_Vector. The elements live in a separately allocated buffer,
+// so the Vector object never moves when it grows:
+//     m_data[0]: raw pointer to the first element
+//     m_data[1]: the number of elements
+//     m_data[2]: the number of slots in the buffer starting from the first element
+//     m_data[3]: raw pointer to the start of the buffer
+//     m_data[4]: the number of elements ever removed from the front ('removeFirst' and 'removeAll'), so an element keeps
+//                the same logical position (m_data[4] + its index) until it is removed, which 'do:' relies on
+//
+// 'removeFirst' only advances the first-element pointer. When the slots after the last element run out, the elements are
+// moved back to the start of the buffer if at least half of it is free, otherwise they are copied to a buffer twice as large.
+// So both 'append:' and 'removeFirst' are amortized O(1).
+//
+// The interpreter and JIT fast paths of 'at:' and 'at:put:' (see MiscBinOpImpl and MiscTernaryOpImpl) handle in-range indices,
+// and otherwise call the 'at:' or 'at:put:' method of the class, so each Vector class defines its own out-of-range behavior.
+//
+class SOMVector
+{
+public:
+    static constexpr size_t x_numHeaderSlots = 5;
+    static constexpr size_t x_minCapacity = 4;
+
+    // Allocate an empty Vector object of class 'cl' that can hold 'capacity' elements without growing
+    //
+    static SOMObject* WARN_UNUSED Allocate(SOMClass* cl, size_t capacity);
+
+    static TValue* WARN_UNUSED ALWAYS_INLINE GetBegin(HeapPtr<SOMObject> o)
+    {
+        TestAssert(o->m_arrayType == SOM_Vector);
+        return reinterpret_cast<TValue*>(o->m_data[0].m_value);
+    }
+
+    static size_t WARN_UNUSED ALWAYS_INLINE GetSize(HeapPtr<SOMObject> o)
+    {
+        TestAssert(o->m_arrayType == SOM_Vector);
+        return o->m_data[1].m_value;
+    }
+
+    static uint64_t WARN_UNUSED ALWAYS_INLINE GetNumRemovedFromFront(HeapPtr<SOMObject> o)
+    {
+        TestAssert(o->m_arrayType == SOM_Vector);
+        return o->m_data[4].m_value;
+    }
+
+    // The number of elements the vector can hold without allocating a new buffer
+    //
+    static size_t WARN_UNUSED ALWAYS_INLINE GetCapacity(HeapPtr<SOMObject> o)
+    {
+        TestAssert(o->m_arrayType == SOM_Vector);
+        TValue* bufStart = reinterpret_cast<TValue*>(o->m_data[3].m_value);
+        return static_cast<size_t>(GetBegin(o) - bufStart) + o->m_data[2].m_value;
+    }
+
+    // Make room for at least 'minSize' elements starting from the first element
+    //
+    static void Reserve(HeapPtr<SOMObject> o, size_t minSize);
+
+    static void ALWAYS_INLINE Append(HeapPtr<SOMObject> o, TValue value)
+    {
+        size_t size = GetSize(o);
+        if (unlikely(size == o->m_data[2].m_value))
+        {
+            Reserve(o, size + 1);
+        }
+        GetBegin(o)[size] = value;
+        o->m_data[1].m_value = size + 1;
+    }
+
+    // Store 'value' at 1-based index 'idx'. If 'idx' is past the end, the vector grows to 'idx' elements and the gap is filled with nil.
+    //
+    static void SetAndGrow(HeapPtr<SOMObject> o, size_t idx, TValue value);
+
+    // Return nil if the vector is empty
+    //
+    static TValue WARN_UNUSED ALWAYS_INLINE RemoveFirst(HeapPtr<SOMObject> o)
+    {
+        size_t size = GetSize(o);
+        if (size == 0)
+        {
+            return TValue::Create<tNil>();
+        }
+        TValue* begin = GetBegin(o);
+        TValue result = begin[0];
+        o->m_data[0].m_value = reinterpret_cast<uint64_t>(begin + 1);
+        o->m_data[1].m_value = size - 1;
+        o->m_data[2].m_value--;
+        o->m_data[4].m_value++;
+        return result;
+    }
+
+    // Return nil if the vector is empty
+    //
+    static TValue WARN_UNUSED ALWAYS_INLINE RemoveLast(HeapPtr<SOMObject> o)
+    {
+        size_t size = GetSize(o);
+        if (size == 0)
+        {
+            return TValue::Create<tNil>();
+        }
+        o->m_data[1].m_value = size - 1;
+        return GetBegin(o)[size - 1];
+    }
+
+    // Remove all elements, keeping the buffer
+    //
+    static void ALWAYS_INLINE RemoveAll(HeapPtr<SOMObject> o)
+    {
+        size_t capacity = GetCapacity(o);
+        o->m_data[4].m_value += GetSize(o);
+        o->m_data[0].m_value = o->m_data[3].m_value;
+        o->m_data[1].m_value = 0;
+        o->m_data[2].m_value = capacity;
+    }
+
+    // Remove all elements identical to 'value', return true if any was found
+    //
+    static bool WARN_UNUSED RemoveIdentical(HeapPtr<SOMObject> o, TValue value);
+
+    static SOMObject* WARN_UNUSED ToArray(HeapPtr<SOMObject> o);
+
+private:
+    static TValue* WARN_UNUSED AllocateBuffer(size_t capacity);
+};
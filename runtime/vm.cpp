@@ -2,6 +2,101 @@
 #include "runtime_utils.h"
 #include "deegen_options.h"
 #include "som_class.h"
+#include "dfg_arena.h"
+
+#include <sys/resource.h>
+#include <condition_variable>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+// Populates the user heap pages ahead of the bump pointer on a background thread, see VM::SetUserHeapPrefaultDistance
+//
+class VMHeapPrefaulter
+{
+public:
+    VMHeapPrefaulter()
+        : m_shouldStop(false)
+    {
+        m_thread = std::thread([this]() { ThreadMain(); });
+    }
+
+    ~VMHeapPrefaulter()
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_shouldStop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+    // Return true if the kernel supports MADV_POPULATE_WRITE
+    //
+    static bool WARN_UNUSED IsSupported()
+    {
+        void* p = mmap(nullptr, VM::x_pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+        {
+            return false;
+        }
+        bool supported = (madvise(p, VM::x_pageSize, MADV_POPULATE_WRITE) == 0);
+        std::ignore = munmap(p, VM::x_pageSize);
+        return supported;
+    }
+
+    // Populate [lo, hi), which must be mapped
+    //
+    void Post(uintptr_t lo, uintptr_t hi)
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_ranges.push_back(std::make_pair(lo, hi));
+        }
+        m_cv.notify_one();
+    }
+
+private:
+    void ThreadMain()
+    {
+        while (true)
+        {
+            std::pair<uintptr_t, uintptr_t> range;
+            {
+                std::unique_lock<std::mutex> lk(m_lock);
+                m_cv.wait(lk, [this]() { return m_shouldStop || !m_ranges.empty(); });
+                if (m_shouldStop)
+                {
+                    return;
+                }
+                range = m_ranges.front();
+                m_ranges.pop_front();
+            }
+
+            // The user heap grows downwards, so populate from the high end, in steps so the pages needed first are ready first
+            //
+            constexpr size_t x_step = 256 * 1024;
+            uintptr_t hi = range.second;
+            while (hi > range.first)
+            {
+                uintptr_t lo = (hi - range.first > x_step) ? hi - x_step : range.first;
+                std::ignore = madvise(reinterpret_cast<void*>(lo), hi - lo, MADV_POPULATE_WRITE);
+                hi = lo;
+            }
+        }
+    }
+
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+    std::deque<std::pair<uintptr_t /*lo*/, uintptr_t /*hi*/>> m_ranges;
+    bool m_shouldStop;
+    std::thread m_thread;
+};
 
 VM* WARN_UNUSED VM::Create()
 {
@@ -113,6 +208,11 @@ bool WARN_UNUSED VM::InitializeVMBase()
 
     m_userHeapPtrLimit = -static_cast<int64_t>(x_vmBaseOffset - x_vmUserHeapSize);
     m_userHeapCurPtr = -static_cast<int64_t>(x_vmBaseOffset - x_vmUserHeapSize);
+    m_userHeapMappedLimit = -static_cast<int64_t>(x_vmBaseOffset - x_vmUserHeapSize);
+    m_userHeapPrefaultedLimit = -static_cast<int64_t>(x_vmBaseOffset - x_vmUserHeapSize);
+    m_userHeapPrefaultDistance = 0;
+    m_heapPrefaulter = nullptr;
+    m_heapBackingPolicy = HeapBackingPolicy::LazyHugePages;
 
     static_assert(sizeof(VM) >= x_minimum_valid_heap_address);
     m_systemHeapPtrLimit = static_cast<uint32_t>(RoundUpToMultipleOf<x_pageSize>(sizeof(VM)));
@@ -129,31 +229,102 @@ bool WARN_UNUSED VM::InitializeVMBase()
     }
 
     m_totalBaselineJitCompilations = 0;
+    m_totalBaselineJitCodeReclaimed = 0;
+    SetBaselineJitCodeMemoryLimit(x_default_baseline_jit_code_memory_limit);
 
     return true;
 }
 
+bool WARN_UNUSED VM::MapHeapMemory(uintptr_t addr, size_t length, bool isUserHeap)
+{
+    Assert(addr % x_pageSize == 0 && length % x_pageSize == 0);
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+    if (m_heapBackingPolicy == HeapBackingPolicy::Eager)
+    {
+        flags |= MAP_POPULATE;
+    }
+
+    if (isUserHeap && m_heapBackingPolicy == HeapBackingPolicy::HugeTLB)
+    {
+        void* r = mmap(reinterpret_cast<void*>(addr), length, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        if (r != MAP_FAILED)
+        {
+            Assert(r == reinterpret_cast<void*>(addr));
+            return true;
+        }
+        // The hugetlb pool is exhausted (or not configured), don't try again
+        //
+        m_heapBackingPolicy = HeapBackingPolicy::LazyHugePages;
+    }
+
+    void* r = mmap(reinterpret_cast<void*>(addr), length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (r == MAP_FAILED)
+    {
+        return false;
+    }
+    Assert(r == reinterpret_cast<void*>(addr));
+
+    if (isUserHeap && m_heapBackingPolicy == HeapBackingPolicy::LazyHugePages)
+    {
+        // Only a hint, the kernel may not have transparent huge pages enabled
+        //
+        std::ignore = madvise(r, length, MADV_HUGEPAGE);
+    }
+    return true;
+}
+
 void __attribute__((__preserve_most__)) VM::BumpUserHeap()
 {
     Assert(m_userHeapCurPtr < m_userHeapPtrLimit);
     VM_FAIL_IF(m_userHeapCurPtr < -static_cast<intptr_t>(x_vmBaseOffset),
                "Resource limit exceeded: user heap overflowed %dGB memory limit.", static_cast<int>(x_vmUserHeapSize >> 30));
 
-    constexpr size_t x_allocationSize = 65536;
-    // TODO: consider allocating smaller sizes on the first few allocations
+    // Under the lazy policies, mapping more than needed does not cost memory, so map in huge-page-sized chunks
     //
-    intptr_t newHeapLimit = m_userHeapCurPtr & (~static_cast<intptr_t>(x_allocationSize - 1));
-    Assert(newHeapLimit <= m_userHeapCurPtr && newHeapLimit % static_cast<int64_t>(x_pageSize) == 0 && newHeapLimit < m_userHeapPtrLimit);
-    size_t lengthToAllocate = static_cast<size_t>(m_userHeapPtrLimit - newHeapLimit);
-    Assert(lengthToAllocate % x_pageSize == 0);
+    size_t allocationSize = (m_heapBackingPolicy == HeapBackingPolicy::Eager) ? 65536 : (2ULL << 20);
 
-    uintptr_t allocAddr = VMBaseAddress() + static_cast<uint64_t>(newHeapLimit);
-    void* r = mmap(reinterpret_cast<void*>(allocAddr), lengthToAllocate, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_FIXED, -1, 0);
-    VM_FAIL_WITH_ERRNO_IF(r == MAP_FAILED,
-                          "Out of Memory: Allocation of length %llu failed", static_cast<unsigned long long>(lengthToAllocate));
-    Assert(r == reinterpret_cast<void*>(allocAddr));
+    // With populating ahead, the range up to m_userHeapPrefaultDistance below the bump pointer should be mapped
+    //
+    int64_t wantedLimit = m_userHeapCurPtr;
+    if (m_heapPrefaulter != nullptr)
+    {
+        wantedLimit = std::max(m_userHeapCurPtr - static_cast<int64_t>(m_userHeapPrefaultDistance), -static_cast<int64_t>(x_vmBaseOffset));
+    }
+
+    if (wantedLimit < m_userHeapMappedLimit)
+    {
+        int64_t newHeapLimit = wantedLimit & (~static_cast<int64_t>(allocationSize - 1));
+        Assert(newHeapLimit <= wantedLimit && newHeapLimit % static_cast<int64_t>(x_pageSize) == 0 && newHeapLimit < m_userHeapMappedLimit);
+        Assert(newHeapLimit >= -static_cast<int64_t>(x_vmBaseOffset));
+        size_t lengthToAllocate = static_cast<size_t>(m_userHeapMappedLimit - newHeapLimit);
+        Assert(lengthToAllocate % x_pageSize == 0);
+
+        uintptr_t allocAddr = VMBaseAddress() + static_cast<uint64_t>(newHeapLimit);
+        VM_FAIL_WITH_ERRNO_IF(!MapHeapMemory(allocAddr, lengthToAllocate, true /*isUserHeap*/),
+                              "Out of Memory: Allocation of length %llu failed", static_cast<unsigned long long>(lengthToAllocate));
+
+        m_userHeapMappedLimit = newHeapLimit;
+    }
+    Assert(m_userHeapMappedLimit <= m_userHeapCurPtr);
+
+    if (m_heapPrefaulter != nullptr)
+    {
+        // Hand the part that is newly within the distance to the prefaulter, and come back once half of the distance is used up
+        //
+        int64_t prefaultLimit = std::max(wantedLimit & (~static_cast<int64_t>(x_pageSize - 1)), m_userHeapMappedLimit);
+        if (prefaultLimit < m_userHeapPrefaultedLimit)
+        {
+            m_heapPrefaulter->Post(VMBaseAddress() + static_cast<uint64_t>(prefaultLimit), VMBaseAddress() + static_cast<uint64_t>(m_userHeapPrefaultedLimit));
+            m_userHeapPrefaultedLimit = prefaultLimit;
+        }
+        int64_t trigger = (m_userHeapCurPtr - static_cast<int64_t>(m_userHeapPrefaultDistance / 2)) & (~static_cast<int64_t>(x_pageSize - 1));
+        m_userHeapPtrLimit = std::max(trigger, m_userHeapMappedLimit);
+    }
+    else
+    {
+        m_userHeapPtrLimit = m_userHeapMappedLimit;
+    }
 
-    m_userHeapPtrLimit = newHeapLimit;
     Assert(m_userHeapPtrLimit <= m_userHeapCurPtr);
     Assert(m_userHeapPtrLimit >= -static_cast<intptr_t>(x_vmBaseOffset));
 }
@@ -175,10 +346,8 @@ void VM::BumpSystemHeap()
     Assert(lengthToAllocate % x_pageSize == 0);
 
     uintptr_t allocAddr = VMBaseAddress() + static_cast<uint64_t>(m_systemHeapPtrLimit);
-    void* r = mmap(reinterpret_cast<void*>(allocAddr), lengthToAllocate, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_FIXED, -1, 0);
-    VM_FAIL_WITH_ERRNO_IF(r == MAP_FAILED,
+    VM_FAIL_WITH_ERRNO_IF(!MapHeapMemory(allocAddr, lengthToAllocate, false /*isUserHeap*/),
                           "Out of Memory: Allocation of length %llu failed", static_cast<unsigned long long>(lengthToAllocate));
-    Assert(r == reinterpret_cast<void*>(allocAddr));
 
     m_systemHeapPtrLimit = newHeapLimit;
     Assert(m_systemHeapPtrLimit >= m_systemHeapCurPtr);
@@ -247,12 +416,9 @@ int32_t WARN_UNUSED VM::SpdsAllocatePageSlowPathImpl()
     //
     uintptr_t allocAddr = VMBaseAddress() + SignExtendTo<uint64_t>(m_spdsPageAllocLimit);
     Assert(allocAddr % x_pageSize == 0 && allocAddr % x_spdsAllocationPageSize == 0);
-    void* r = mmap(reinterpret_cast<void*>(allocAddr), static_cast<size_t>(lengthToAllocate), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_FIXED, -1, 0);
-    VM_FAIL_WITH_ERRNO_IF(r == MAP_FAILED,
+    VM_FAIL_WITH_ERRNO_IF(!MapHeapMemory(allocAddr, static_cast<size_t>(lengthToAllocate), false /*isUserHeap*/),
                           "Out of Memory: Allocation of length %llu failed", static_cast<unsigned long long>(lengthToAllocate));
 
-    Assert(r == reinterpret_cast<void*>(allocAddr));
-
     // The first page is returned to caller
     //
     int32_t result = m_spdsPageAllocLimit + static_cast<int32_t>(x_spdsAllocationPageSize);
@@ -280,12 +446,106 @@ int32_t WARN_UNUSED VM::SpdsAllocatePageSlowPathImpl()
     return result;
 }
 
+void VM::SetUserHeapPrefaultDistance(size_t bytes)
+{
+    bytes = RoundUpToMultipleOf<x_pageSize>(bytes);
+    if (bytes == 0 || m_heapBackingPolicy == HeapBackingPolicy::Eager)
+    {
+        delete m_heapPrefaulter;
+        m_heapPrefaulter = nullptr;
+        m_userHeapPrefaultDistance = 0;
+        m_userHeapPtrLimit = m_userHeapMappedLimit;
+        return;
+    }
+
+    if (m_heapPrefaulter == nullptr)
+    {
+        if (!VMHeapPrefaulter::IsSupported())
+        {
+            LOG_WARNING("Populating the heap ahead of allocation is not supported by the kernel (requires MADV_POPULATE_WRITE), ignored");
+            return;
+        }
+        m_heapPrefaulter = new VMHeapPrefaulter();
+        m_userHeapPrefaultedLimit = std::min(m_userHeapPrefaultedLimit, m_userHeapCurPtr & (~static_cast<int64_t>(x_pageSize - 1)));
+    }
+    m_userHeapPrefaultDistance = bytes;
+
+    // Take the slow path on the next allocation, so the prefaulter starts right away
+    //
+    m_userHeapPtrLimit = m_userHeapCurPtr;
+}
+
+void VM::ReleaseUnusedHeapMemory()
+{
+    // The pages between the mapped limit and the bump pointer of each heap are never used by any allocation yet
+    //
+    {
+        uintptr_t lo = VMBaseAddress() + static_cast<uint64_t>(m_userHeapMappedLimit);
+        // Keep the huge page that the bump pointer is in, releasing part of it would split it (or fail for hugetlb pages)
+        //
+        uintptr_t hi = VMBaseAddress() + static_cast<uint64_t>(m_userHeapCurPtr & (~static_cast<int64_t>((2ULL << 20) - 1)));
+        if (hi > lo)
+        {
+            LOG_WARNING_WITH_ERRNO_IF(madvise(reinterpret_cast<void*>(lo), hi - lo, MADV_DONTNEED) != 0, "Failed to release unused user heap memory");
+        }
+        m_userHeapPrefaultedLimit = m_userHeapCurPtr & (~static_cast<int64_t>(x_pageSize - 1));
+    }
+    {
+        uintptr_t lo = VMBaseAddress() + RoundUpToMultipleOf<x_pageSize>(m_systemHeapCurPtr);
+        uintptr_t hi = VMBaseAddress() + m_systemHeapPtrLimit;
+        if (hi > lo)
+        {
+            LOG_WARNING_WITH_ERRNO_IF(madvise(reinterpret_cast<void*>(lo), hi - lo, MADV_DONTNEED) != 0, "Failed to release unused system heap memory");
+        }
+    }
+}
+
+VM::ProcessMemoryStats WARN_UNUSED VM::GetProcessMemoryStats()
+{
+    ProcessMemoryStats res;
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        res.m_minorPageFaults = static_cast<uint64_t>(usage.ru_minflt);
+        res.m_majorPageFaults = static_cast<uint64_t>(usage.ru_majflt);
+        res.m_peakRssKb = usage.ru_maxrss;
+    }
+    else
+    {
+        res.m_minorPageFaults = 0;
+        res.m_majorPageFaults = 0;
+        res.m_peakRssKb = -1;
+    }
+
+    // The second field of /proc/self/statm is the number of resident pages
+    //
+    res.m_rssKb = -1;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (fp != nullptr)
+    {
+        unsigned long long numPages, numResidentPages;
+        if (fscanf(fp, "%llu %llu", &numPages, &numResidentPages) == 2)
+        {
+            res.m_rssKb = static_cast<int64_t>(numResidentPages * static_cast<unsigned long long>(sysconf(_SC_PAGESIZE)) / 1024);
+        }
+        fclose(fp);
+    }
+    return res;
+}
+
 bool WARN_UNUSED VM::InitializeVMGlobalData()
 {
     m_filePointerForStdout = stdout;
     m_filePointerForStderr = stderr;
 
     m_somGlobals = nullptr;
+    m_numGlobalWatchpointsFired = 0;
+    m_numLazyMethodStubs = 0;
+    m_numLazyMethodsCompiled = 0;
+    m_numClassesPreparsed = 0;
+    m_returnToHostOnExit = false;
+    m_exitRequested = false;
+    m_exitCode = 0;
     m_stringHiddenClass = nullptr;
     m_arrayHiddenClass = nullptr;
     m_objectClass = nullptr;
@@ -296,6 +556,7 @@ bool WARN_UNUSED VM::InitializeVMGlobalData()
     m_trueClass = nullptr;
     m_falseClass = nullptr;
     m_integerClass = nullptr;
+    m_largeIntegerClass = nullptr;
     m_doubleClass = nullptr;
     m_blockClass = nullptr;
     m_block1Class = nullptr;
@@ -375,9 +636,13 @@ bool WARN_UNUSED VM::InitializeVMGlobalData()
     m_strOperatorValue = GetUniquedString("value"); ReleaseAssert(m_strOperatorValue.m_id == m_strOperatorNotNil.m_id + 1);
     m_strOperatorNot = GetUniquedString("not"); ReleaseAssert(m_strOperatorNot.m_id == m_strOperatorValue.m_id + 1);
     m_strOperatorLength = GetUniquedString("length"); ReleaseAssert(m_strOperatorLength.m_id == m_strOperatorNot.m_id + 1);
+    m_strOperatorAtRandom = GetUniquedString("atRandom"); ReleaseAssert(m_strOperatorAtRandom.m_id == m_strOperatorLength.m_id + 1);
 
     m_strOperatorAtPut = GetUniquedString("at:put:");
     m_strOperatorValueWith = GetUniquedString("value:with:");
+    m_strHashcode = GetUniquedString("hashcode");
+
+    m_randomGenerator.Seed(SOMRandomGenerator::x_defaultSeed);
 
     CreateRootCoroutine();
     return true;
@@ -389,11 +654,34 @@ bool WARN_UNUSED VM::Initialize()
 
     CHECK_LOG_ERROR(InitializeVMBase());
     CHECK_LOG_ERROR(InitializeVMGlobalData());
+    if (x_allow_baseline_jit_tier_up_to_optimizing_jit)
+    {
+        dfg::CreateArenaForCurrentThread();
+    }
     return true;
 }
 
 void VM::Cleanup()
 {
+    // The prefaulter thread must be stopped before the VM memory is unmapped
+    //
+    delete m_heapPrefaulter;
+    m_heapPrefaulter = nullptr;
+    for (auto& it : m_preparsedClasses)
+    {
+        delete it.second.m_alloc;
+    }
+    m_preparsedClasses.clear();
+    for (SOMLazyMethodArena* arena : m_lazyMethodArenas)
+    {
+        delete arena->m_alloc;
+        delete arena;
+    }
+    m_lazyMethodArenas.clear();
+    if (x_allow_baseline_jit_tier_up_to_optimizing_jit)
+    {
+        dfg::DestroyArenaForCurrentThread();
+    }
 }
 
 void VM::CreateRootCoroutine()
@@ -406,6 +694,44 @@ void VM::CreateRootCoroutine()
     m_rootCoroutine->m_parent = nullptr;
 }
 
+void VM::SetGlobal(size_t idx, TValue value)
+{
+    TestAssert(idx < m_globalsVec.size() && m_globalsVec.data() == m_somGlobals);
+    m_somGlobals[idx] = value;
+
+    GlobalWatchpointState& state = m_globalWatchpointStates[idx];
+    if (state == GlobalWatchpointState::Unset)
+    {
+        state = GlobalWatchpointState::SetOnce;
+        return;
+    }
+    if (state == GlobalWatchpointState::SetOnce)
+    {
+        state = GlobalWatchpointState::Invalidated;
+        m_numGlobalWatchpointsFired++;
+    }
+
+    // The folded entries must always agree with the global, so patch them on every write after the watchpoint fired.
+    // BaselineCodeBlock::Create copies the constant table from the UnlinkedCodeBlock, so the patch also covers code compiled later.
+    //
+    for (FoldedGlobalConstant& item : m_foldedGlobalConstants[idx])
+    {
+        UnlinkedCodeBlock* ucb = item.m_ucb;
+        TestAssert(item.m_cstOrd < 0 && static_cast<uint64_t>(-item.m_cstOrd) <= ucb->m_cstTableLength);
+        ucb->m_cstTable[static_cast<int64_t>(ucb->m_cstTableLength) + item.m_cstOrd] = value.m_value;
+        CodeBlock* cb = ucb->m_defaultCodeBlock;
+        if (cb != nullptr)
+        {
+            cb->GetConstantTableEnd()[item.m_cstOrd] = value;
+            if (cb->m_baselineCodeBlock != nullptr)
+            {
+                cb->m_baselineCodeBlock->GetConstantTableEnd()[item.m_cstOrd] = value;
+            }
+        }
+        TestAssert(ucb->m_rareGOtoCBMap == nullptr);
+    }
+}
+
 SOMObject* VM::GetInternedString(size_t ord)
 {
     TestAssert(ord < m_interner.m_list.size());
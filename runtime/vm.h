@@ -6,12 +6,40 @@
 #include "string_interner.h"
 #include "som_primitives_container.h"
 #include "som_class.h"
+#include "som_random.h"
 
 // Uncomment to count how many times each method is called
 //
 //#define ENABLE_SOM_PROFILE_FREQUENCY
 
 class SOMObject;
+struct AstClass;
+
+struct SOMPreparsedClass
+{
+    // The arena that owns the AST
+    //
+    TempArenaAllocator* m_alloc;
+    // Null if the file has a syntax error, which is reported only if the class is loaded
+    //
+    AstClass* m_ast;
+    std::string m_parseError;
+};
+
+// The arena that owns the AST of a class whose methods are compiled lazily (see SOMCompileLazyMethod)
+// It is freed once every lazy method stub of the class has been compiled
+//
+struct SOMLazyMethodArena
+{
+    TempArenaAllocator* m_alloc;
+    // The number of lazy method stubs of the class that are not compiled yet,
+    // plus one while SOMCompileFile is still creating the class
+    //
+    uint32_t m_numUncompiledMethods;
+    // The index of this struct in VM::m_lazyMethodArenas
+    //
+    uint32_t m_index;
+};
 
 // Normally for each class type, we use one free list for compiler thread and one free list for execution thread.
 // However, some classes may be allocated on the compiler thread but freed on the execution thread.
@@ -194,6 +222,9 @@ private:
 class ScriptModule;
 
 class SOMClass;
+class BaselineCodeBlock;
+class UnlinkedCodeBlock;
+class VMHeapPrefaulter;
 
 // [ 12GB user heap ] [ 2GB padding ] [ 2GB short-pointer data structures ] [ 2GB system heap ]
 //                                                                          ^
@@ -430,14 +461,121 @@ public:
     //
     bool WARN_UNUSED BaselineJitCanTierUpFurther() { return false; }
 
+    // How the heap regions are backed by physical memory
+    //
+    // All policies except 'Eager' map the heap regions without populating them, so a page is only committed (and counted in RSS)
+    // when it is first touched. Under these policies, the user heap grows in 2MB-aligned chunks, so it can be backed by huge pages.
+    //
+    enum class HeapBackingPolicy : uint8_t
+    {
+        // Populate every page when a region grows (MAP_POPULATE)
+        //
+        Eager,
+        // Commit a page when it is first touched
+        //
+        Lazy,
+        // Same as 'Lazy', and ask for transparent huge pages for the user heap (MADV_HUGEPAGE)
+        //
+        LazyHugePages,
+        // Back the user heap with explicit 2MB hugetlb pages, and fall back to 'LazyHugePages' once no hugetlb page is available
+        //
+        HugeTLB
+    };
+
+    // Only affects heap growth after this call.
+    //
+    void SetHeapBackingPolicy(HeapBackingPolicy policy) { m_heapBackingPolicy = policy; }
+    HeapBackingPolicy GetHeapBackingPolicy() const { return m_heapBackingPolicy; }
+
+    // If not 0, a background thread populates the user heap up to this many bytes ahead of the bump pointer,
+    // so the execution thread rarely takes a page fault when allocating. Has no effect under the 'Eager' policy.
+    // Populating needs MADV_POPULATE_WRITE (Linux 5.14+), if it is not supported, a warning is printed and this is a no-op.
+    //
+    void SetUserHeapPrefaultDistance(size_t bytes);
+
+    // Give back the physical memory of the heap pages that are mapped but not used by any allocation (MADV_DONTNEED)
+    // Since there is no GC yet, this is only called at explicit shrink points, e.g., before the zygote starts forking jobs
+    //
+    void ReleaseUnusedHeapMemory();
+
+    // The length of the user heap and system heap that are mapped, whether committed or not
+    //
+    size_t GetUserHeapMappedSize() const
+    {
+        return static_cast<size_t>(-static_cast<int64_t>(x_vmBaseOffset - x_vmUserHeapSize) - m_userHeapMappedLimit);
+    }
+
+    size_t GetSystemHeapMappedSize() const
+    {
+        return m_systemHeapPtrLimit - RoundUpToMultipleOf<x_pageSize>(sizeof(VM));
+    }
+
+    // Process-wide, so they include the memory of all VMs and everything else in the process
+    //
+    struct ProcessMemoryStats
+    {
+        uint64_t m_minorPageFaults;
+        uint64_t m_majorPageFaults;
+        // -1 if unavailable
+        //
+        int64_t m_rssKb;
+        int64_t m_peakRssKb;
+    };
+
+    static ProcessMemoryStats WARN_UNUSED GetProcessMemoryStats();
+
+    // The JIT memory is split into a hot region and a cold region, so that the hot code of many functions are packed densely.
+    // The hot region holds the JIT fast paths and the IC stubs, the cold region holds the JIT slow paths and data sections.
+    //
     JitMemoryAllocator* GetJITMemoryAlloc()
     {
         return &m_jitMemoryAllocator;
     }
 
+    JitMemoryAllocator* GetColdJITMemoryAlloc()
+    {
+        return &m_coldJitMemoryAllocator;
+    }
+
+    // Includes both hot and cold region
+    //
+    size_t GetTotalJITCodeSize()
+    {
+        return m_jitMemoryAllocator.GetTotalJITCodeSize() + m_coldJitMemoryAllocator.GetTotalJITCodeSize();
+    }
+
     uint32_t GetNumTotalBaselineJitCompilations() { return m_totalBaselineJitCompilations; }
     void IncrementNumTotalBaselineJitCompilations() { m_totalBaselineJitCompilations++; }
 
+    // All BaselineCodeBlocks whose JIT code is currently installed in its owner CodeBlock
+    // BaselineCodeBlock::m_indexInLiveList is the index of the BaselineCodeBlock in this list
+    //
+    std::vector<BaselineCodeBlock*>& GetLiveBaselineCodeBlocks() { return m_liveBaselineCodeBlocks; }
+
+    // All BaselineCodeBlocks that have been jettisoned, but whose JIT code cannot be freed yet
+    // because some stack frame may still be executing it
+    //
+    std::vector<BaselineCodeBlock*>& GetJettisonedBaselineCodeBlocks() { return m_jettisonedBaselineCodeBlocks; }
+
+    // When the total JIT code size is about to exceed the sweep threshold, the baseline JIT will attempt
+    // to reclaim JIT code before emitting more. See baseline_jit_codegen_helper.h for details.
+    //
+    // The threshold is never lower than the memory limit, but may be raised above it if most of the JIT code cannot be reclaimed,
+    // so that we do not repeatedly sweep for nothing.
+    //
+    size_t GetBaselineJitCodeMemoryLimit() { return m_baselineJitCodeMemoryLimit; }
+    void SetBaselineJitCodeMemoryLimit(size_t value)
+    {
+        m_baselineJitCodeMemoryLimit = value;
+        m_baselineJitCodeSweepThreshold = value;
+    }
+
+    size_t GetBaselineJitCodeSweepThreshold() { return m_baselineJitCodeSweepThreshold; }
+    void SetBaselineJitCodeSweepThreshold(size_t value) { m_baselineJitCodeSweepThreshold = std::max(value, m_baselineJitCodeMemoryLimit); }
+
+    uint32_t GetNumTotalBaselineJitCodeReclaimed() { return m_totalBaselineJitCodeReclaimed; }
+    void IncrementNumTotalBaselineJitCodeReclaimed() { m_totalBaselineJitCodeReclaimed++; }
+
     SOMObject* GetInternedString(size_t ord);
     SOMObject* GetInternedSymbol(size_t ord);
 
@@ -464,6 +602,11 @@ private:
     void __attribute__((__preserve_most__)) BumpUserHeap();
     void BumpSystemHeap();
 
+    // Map [addr, addr + length) in the VM address range as read-write memory, backed according to m_heapBackingPolicy
+    // Return false on failure
+    //
+    bool WARN_UNUSED MapHeapMemory(uintptr_t addr, size_t length, bool isUserHeap);
+
     bool WARN_UNUSED SpdsAllocateTryGetFreeListPage(int32_t* out)
     {
         uint64_t taggedValue = m_spdsPageFreeList.load(std::memory_order_acquire);
@@ -516,7 +659,9 @@ private:
     alignas(64) SpdsAllocImpl<VM, false /*isTempAlloc*/> m_executionThreadSpdsAlloc;
 
     // user heap region grows from high address to low address
-    // highest physically mapped address of the user heap region (offsets from m_self)
+    // the allocation slow path (BumpUserHeap) is taken once m_userHeapCurPtr goes below this (offsets from m_self)
+    // this is m_userHeapMappedLimit, unless pages are populated ahead of the bump pointer, in which case it is higher,
+    // so that the slow path runs before the populated pages run out
     //
     int64_t m_userHeapPtrLimit;
 
@@ -524,6 +669,22 @@ private:
     //
     int64_t m_userHeapCurPtr;
 
+    // lowest mapped address of the user heap region (offsets from m_self)
+    //
+    int64_t m_userHeapMappedLimit;
+
+    // lowest address of the user heap region that has been handed to m_heapPrefaulter (offsets from m_self)
+    //
+    int64_t m_userHeapPrefaultedLimit;
+
+    size_t m_userHeapPrefaultDistance;
+
+    // nullptr if the user heap is not populated ahead of the bump pointer
+    //
+    VMHeapPrefaulter* m_heapPrefaulter;
+
+    HeapBackingPolicy m_heapBackingPolicy;
+
     // system heap region grows from low address to high address
     // lowest physically unmapped address of the system heap region (offsets from m_self)
     //
@@ -536,8 +697,16 @@ private:
     SpdsPtr<void> m_spdsExecutionThreadFreeList[x_numSpdsAllocatableClassNotUsingLfFreelist];
 
     JitMemoryAllocator m_jitMemoryAllocator;
+    JitMemoryAllocator m_coldJitMemoryAllocator;
 
     uint32_t m_totalBaselineJitCompilations;
+    uint32_t m_totalBaselineJitCodeReclaimed;
+
+    size_t m_baselineJitCodeMemoryLimit;
+    size_t m_baselineJitCodeSweepThreshold;
+
+    std::vector<BaselineCodeBlock*> m_liveBaselineCodeBlocks;
+    std::vector<BaselineCodeBlock*> m_jettisonedBaselineCodeBlocks;
 
     alignas(64) std::mutex m_spdsAllocationMutex;
 
@@ -558,6 +727,33 @@ public:
     std::vector<SOMObject*> m_internedStringObjects;
     std::vector<SOMObject*> m_internedSymbolObjects;
     std::unordered_map<size_t, SOMClass*> m_parsedClasses;
+    // Classes parsed ahead of time by SOMPreparseClasses but not compiled yet, consumed by SOMCompileFile
+    //
+    std::unordered_map<size_t /*classNameStringId*/, SOMPreparsedClass> m_preparsedClasses;
+    uint32_t m_numClassesPreparsed;
+    // Non-primitive methods are compiled on first lookup, see SOMCompileLazyMethod
+    //
+    uint32_t m_numLazyMethodStubs;
+    uint32_t m_numLazyMethodsCompiled;
+    // The arenas of the classes that still have methods to compile lazily
+    // The arenas left when the VM is destroyed (i.e., of methods never called) are freed then
+    //
+    std::vector<SOMLazyMethodArena*> m_lazyMethodArenas;
+    // The directories to search for class files, in order
+    // This is per VM, so VMs in the same process may run different programs
+    //
+    std::vector<std::string> m_classLoadPaths;
+    // Class sources registered by SOMAddInMemoryClassSource, used by SOMCompileFile instead of the class path
+    //
+    std::unordered_map<std::string /*className*/, std::string /*source*/> m_inMemoryClassSources;
+    // If true, 'System>>exit:' stores the exit code to m_exitCode, sets m_exitRequested, and unwinds the VM stack
+    // back to the DeegenEnterVMFromC call that entered the VM instead of terminating the process,
+    // so a VM that runs as one of many in the process (or is embedded in a host) can finish without taking the process down.
+    // The caller of DeegenEnterVMFromC must check and clear m_exitRequested after it returns.
+    //
+    bool m_returnToHostOnExit;
+    bool m_exitRequested;
+    int32_t m_exitCode;
     std::unordered_map<size_t /*internStringOrd*/, size_t /*idx*/> m_globalIdxMap;
     std::vector<size_t> m_globalStringIdWithIndex;
     std::vector<TValue> m_globalsVec;
@@ -582,6 +778,8 @@ public:
         {
             m_globalsVec.push_back(TValue::CreateImpossibleValue());
             m_somGlobals = m_globalsVec.data();
+            m_globalWatchpointStates.push_back(GlobalWatchpointState::Unset);
+            m_foldedGlobalConstants.emplace_back();
             m_globalIdxMap[ord] = m_globalsVec.size() - 1;
             m_globalStringIdWithIndex.push_back(ord);
             return m_globalsVec.size() - 1;
@@ -592,6 +790,56 @@ public:
         }
     }
 
+    // Every global has a watchpoint that tracks whether the global has been written at most once
+    //
+    // Nearly all globals are classes, which are written once when the class is loaded and never change.
+    // The frontend compiles a read of a global in 'SetOnce' state to a load from a constant table entry that is not shared
+    // with any other constant (see RegisterFoldedGlobalConstant), so the read needs no impossible-value check in any tier.
+    // When such a global is written again, the watchpoint fires: the state becomes 'Invalidated', so later compilations
+    // no longer fold the global, and every constant table entry folded from it is patched to the new value.
+    //
+    // Patching is enough for correctness even for functions currently executing, since the interpreter and the baseline JIT
+    // both load constants from the constant table of the CodeBlock or BaselineCodeBlock at runtime.
+    //
+    enum class GlobalWatchpointState : uint8_t
+    {
+        Unset,
+        SetOnce,
+        Invalidated
+    };
+
+    struct FoldedGlobalConstant
+    {
+        UnlinkedCodeBlock* m_ucb;
+        // The negative ordinal of the entry in the constant table
+        //
+        int64_t m_cstOrd;
+    };
+
+    std::vector<GlobalWatchpointState> m_globalWatchpointStates;
+    std::vector<std::vector<FoldedGlobalConstant>> m_foldedGlobalConstants;
+    uint32_t m_numGlobalWatchpointsFired;
+
+    bool WARN_UNUSED CanFoldGlobal(size_t idx)
+    {
+        TestAssert(idx < m_globalWatchpointStates.size());
+        return m_globalWatchpointStates[idx] == GlobalWatchpointState::SetOnce;
+    }
+
+    // All writes to a global must go through this function
+    //
+    void SetGlobal(size_t idx, TValue value);
+
+    // Record that constant table entry 'cstOrd' of 'ucb' holds the folded value of global 'idx'
+    //
+    void RegisterFoldedGlobalConstant(size_t idx, UnlinkedCodeBlock* ucb, int64_t cstOrd)
+    {
+        TestAssert(CanFoldGlobal(idx) && cstOrd < 0);
+        m_foldedGlobalConstants[idx].push_back({ .m_ucb = ucb, .m_cstOrd = cstOrd });
+    }
+
+    uint32_t GetNumGlobalWatchpointsFired() { return m_numGlobalWatchpointsFired; }
+
     static TValue VM_GetGlobal(size_t idx)
     {
         TestAssert(idx < VM_GetActiveVMForCurrentThread()->m_globalsVec.size());
@@ -630,6 +878,7 @@ public:
     HeapPtr<SOMClass> m_trueClass;
     HeapPtr<SOMClass> m_falseClass;
     HeapPtr<SOMClass> m_integerClass;
+    HeapPtr<SOMClass> m_largeIntegerClass;
     HeapPtr<SOMClass> m_doubleClass;
     HeapPtr<SOMClass> m_blockClass;
     HeapPtr<SOMClass> m_block1Class;
@@ -702,7 +951,7 @@ public:
 
     bool IsSelectorSpecializableUnaryOperator(size_t ord)
     {
-        return m_strOperatorAbs.m_id <= ord && ord <= m_strOperatorLength.m_id;
+        return m_strOperatorAbs.m_id <= ord && ord <= m_strOperatorAtRandom.m_id;
     }
 
     SOMUniquedString m_strOperatorAbs;
@@ -712,13 +961,19 @@ public:
     SOMUniquedString m_strOperatorValue;
     SOMUniquedString m_strOperatorNot;
     SOMUniquedString m_strOperatorLength;
+    SOMUniquedString m_strOperatorAtRandom;
 
     SOMUniquedString m_strOperatorAtPut;
     SOMUniquedString m_strOperatorValueWith;
+    SOMUniquedString m_strHashcode;
 
     SOMPrimitivesContainer m_somPrimitives;
     PerfTimer m_vmStartTime;
 
+    // Per-VM random number generator, reseeded by 'System>>randomSeed:'
+    //
+    SOMRandomGenerator m_randomGenerator;
+
 #ifdef ENABLE_SOM_PROFILE_FREQUENCY
     size_t WARN_UNUSED GetMethodIndexForFrequencyProfiling(std::string_view className, std::string_view methName, bool isClassSide)
     {
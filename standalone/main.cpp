@@ -28,6 +28,8 @@
 #include "runtime_utils.h"
 #include "som_compile_file.h"
 #include "deegen_enter_vm_from_c.h"
+#include "som_zygote.h"
+#include "dfg_compile_pipeline.h"
 
 #define DSOM_VERSION_MAJOR_NUMBER 0
 #define DSOM_VERSION_MINOR_NUMBER 0
@@ -50,9 +52,38 @@ static void NO_RETURN PrintUsageAndExit(const char* executable)
     fprintf(stderr, "    -g  ignored\n");
     fprintf(stderr, "    -H  ignored\n");
     fprintf(stderr, "    -h  show this help\n");
+    fprintf(stderr, "    --max-tier <interpreter|baseline|unrestricted>\n");
+    fprintf(stderr, "        restrict the highest execution tier the engine may use\n");
+    fprintf(stderr, "    --heap-policy <eager|lazy|thp|hugetlb>\n");
+    fprintf(stderr, "        how the heap is backed by memory: populated on growth, committed on first touch, plus transparent\n");
+    fprintf(stderr, "        huge pages (default), or explicit 2MB hugetlb pages (falling back to thp if none is available)\n");
+    fprintf(stderr, "    --heap-prefault <KB>\n");
+    fprintf(stderr, "        populate the heap up to <KB> ahead of allocation on a background thread (default: 0, disabled)\n");
+    fprintf(stderr, "    --parse-threads <n>\n");
+    fprintf(stderr, "        maximum number of threads used to parse class files at startup, extra threads are only started for larger programs (default: number of cores, at most 8; 1 to disable)\n");
+    fprintf(stderr, "    --vms <n>\n");
+    fprintf(stderr, "        run the program in <n> independent VMs concurrently, one per thread\n");
+    fprintf(stderr, "    --zygote <socket>\n");
+    fprintf(stderr, "        bootstrap once, run the program given in [args...] (if any) to warm up, then serve jobs\n");
+    fprintf(stderr, "        submitted via --connect on the Unix socket <socket>, each in a forked child\n");
+    fprintf(stderr, "    --zygote-preload <classes separated by :>\n");
+    fprintf(stderr, "        classes to load in the zygote before serving jobs\n");
+    fprintf(stderr, "    --connect <socket>\n");
+    fprintf(stderr, "        run [args...] as a job on the zygote listening on <socket>, with the stdio of this process\n");
+    fprintf(stderr, "    --bench-parser <directories separated by :>\n");
+    fprintf(stderr, "        measure the lexer and parser throughput over all .som files in the directories, and exit\n");
+    fprintf(stderr, "    --bench-dfg <class>>>selector>\n");
+    fprintf(stderr, "        run the program in [args...] to collect value profiles, then measure the DFG compile time of the method\n");
+    fprintf(stderr, "        (which must have been compiled by the baseline JIT) and print the per-pass breakdown\n");
+    fprintf(stderr, "    --bench-dfg-iterations <n>\n");
+    fprintf(stderr, "        number of times --bench-dfg compiles the method (default: 100)\n");
+    fprintf(stderr, "    --stats-json <file>\n");
+    fprintf(stderr, "        write engine statistics (JIT compilations, JIT code size, page faults, RSS) as JSON to <file> at exit\n");
     std::exit(0);
 }
 
+static std::vector<std::string> g_classLoadPaths;
+
 static void SetupClassPath(const std::string& cp)
 {
     std::stringstream ss(cp);
@@ -92,6 +123,98 @@ static bool GetClassPathExt(std::vector<std::string>& tokens, const std::string&
     return result;
 }
 
+static VM::EngineMaxTier g_engineMaxTier = VM::EngineMaxTier::Unrestricted;
+static VM::HeapBackingPolicy g_heapBackingPolicy = VM::HeapBackingPolicy::LazyHugePages;
+static size_t g_heapPrefaultDistance = 0;
+static std::string g_statsJsonFile;
+static std::string g_parserBenchmarkDirs;
+static std::string g_dfgBenchmarkMethod;
+static size_t g_numDfgBenchmarkIterations = 100;
+static size_t g_numVMs = 1;
+static std::string g_zygoteSocket;
+static std::string g_zygoteClientSocket;
+static std::vector<std::string> g_zygotePreloadClasses;
+
+static void WriteEngineStatsJson(VM* vm)
+{
+    FILE* fp = fopen(g_statsJsonFile.c_str(), "w");
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "[WARNING] Failed to open stats file '%s' for write, error = %d (%s)\n", g_statsJsonFile.c_str(), errno, strerror(errno));
+        return;
+    }
+
+    VM::ProcessMemoryStats memStats = VM::GetProcessMemoryStats();
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "    \"baselineJitCompilations\": %u,\n", vm->GetNumTotalBaselineJitCompilations());
+    fprintf(fp, "    \"baselineJitCodeReclaimed\": %u,\n", vm->GetNumTotalBaselineJitCodeReclaimed());
+    fprintf(fp, "    \"jitCodeSize\": %llu,\n", static_cast<unsigned long long>(vm->GetTotalJITCodeSize()));
+    fprintf(fp, "    \"globalWatchpointsFired\": %u,\n", vm->GetNumGlobalWatchpointsFired());
+    fprintf(fp, "    \"lazyMethodStubs\": %u,\n", vm->m_numLazyMethodStubs);
+    fprintf(fp, "    \"lazyMethodsCompiled\": %u,\n", vm->m_numLazyMethodsCompiled);
+    fprintf(fp, "    \"classesPreparsed\": %u,\n", vm->m_numClassesPreparsed);
+    fprintf(fp, "    \"userHeapMappedBytes\": %llu,\n", static_cast<unsigned long long>(vm->GetUserHeapMappedSize()));
+    fprintf(fp, "    \"systemHeapMappedBytes\": %llu,\n", static_cast<unsigned long long>(vm->GetSystemHeapMappedSize()));
+    fprintf(fp, "    \"minorPageFaults\": %llu,\n", static_cast<unsigned long long>(memStats.m_minorPageFaults));
+    fprintf(fp, "    \"majorPageFaults\": %llu,\n", static_cast<unsigned long long>(memStats.m_majorPageFaults));
+    fprintf(fp, "    \"rssKb\": %lld,\n", static_cast<long long>(memStats.m_rssKb));
+    fprintf(fp, "    \"peakRssKb\": %lld\n", static_cast<long long>(memStats.m_peakRssKb));
+    fprintf(fp, "}\n");
+    fclose(fp);
+}
+
+static void WriteEngineStatsJsonAtExit()
+{
+    WriteEngineStatsJson(VM::GetActiveVMForCurrentThread());
+}
+
+static VM::EngineMaxTier ParseEngineMaxTier(const char* executable, const char* tier)
+{
+    if (strcmp(tier, "interpreter") == 0)
+    {
+        return VM::EngineMaxTier::Interpreter;
+    }
+    else if (strcmp(tier, "baseline") == 0)
+    {
+        return VM::EngineMaxTier::BaselineJIT;
+    }
+    else if (strcmp(tier, "unrestricted") == 0)
+    {
+        return VM::EngineMaxTier::Unrestricted;
+    }
+    else
+    {
+        fprintf(stderr, "Unknown tier '%s'.\n", tier);
+        PrintUsageAndExit(executable);
+    }
+}
+
+static VM::HeapBackingPolicy ParseHeapBackingPolicy(const char* executable, const char* policy)
+{
+    if (strcmp(policy, "eager") == 0)
+    {
+        return VM::HeapBackingPolicy::Eager;
+    }
+    else if (strcmp(policy, "lazy") == 0)
+    {
+        return VM::HeapBackingPolicy::Lazy;
+    }
+    else if (strcmp(policy, "thp") == 0)
+    {
+        return VM::HeapBackingPolicy::LazyHugePages;
+    }
+    else if (strcmp(policy, "hugetlb") == 0)
+    {
+        return VM::HeapBackingPolicy::HugeTLB;
+    }
+    else
+    {
+        fprintf(stderr, "Unknown heap policy '%s'.\n", policy);
+        PrintUsageAndExit(executable);
+    }
+}
+
 std::vector<std::string> HandleArguments(int32_t argc, char** argv) {
     std::vector<std::string> vmArgs = std::vector<std::string>();
 
@@ -105,6 +228,131 @@ std::vector<std::string> HandleArguments(int32_t argc, char** argv) {
             }
             SetupClassPath(std::string(argv[++i]));
         }
+        else if (strcmp(argv[i], "--max-tier") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            g_engineMaxTier = ParseEngineMaxTier(argv[0], argv[++i]);
+        }
+        else if (strcmp(argv[i], "--heap-policy") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            g_heapBackingPolicy = ParseHeapBackingPolicy(argv[0], argv[++i]);
+        }
+        else if (strcmp(argv[i], "--heap-prefault") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            int prefaultKb = atoi(argv[++i]);
+            if (prefaultKb < 0)
+            {
+                fprintf(stderr, "Invalid heap prefault distance '%s'.\n", argv[i]);
+                PrintUsageAndExit(argv[0]);
+            }
+            g_heapPrefaultDistance = static_cast<size_t>(prefaultKb) * 1024;
+        }
+        else if (strcmp(argv[i], "--parse-threads") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            int numThreads = atoi(argv[++i]);
+            if (numThreads <= 0)
+            {
+                fprintf(stderr, "Invalid number of parse threads '%s'.\n", argv[i]);
+                PrintUsageAndExit(argv[0]);
+            }
+            g_numClassParseThreads = static_cast<size_t>(numThreads);
+        }
+        else if (strcmp(argv[i], "--vms") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            int numVMs = atoi(argv[++i]);
+            if (numVMs <= 0)
+            {
+                fprintf(stderr, "Invalid number of VMs '%s'.\n", argv[i]);
+                PrintUsageAndExit(argv[0]);
+            }
+            g_numVMs = static_cast<size_t>(numVMs);
+        }
+        else if (strcmp(argv[i], "--zygote") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            g_zygoteSocket = argv[++i];
+        }
+        else if (strcmp(argv[i], "--zygote-preload") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            std::stringstream ss(argv[++i]);
+            std::string token;
+            while (getline(ss, token, ':'))
+            {
+                g_zygotePreloadClasses.push_back(token);
+            }
+        }
+        else if (strcmp(argv[i], "--connect") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            g_zygoteClientSocket = argv[++i];
+        }
+        else if (strcmp(argv[i], "--bench-parser") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            g_parserBenchmarkDirs = argv[++i];
+        }
+        else if (strcmp(argv[i], "--bench-dfg") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            g_dfgBenchmarkMethod = argv[++i];
+        }
+        else if (strcmp(argv[i], "--bench-dfg-iterations") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            int numIterations = atoi(argv[++i]);
+            if (numIterations <= 0)
+            {
+                fprintf(stderr, "Invalid number of DFG benchmark iterations '%s'.\n", argv[i]);
+                PrintUsageAndExit(argv[0]);
+            }
+            g_numDfgBenchmarkIterations = static_cast<size_t>(numIterations);
+        }
+        else if (strcmp(argv[i], "--stats-json") == 0)
+        {
+            if (argc == i + 1)
+            {
+                PrintUsageAndExit(argv[0]);
+            }
+            g_statsJsonFile = argv[++i];
+        }
         else if (strncmp(argv[i], "-d", 2) == 0)
         {
             /*ignored*/
@@ -144,25 +392,30 @@ std::vector<std::string> HandleArguments(int32_t argc, char** argv) {
     return vmArgs;
 }
 
-void DoWork(int argc, char** argv)
+// Create a VM on the current thread, configured by the command line options
+//
+static VM* WARN_UNUSED CreateConfiguredVM()
 {
-    std::vector<std::string> args = HandleArguments(argc, argv);
-
-    if (args.empty())
-    {
-        // Interactive shell not supported
-        //
-        PrintUsageAndExit(argv[0]);
-    }
-
     VM* vm = VM::Create();
+    vm->m_classLoadPaths = g_classLoadPaths;
+
+    vm->SetHeapBackingPolicy(g_heapBackingPolicy);
+    vm->SetUserHeapPrefaultDistance(g_heapPrefaultDistance);
 
-    if (x_allow_interpreter_tier_up_to_baseline_jit)
+    vm->SetEngineMaxTier(g_engineMaxTier);
+    if (x_allow_interpreter_tier_up_to_baseline_jit && g_engineMaxTier != VM::EngineMaxTier::Interpreter)
     {
         vm->SetEngineStartingTier(VM::EngineStartingTier::BaselineJIT);
     }
+    return vm;
+}
 
-    SOMInitializationResult r =  SOMBootstrapClassHierarchy();
+// Run 'System>>initialize:' with 'args' in the VM of the current thread, which has been bootstrapped
+// Return when the program finishes, unless it calls 'System>>exit:'
+//
+static void RunSOMProgram(const SOMInitializationResult& r, const std::vector<std::string>& args)
+{
+    VM* vm = VM::GetActiveVMForCurrentThread();
 
     HeapPtr<FunctionObject> runFn = SOMGetMethodFromClass(r.m_systemClass, "initialize:");
     TestAssert(runFn != nullptr);
@@ -187,6 +440,215 @@ void DoWork(int argc, char** argv)
 #endif
 }
 
+// Create a VM on the current thread, and run the SOM program in it
+//
+// If 'isOneOfManyVMs' is true, 'System>>exit:' only ends this VM instead of terminating the process,
+// and the VM is destroyed when the program finishes. Return the exit code of the program.
+//
+static int RunSOMProgramInNewVM(const std::vector<std::string>& args, bool isOneOfManyVMs, bool writeStats)
+{
+    VM* vm = CreateConfiguredVM();
+
+    if (isOneOfManyVMs)
+    {
+        vm->m_returnToHostOnExit = true;
+    }
+    else if (writeStats)
+    {
+        // The SOM program may terminate the process via 'system exit:', so the stats are written by an exit handler
+        //
+        atexit(WriteEngineStatsJsonAtExit);
+    }
+
+    // The arguments are usually the main class followed by its arguments, which are often class names as well (e.g., the benchmark to run)
+    //
+    SOMInitializationResult r = SOMBootstrapClassHierarchy(args);
+
+    RunSOMProgram(r, args);
+
+    int exitCode = vm->m_exitRequested ? vm->m_exitCode : 0;
+    if (isOneOfManyVMs)
+    {
+        if (writeStats)
+        {
+            WriteEngineStatsJson(vm);
+        }
+        vm->Destroy();
+    }
+    return exitCode;
+}
+
+// Bootstrap a VM, load the preloaded classes, run the warm-up program in 'warmupArgs' (if not empty),
+// and then serve jobs on the zygote socket, each in a forked child that inherits the warm VM
+//
+static void NO_RETURN RunSOMZygote(const std::vector<std::string>& warmupArgs)
+{
+    VM* vm = CreateConfiguredVM();
+
+    std::vector<std::string> appClassNames = warmupArgs;
+    appClassNames.insert(appClassNames.end(), g_zygotePreloadClasses.begin(), g_zygotePreloadClasses.end());
+    SOMInitializationResult r = SOMBootstrapClassHierarchy(appClassNames);
+
+    for (const std::string& className : g_zygotePreloadClasses)
+    {
+        std::ignore = SOMCompileFile(className);
+    }
+
+    if (!warmupArgs.empty())
+    {
+        // The warm-up program must not terminate the zygote
+        //
+        vm->m_returnToHostOnExit = true;
+        RunSOMProgram(r, warmupArgs);
+        vm->m_returnToHostOnExit = false;
+        if (vm->m_exitRequested && vm->m_exitCode != 0)
+        {
+            fprintf(stderr, "[zygote] Warm-up program exited with code %d.\n", static_cast<int>(vm->m_exitCode));
+        }
+        vm->m_exitRequested = false;
+        fflush(stdout);
+    }
+
+    // The prefaulter thread would not survive the fork, and the jobs do not need the pages the warm-up has not used
+    //
+    vm->SetUserHeapPrefaultDistance(0);
+    vm->ReleaseUnusedHeapMemory();
+
+    RunSOMZygoteServer(g_zygoteSocket.c_str(), [&](const std::vector<std::string>& args) -> int
+    {
+        if (args.empty())
+        {
+            fprintf(stderr, "No class specified.\n");
+            return 1;
+        }
+        RunSOMProgram(r, args);
+        return 0;
+    });
+}
+
+// Run the SOM program so the baseline JIT code of 'methodSpec' (in the form of 'Class>>selector') collects value profiles,
+// then repeatedly compile that method with the DFG and print the compile-time breakdown
+//
+static void RunDfgCompileBenchmark(const std::string& methodSpec, const std::vector<std::string>& args)
+{
+    if (!x_allow_baseline_jit_tier_up_to_optimizing_jit)
+    {
+        fprintf(stderr, "--bench-dfg is not supported: the DFG tier is disabled in this build.\n");
+        exit(1);
+    }
+
+    size_t sepPos = methodSpec.find(">>");
+    if (sepPos == std::string::npos || sepPos == 0 || sepPos + 2 == methodSpec.length())
+    {
+        fprintf(stderr, "Invalid method '%s', expected <class>>>selector>.\n", methodSpec.c_str());
+        exit(1);
+    }
+    std::string className = methodSpec.substr(0, sepPos);
+    std::string selector = methodSpec.substr(sepPos + 2);
+
+    VM* vm = CreateConfiguredVM();
+
+    // The program must return here so that the method can be compiled after it finishes
+    //
+    vm->m_returnToHostOnExit = true;
+    SOMInitializationResult r = SOMBootstrapClassHierarchy(args);
+    RunSOMProgram(r, args);
+    vm->m_returnToHostOnExit = false;
+    fflush(stdout);
+
+    HeapPtr<FunctionObject> fn = SOMGetMethodFromClass(SOMCompileFile(className), selector);
+    if (fn == nullptr)
+    {
+        fprintf(stderr, "Method '%s' not found.\n", methodSpec.c_str());
+        exit(1);
+    }
+    ExecutableCode* ec = TranslateToRawPointer(TCGet(fn->m_executable).As());
+    if (!ec->IsBytecodeFunction())
+    {
+        fprintf(stderr, "Method '%s' is a primitive and cannot be compiled by the DFG.\n", methodSpec.c_str());
+        exit(1);
+    }
+    CodeBlock* cb = static_cast<CodeBlock*>(ec);
+    if (cb->m_baselineCodeBlock == nullptr)
+    {
+        fprintf(stderr, "Method '%s' has not been compiled by the baseline JIT, so it has no value profiles for the DFG.\n", methodSpec.c_str());
+        exit(1);
+    }
+
+    dfg::BenchmarkDfgCompilePipeline(cb, g_numDfgBenchmarkIterations, stderr);
+}
+
+void DoWork(int argc, char** argv)
+{
+    std::vector<std::string> args = HandleArguments(argc, argv);
+
+    if (!g_parserBenchmarkDirs.empty())
+    {
+        std::vector<std::string> dirs;
+        std::stringstream ss(g_parserBenchmarkDirs);
+        std::string token;
+        while (getline(ss, token, ':'))
+        {
+            dirs.push_back(token);
+        }
+        SOMRunParserBenchmark(dirs, 20 /*numRepeats*/);
+        return;
+    }
+
+    if (args.empty() && g_zygoteSocket.empty())
+    {
+        // Interactive shell not supported
+        //
+        PrintUsageAndExit(argv[0]);
+    }
+
+    if (!g_dfgBenchmarkMethod.empty())
+    {
+        RunDfgCompileBenchmark(g_dfgBenchmarkMethod, args);
+        return;
+    }
+
+    if (!g_zygoteClientSocket.empty())
+    {
+        exit(RunSOMZygoteClient(g_zygoteClientSocket.c_str(), args));
+    }
+
+    if (!g_zygoteSocket.empty())
+    {
+        RunSOMZygote(args);
+    }
+
+    if (g_numVMs == 1)
+    {
+        std::ignore = RunSOMProgramInNewVM(args, false /*isOneOfManyVMs*/, !g_statsJsonFile.empty() /*writeStats*/);
+        return;
+    }
+
+    // Run the program in multiple independent VMs concurrently, one per thread
+    // The stats (if requested) are those of the first VM
+    //
+    std::vector<int> exitCodes(g_numVMs, 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < g_numVMs; i++)
+    {
+        threads.push_back(std::thread([&, i]()
+        {
+            exitCodes[i] = RunSOMProgramInNewVM(args, true /*isOneOfManyVMs*/, i == 0 && !g_statsJsonFile.empty() /*writeStats*/);
+        }));
+    }
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    for (int exitCode : exitCodes)
+    {
+        if (exitCode != 0)
+        {
+            exit(exitCode);
+        }
+    }
+}
+
 int main(int argc, char** argv)
 {
     DoWork(argc, argv);
@@ -0,0 +1,316 @@
+#include "som_zygote.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+static constexpr size_t x_numFdsPerRequest = 3;
+
+// Limit the size of a request, so a broken client cannot make the zygote allocate arbitrary amount of memory
+//
+static constexpr uint32_t x_maxRequestPayloadLength = 1 << 20;
+
+static bool WARN_UNUSED WriteAll(int fd, const void* data, size_t len)
+{
+    const char* p = reinterpret_cast<const char*>(data);
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0)
+        {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool WARN_UNUSED ReadAll(int fd, void* data, size_t len)
+{
+    char* p = reinterpret_cast<char*>(data);
+    while (len > 0)
+    {
+        ssize_t n = read(fd, p, len);
+        if (n == 0)
+        {
+            return false;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static void MakeSocketAddress(const char* socketPath, sockaddr_un& addr /*out*/)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Socket path '%s' is too long.\n", socketPath);
+        exit(1);
+    }
+    strcpy(addr.sun_path, socketPath);
+}
+
+// Receive a request from 'conn'. On success, 'fds' are the stdin, stdout and stderr of the client
+//
+static bool WARN_UNUSED ReceiveRequest(int conn, int (&fds)[x_numFdsPerRequest] /*out*/, std::vector<std::string>& args /*out*/)
+{
+    SOMZygoteRequestHeader header;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * x_numFdsPerRequest)];
+    iovec iov = { .iov_base = &header, .iov_len = sizeof(header) };
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do
+    {
+        n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+    }
+    while (n < 0 && errno == EINTR);
+
+    bool gotFds = false;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int) * x_numFdsPerRequest))
+        {
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * x_numFdsPerRequest);
+            gotFds = true;
+        }
+    }
+
+    auto closeFds = [&]()
+    {
+        if (gotFds)
+        {
+            for (int fd : fds) { close(fd); }
+        }
+    };
+
+    if (n != static_cast<ssize_t>(sizeof(header)) || !gotFds || header.m_magic != SOMZygoteRequestHeader::x_magic || header.m_payloadLength > x_maxRequestPayloadLength)
+    {
+        closeFds();
+        return false;
+    }
+
+    std::string payload(header.m_payloadLength, '\0');
+    if (!ReadAll(conn, payload.data(), payload.size()) || (payload.size() > 0 && payload.back() != '\0'))
+    {
+        closeFds();
+        return false;
+    }
+
+    args.clear();
+    size_t start = 0;
+    while (start < payload.size())
+    {
+        size_t end = payload.find('\0', start);
+        args.push_back(payload.substr(start, end - start));
+        start = end + 1;
+    }
+    return true;
+}
+
+// Written by the SIGCHLD handler, so the poll loop wakes up to reap the finished jobs
+//
+static int g_zygoteChildExitPipeWriteEnd = -1;
+
+static void SOMZygoteSigchldHandler(int /*sig*/)
+{
+    int savedErrno = errno;
+    char c = 0;
+    std::ignore = write(g_zygoteChildExitPipeWriteEnd, &c, 1);
+    errno = savedErrno;
+}
+
+void NO_RETURN RunSOMZygoteServer(const char* socketPath, const std::function<int(const std::vector<std::string>&)>& runJob)
+{
+    int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    VM_FAIL_WITH_ERRNO_IF(listenFd == -1, "Failed to create zygote socket");
+
+    sockaddr_un addr;
+    MakeSocketAddress(socketPath, addr /*out*/);
+    unlink(socketPath);
+    VM_FAIL_WITH_ERRNO_IF(bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0, "Failed to bind zygote socket to '%s'", socketPath);
+    VM_FAIL_WITH_ERRNO_IF(listen(listenFd, 128) != 0, "Failed to listen on zygote socket");
+
+    int childExitPipe[2];
+    VM_FAIL_WITH_ERRNO_IF(pipe2(childExitPipe, O_CLOEXEC | O_NONBLOCK) != 0, "Failed to create pipe");
+    g_zygoteChildExitPipeWriteEnd = childExitPipe[1];
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SOMZygoteSigchldHandler;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&sa.sa_mask);
+    VM_FAIL_WITH_ERRNO_IF(sigaction(SIGCHLD, &sa, nullptr) != 0, "Failed to install SIGCHLD handler");
+
+    fprintf(stderr, "[zygote] Listening on %s\n", socketPath);
+    fflush(stderr);
+    fflush(stdout);
+
+    // The connection of each running job, where its exit code is sent to when it finishes
+    //
+    std::unordered_map<pid_t, int> jobConnections;
+
+    while (true)
+    {
+        pollfd pfds[2] = {
+            { .fd = listenFd, .events = POLLIN, .revents = 0 },
+            { .fd = childExitPipe[0], .events = POLLIN, .revents = 0 }
+        };
+        int ret = poll(pfds, 2, -1 /*timeout*/);
+        if (ret < 0)
+        {
+            VM_FAIL_WITH_ERRNO_IF(errno != EINTR, "poll failed");
+            continue;
+        }
+
+        if (pfds[1].revents != 0)
+        {
+            char buf[64];
+            while (read(childExitPipe[0], buf, sizeof(buf)) > 0) { }
+
+            int status;
+            pid_t pid;
+            while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+            {
+                auto it = jobConnections.find(pid);
+                if (it == jobConnections.end())
+                {
+                    continue;
+                }
+                int32_t exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : (WIFSIGNALED(status) ? 128 + WTERMSIG(status) : 1);
+                LOG_WARNING_WITH_ERRNO_IF(!WriteAll(it->second, &exitCode, sizeof(exitCode)), "Failed to send the exit code of job %d", static_cast<int>(pid));
+                close(it->second);
+                jobConnections.erase(it);
+            }
+        }
+
+        if (pfds[0].revents != 0)
+        {
+            int conn = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (conn == -1)
+            {
+                LOG_WARNING_WITH_ERRNO_IF(errno != EINTR && errno != EAGAIN, "Failed to accept zygote connection");
+                continue;
+            }
+
+            // Do not let a stuck client block the zygote forever
+            //
+            timeval timeout = { .tv_sec = 5, .tv_usec = 0 };
+            std::ignore = setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+            int fds[x_numFdsPerRequest];
+            std::vector<std::string> args;
+            if (!ReceiveRequest(conn, fds /*out*/, args /*out*/))
+            {
+                LOG_WARNING("Ignored malformed zygote request");
+                close(conn);
+                continue;
+            }
+
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                // The job process: take over the stdio of the client, and run the job in the inherited VM
+                //
+                signal(SIGCHLD, SIG_DFL);
+                close(listenFd);
+                close(childExitPipe[0]);
+                close(childExitPipe[1]);
+                close(conn);
+                for (size_t i = 0; i < x_numFdsPerRequest; i++)
+                {
+                    VM_FAIL_WITH_ERRNO_IF(dup2(fds[i], static_cast<int>(i)) == -1, "Failed to redirect stdio");
+                    close(fds[i]);
+                }
+                int exitCode = runJob(args);
+                exit(exitCode);
+            }
+
+            for (int fd : fds) { close(fd); }
+            if (pid == -1)
+            {
+                LOG_WARNING_WITH_ERRNO("Failed to fork zygote job");
+                int32_t exitCode = 1;
+                std::ignore = WriteAll(conn, &exitCode, sizeof(exitCode));
+                close(conn);
+                continue;
+            }
+            jobConnections[pid] = conn;
+        }
+    }
+}
+
+int WARN_UNUSED RunSOMZygoteClient(const char* socketPath, const std::vector<std::string>& args)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    VM_FAIL_WITH_ERRNO_IF(fd == -1, "Failed to create socket");
+
+    sockaddr_un addr;
+    MakeSocketAddress(socketPath, addr /*out*/);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        fprintf(stderr, "Failed to connect to zygote at '%s': %s\n", socketPath, strerror(errno));
+        return 1;
+    }
+
+    std::string payload;
+    for (const std::string& arg : args)
+    {
+        payload += arg;
+        payload += '\0';
+    }
+
+    SOMZygoteRequestHeader header = {
+        .m_magic = SOMZygoteRequestHeader::x_magic,
+        .m_payloadLength = static_cast<uint32_t>(payload.size())
+    };
+    int fds[x_numFdsPerRequest] = { 0, 1, 2 };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+    memset(control, 0, sizeof(control));
+    iovec iov = { .iov_base = &header, .iov_len = sizeof(header) };
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t n;
+    do
+    {
+        n = sendmsg(fd, &msg, 0);
+    }
+    while (n < 0 && errno == EINTR);
+
+    int32_t exitCode;
+    if (n != static_cast<ssize_t>(sizeof(header)) || !WriteAll(fd, payload.data(), payload.size()) || !ReadAll(fd, &exitCode, sizeof(exitCode)))
+    {
+        fprintf(stderr, "Failed to run job on zygote at '%s'.\n", socketPath);
+        close(fd);
+        return 1;
+    }
+    close(fd);
+    return exitCode;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "common_utils.h"
+
+// The zygote mode: a process that has bootstrapped the VM (and possibly warmed it up) once,
+// and forks a child to run each job, so the job inherits the warm VM copy-on-write instead of starting from scratch.
+//
+// Protocol (over a Unix stream socket):
+//     The client sends a SOMZygoteRequestHeader with its stdin, stdout and stderr attached as SCM_RIGHTS,
+//     followed by 'm_payloadLength' bytes holding the program arguments, each terminated by '\0'.
+//     When the job finishes, the server sends back an int32_t: the exit code of the job, or 128 + signal number if the job was killed.
+//
+struct SOMZygoteRequestHeader
+{
+    static constexpr uint32_t x_magic = 0x5a534f4d;     // 'ZSOM'
+
+    uint32_t m_magic;
+    uint32_t m_payloadLength;
+};
+
+// Listen on 'socketPath' and serve jobs forever
+// 'runJob' is called in the forked child with its stdio already redirected, and returns the exit code of the job
+//
+void NO_RETURN RunSOMZygoteServer(const char* socketPath, const std::function<int(const std::vector<std::string>&)>& runJob);
+
+// Submit a job to the zygote listening on 'socketPath' with the stdio of the current process, and wait for it to finish
+// Return the exit code of the job
+//
+int WARN_UNUSED RunSOMZygoteClient(const char* socketPath, const std::vector<std::string>& args);